@@ -38,11 +38,26 @@ public class ImageLoaderPlugin : ModuleRules
 				//"Engine",
 				"Slate",
 				"SlateCore",
+				"HTTP",
+				"PlatformCryptoOpenSSL",
+				"LicenseSystemPlugin",
+				"Json",
 				// ... add private dependencies that you statically link with here ...	
 			}
 			);
 		
 		
+		// The local http server only serves the automation tests, it stays out of shipping builds
+		bool bWithHttpServerTests = Target.bBuildDeveloperTools || Target.Configuration != UnrealTargetConfiguration.Shipping;
+		if (bWithHttpServerTests)
+		{
+			PrivateDependencyModuleNames.Add("HTTPServer");
+		}
+		PrivateDefinitions.Add("WITH_HTTPSERVER_TESTS=" + (bWithHttpServerTests ? "1" : "0"));
+
+		// RAND_bytes for the IVs of encrypted images
+		AddEngineThirdPartyPrivateStaticDependencies(Target, "OpenSSL");
+
 		DynamicallyLoadedModuleNames.AddRange(
 			new string[]
 			{
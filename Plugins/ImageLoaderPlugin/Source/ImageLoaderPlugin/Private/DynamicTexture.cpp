@@ -2,24 +2,44 @@
 
 #include "Runtime/Engine/Classes/Components/StaticMeshComponent.h"
 #include "Runtime/Engine/Classes/Engine/Texture2D.h"
+#include "Misc/ScopeLock.h"
+#include "UploadBufferPool.h"
+#include "DynamicTextureIngest.h"
+#include "Runtime/Core/Public/Async/ParallelFor.h"
+
+#if PLATFORM_CPU_X86_FAMILY
+#include <emmintrin.h>
+#endif
 
 // See https://wiki.unrealengine.com/Procedural_Materials
 
 
+// Dirty rectangles are merged down to at most this many regions per upload
+static const int32 MaxDirtyRegions = 16;
+
+// Above this dirty fraction of the texture a single full upload is cheaper than many regions
+static const float FullUploadDirtyRatio = 0.6f;
+
+
 struct UpdateTextureRegionsParams
 {
 	UTexture2D* Texture;
 	int32 MipIndex;
 	uint32 NumRegions;
 	const FUpdateTextureRegion2D* Regions;
+	// Bytes per row, or per row of 4x4 blocks for block compressed formats
 	uint32 SrcPitch;
+	// Bytes per pixel, or per block for block compressed formats
 	uint32 SrcBpp;
 	const uint8* SrcData;
+	// Frees SrcData with FMemory::Free once uploaded
 	bool FreeData;
+	// Called on the render thread once SrcData is no longer needed
+	TFunction<void()> OnUploaded;
 };
 
 // Send the render command to update the texture
-void UpdateTextureRegions(UpdateTextureRegionsParams& params, FThreadSafeBool& updated)
+bool UpdateTextureRegions(UpdateTextureRegionsParams& params, FThreadSafeBool& updated)
 {
 	if (params.Texture && params.Texture->Resource)
 	{
@@ -28,7 +48,7 @@ void UpdateTextureRegions(UpdateTextureRegionsParams& params, FThreadSafeBool& u
 			FTexture2DResource* Texture2DResource;
 			int32 MipIndex;
 			uint32 NumRegions;
-			const FUpdateTextureRegion2D* Regions;
+			TArray<FUpdateTextureRegion2D> Regions;
 			uint32 SrcPitch;
 			uint32 SrcBpp;
 			const uint8* SrcData;
@@ -39,13 +59,15 @@ void UpdateTextureRegions(UpdateTextureRegionsParams& params, FThreadSafeBool& u
 		RegionData->Texture2DResource = (FTexture2DResource*) params.Texture->Resource;
 		RegionData->MipIndex = params.MipIndex;
 		RegionData->NumRegions = params.NumRegions;
-		RegionData->Regions = params.Regions;
+		// The regions are copied, so callers may pass a temporary list
+		RegionData->Regions.Append(params.Regions, params.NumRegions);
 		RegionData->SrcPitch = params.SrcPitch;
 		RegionData->SrcBpp = params.SrcBpp;
 		RegionData->SrcData = params.SrcData;
 
         bool FreeData = params.FreeData;
-        ENQUEUE_RENDER_COMMAND(UpdateTextureRegionsData)([RegionData, FreeData, &updated](FRHICommandListImmediate& RHICmdList)
+        TFunction<void()> OnUploaded = MoveTemp(params.OnUploaded);
+        ENQUEUE_RENDER_COMMAND(UpdateTextureRegionsData)([RegionData, FreeData, OnUploaded, &updated](FRHICommandListImmediate& RHICmdList)
             {
 				for (uint32 RegionIndex = 0; RegionIndex < RegionData->NumRegions; ++RegionIndex)
 				{
@@ -58,21 +80,37 @@ void UpdateTextureRegions(UpdateTextureRegionsParams& params, FThreadSafeBool& u
 								RegionData->Regions[RegionIndex].SrcX * RegionData->SrcBpp);
 					}
 				}
-				//if (FreeData)
-				//{
-				//	FMemory::Free(RegionData->Regions);
-				//	FMemory::Free(RegionData->SrcData);
-				//}
+				if (FreeData)
+				{
+					FMemory::Free(const_cast<uint8*>(RegionData->SrcData));
+				}
 				delete RegionData;
+				if (OnUploaded)
+					OnUploaded();
                 updated = true;
 			});
+		return true;
 	}
+	return false;
 }
 
 UDynamicTexture::UDynamicTexture(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
 {
 }
 
+void UDynamicTexture::BeginDestroy()
+{
+	StopIngest();
+	Super::BeginDestroy();
+	ReleaseFence.BeginFence();
+}
+
+bool UDynamicTexture::IsReadyForFinishDestroy()
+{
+	// Pending uploads read from the staging buffers
+	return Super::IsReadyForFinishDestroy() && ReleaseFence.IsFenceComplete();
+}
+
 UDynamicTexture::~UDynamicTexture()
 {
 	//if (UpdateTextureRegion)
@@ -86,8 +124,29 @@ UDynamicTexture::~UDynamicTexture()
 	//DestroyTexture2D();
 }
 
-void UDynamicTexture::DestroyTexture2D()
+bool UDynamicTexture::DestroyTexture2D()
 {
+	// Producers check Created under the lock, so no buffer is acquired once it is cleared
+	TArray<TUniquePtr<FDynamicTextureStagingBuffer>> OldBuffers;
+	{
+		FScopeLock Lock(&StagingMutex);
+		if (!DetachStagingBuffers(OldBuffers))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("UDynamicTexture::DestroyTexture2D: A staging buffer is still acquired, the texture is kept"));
+			return false;
+		}
+		Created = false;
+	}
+
+	StopIngest();
+
+	// Buffers still being uploaded must not go away under the render thread
+	if (OldBuffers.Num() > 0)
+	{
+		FlushRenderingCommands();
+		OldBuffers.Empty();
+	}
+
     if (Texture2D)
     {
         if (Texture2D->IsValidLowLevel())
@@ -102,7 +161,7 @@ void UDynamicTexture::DestroyTexture2D()
     Height = 0;
 
     Uploaded = false;
-    Created = false;
+    return true;
 }
 
 void UDynamicTexture::ReleaseCpuMemory()
@@ -124,16 +183,23 @@ int32 UDynamicTexture::SizeKb() const
 		return 0;
 }
 
-bool UDynamicTexture::CreateResource(int32 width, int32 height, EPixelFormat pixelFormat, TextureAddress TexTilingAddres)
+bool UDynamicTexture::CreateResource(int32 width, int32 height, EPixelFormat pixelFormat, TextureAddress TexTilingAddres, int32 NumMips)
 {
-    //DestroyTexture2D();
-
     if (width < 1 || height < 1)
     {
         UE_LOG(LogTemp, Error, TEXT("-- DynamicTexture::Initialize : Invalid image for DynamicTexture initialization"));
         return false;
     }
 
+    NumMips = FMath::Clamp(NumMips, 1, static_cast<int32>(FMath::FloorLog2(FMath::Max(width, height))) + 1);
+
+    // A texture of the same layout is reused, the next upload overwrites its content
+    if (Texture2D && (Texture2D->GetSizeX() != width || Texture2D->GetSizeY() != height || Texture2D->GetPixelFormat() != pixelFormat || Texture2D->GetNumMips() != NumMips))
+    {
+        if (!DestroyTexture2D())
+            return false;
+    }
+
     Width = width;
     Height = height;
 
@@ -150,6 +216,23 @@ bool UDynamicTexture::CreateResource(int32 width, int32 height, EPixelFormat pix
         Texture2D->SRGB = 1;
         // Make sure it never gets garbage collected
         //Texture2D->AddToRoot();
+
+        // CreateTransient only makes the base level, the others are added with room for their blocks
+        const FPixelFormatInfo& FormatInfo = GPixelFormats[pixelFormat];
+        for (int32 MipIndex = 1; MipIndex < NumMips; ++MipIndex)
+        {
+            FTexture2DMipMap* Mip = new FTexture2DMipMap();
+            Texture2D->PlatformData->Mips.Add(Mip);
+            Mip->SizeX = FMath::Max(Width >> MipIndex, 1);
+            Mip->SizeY = FMath::Max(Height >> MipIndex, 1);
+
+            const int32 NumBlocksX = FMath::DivideAndRoundUp(Mip->SizeX, FormatInfo.BlockSizeX);
+            const int32 NumBlocksY = FMath::DivideAndRoundUp(Mip->SizeY, FormatInfo.BlockSizeY);
+            Mip->BulkData.Lock(LOCK_READ_WRITE);
+            Mip->BulkData.Realloc(NumBlocksX * NumBlocksY * FormatInfo.BlockBytes);
+            Mip->BulkData.Unlock();
+        }
+
         // Update the texture with these new settings
         Texture2D->UpdateResource();
     }
@@ -183,14 +266,304 @@ bool UDynamicTexture::UpdateGpu()
 }
 
 
+bool UDynamicTexture::UpdateRegions(const TArray<FUpdateTextureRegion2D>& Regions, const uint8* SrcData, uint32 SrcPitch)
+{
+	if (!Created || Regions.Num() < 1 || !SrcData)
+		return false;
+
+	UpdateTextureRegionsParams params = {
+		/*Texture = */ Texture2D,
+		/*MipIndex = */ 0,
+		/*NumRegions = */ static_cast<uint32>(Regions.Num()),
+		/*Regions = */ Regions.GetData(),
+		/*SrcPitch = */ SrcPitch,
+		/*SrcBpp = */ sizeof(uint8) * 4,
+		/*SrcData = */ SrcData,
+		/*FreeData = */ false,
+	};
+	UpdateTextureRegions(params, Uploaded);
+	return true;
+}
+
+
+// Past this many rectangles, the dirty area is uploaded as their bounding box
+static const int32 MaxDirtyRectsToMerge = 256;
+
+// Merges rectangles whose union costs no more pixels than uploading them separately, e.g. overlapping
+// or adjacent scanlines, then merges the neighbours that add the least area until MaxRects are left.
+// The rectangles are swept top to bottom, so only those still touching the current row are compared.
+static void MergeDirtyRects(TArray<FIntRect>& Rects, int32 MaxRects)
+{
+	if (Rects.Num() < 2)
+		return;
+
+	if (Rects.Num() > MaxDirtyRectsToMerge)
+	{
+		FIntRect Bounds = Rects[0];
+		for (const FIntRect& Rect : Rects)
+			Bounds.Union(Rect);
+
+		Rects.Reset();
+		Rects.Add(Bounds);
+		return;
+	}
+
+	Rects.Sort([](const FIntRect& A, const FIntRect& B)
+	{
+		return A.Min.Y != B.Min.Y ? A.Min.Y < B.Min.Y : A.Min.X < B.Min.X;
+	});
+
+	TArray<FIntRect> Merged;
+	Merged.Reserve(Rects.Num());
+
+	for (const FIntRect& Rect : Rects)
+	{
+		bool IsMerged = false;
+		for (int32 i = Merged.Num() - 1; i >= 0 && !IsMerged; --i)
+		{
+			// Above the current row, a union would include the gap
+			if (Merged[i].Max.Y < Rect.Min.Y)
+				continue;
+
+			FIntRect Union = Merged[i];
+			Union.Union(Rect);
+			if (Union.Area() <= Merged[i].Area() + Rect.Area())
+			{
+				Merged[i] = Union;
+				IsMerged = true;
+			}
+		}
+
+		if (!IsMerged)
+			Merged.Add(Rect);
+	}
+
+	// Merged stays ordered top to bottom, the closest candidates are neighbours
+	while (Merged.Num() > FMath::Max(1, MaxRects))
+	{
+		int32 Best = 0;
+		int64 BestGrowth = MAX_int64;
+
+		for (int32 i = 0; i + 1 < Merged.Num(); ++i)
+		{
+			FIntRect Union = Merged[i];
+			Union.Union(Merged[i + 1]);
+			const int64 Growth = static_cast<int64>(Union.Area()) - Merged[i].Area() - Merged[i + 1].Area();
+			if (Growth < BestGrowth)
+			{
+				BestGrowth = Growth;
+				Best = i;
+			}
+		}
+
+		Merged[Best].Union(Merged[Best + 1]);
+		Merged.RemoveAt(Best + 1, 1, false);
+	}
+
+	Rects = MoveTemp(Merged);
+}
+
+
+void UDynamicTexture::MarkDirtyRect(int32 X, int32 Y, int32 RectWidth, int32 RectHeight)
+{
+	if (!Created)
+		return;
+
+	FIntRect Rect(X, Y, X + RectWidth, Y + RectHeight);
+	Rect.Clip(FIntRect(0, 0, Width, Height));
+
+	if (Rect.Area() > 0)
+		DirtyRects.Add(Rect);
+}
+
+
+void UDynamicTexture::TakeDirtyRegions(TArray<FUpdateTextureRegion2D>& OutRegions)
+{
+	MergeDirtyRects(DirtyRects, MaxDirtyRegions);
+
+	int64 DirtyArea = 0;
+	for (const FIntRect& Rect : DirtyRects)
+		DirtyArea += Rect.Area();
+
+	OutRegions.Reset();
+	if (DirtyRects.Num() < 1 || DirtyArea >= static_cast<int64>(Width) * Height * FullUploadDirtyRatio)
+	{
+		OutRegions.Add(UpdateTextureRegion);
+	}
+	else
+	{
+		for (const FIntRect& Rect : DirtyRects)
+			OutRegions.Add(FUpdateTextureRegion2D(Rect.Min.X, Rect.Min.Y, Rect.Min.X, Rect.Min.Y, Rect.Width(), Rect.Height()));
+	}
+
+	DirtyRects.Reset();
+}
+
+
+bool UDynamicTexture::UpdateDirtyGpu()
+{
+	if (!Created || !Pixels || DirtyRects.Num() < 1)
+		return false;
+
+	TArray<FUpdateTextureRegion2D> Regions;
+	TakeDirtyRegions(Regions);
+
+	return UpdateRegions(Regions, Pixels->GetData(), static_cast<uint32>(Width * sizeof(uint8) * 4));
+}
+
+
+bool UDynamicTexture::DetachStagingBuffers(TArray<TUniquePtr<FDynamicTextureStagingBuffer>>& OutBuffers)
+{
+	for (const TUniquePtr<FDynamicTextureStagingBuffer>& Buffer : StagingBuffers)
+	{
+		if (Buffer->State == FDynamicTextureStagingBuffer::Acquired)
+			return false;
+	}
+
+	OutBuffers = MoveTemp(StagingBuffers);
+	StagingBuffers.Reset();
+	return true;
+}
+
+
+bool UDynamicTexture::SetStagingBufferCount(int32 Count)
+{
+	TArray<TUniquePtr<FDynamicTextureStagingBuffer>> OldBuffers;
+	{
+		FScopeLock Lock(&StagingMutex);
+		if (!DetachStagingBuffers(OldBuffers))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("UDynamicTexture::SetStagingBufferCount: A staging buffer is still acquired"));
+			return false;
+		}
+
+		// The ring is rebuilt at the new count by the next acquisition
+		StagingBufferCount = FMath::Max(1, Count);
+	}
+
+	// Buffers still being uploaded must not go away under the render thread, flushed without blocking producers
+	if (OldBuffers.Num() > 0)
+	{
+		FlushRenderingCommands();
+		OldBuffers.Empty();
+	}
+	return true;
+}
+
+
+uint8* UDynamicTexture::AcquireStagingBuffer(int32& OutIndex)
+{
+	OutIndex = INDEX_NONE;
+
+	FScopeLock Lock(&StagingMutex);
+
+	if (!Created)
+		return nullptr;
+
+	if (StagingBuffers.Num() == 0)
+	{
+		StagingBuffers.Reserve(StagingBufferCount);
+		for (int32 Idx = 0; Idx < StagingBufferCount; ++Idx)
+			StagingBuffers.Add(MakeUnique<FDynamicTextureStagingBuffer>());
+	}
+
+	// Round robin, so that the buffer that has been uploading the longest is tried first
+	const int32 Start = NextStagingBuffer.Increment();
+	for (int32 Offset = 0; Offset < StagingBuffers.Num(); ++Offset)
+	{
+		const int32 Idx = (Start + Offset) % StagingBuffers.Num();
+		FDynamicTextureStagingBuffer* Buffer = StagingBuffers[Idx].Get();
+
+		if (FPlatformAtomics::InterlockedCompareExchange(&Buffer->State, FDynamicTextureStagingBuffer::Acquired, FDynamicTextureStagingBuffer::Free) != FDynamicTextureStagingBuffer::Free)
+			continue;
+
+		const int32 Size = Width * Height * 4;
+		if (Buffer->Data.Num() != Size)
+			Buffer->Data.SetNumUninitialized(Size);
+
+		OutIndex = Idx;
+		return Buffer->Data.GetData();
+	}
+
+	return nullptr;
+}
+
+
+bool UDynamicTexture::SubmitStagingBuffer(int32 Index)
+{
+	FScopeLock Lock(&StagingMutex);
+
+	if (!StagingBuffers.IsValidIndex(Index) || StagingBuffers[Index]->State != FDynamicTextureStagingBuffer::Acquired)
+		return false;
+
+	FDynamicTextureStagingBuffer* Buffer = StagingBuffers[Index].Get();
+
+	if (!Created)
+	{
+		ReleaseStagingBuffer(Index);
+		return false;
+	}
+
+	TArray<FUpdateTextureRegion2D> Regions;
+	TakeDirtyRegions(Regions);
+
+	Buffer->State = FDynamicTextureStagingBuffer::Uploading;
+
+	UpdateTextureRegionsParams params = {
+		/*Texture = */ Texture2D,
+		/*MipIndex = */ 0,
+		/*NumRegions = */ static_cast<uint32>(Regions.Num()),
+		/*Regions = */ Regions.GetData(),
+		/*SrcPitch = */ static_cast<uint32>(Width * sizeof(uint8) * 4),
+		/*SrcBpp = */ sizeof(uint8) * 4,
+		/*SrcData = */ Buffer->Data.GetData(),
+		/*FreeData = */ false,
+		/*OnUploaded = */ [Buffer]() { FPlatformAtomics::InterlockedExchange(&Buffer->State, FDynamicTextureStagingBuffer::Free); },
+	};
+
+	if (!UpdateTextureRegions(params, Uploaded))
+	{
+		ReleaseStagingBuffer(Index);
+		return false;
+	}
+	return true;
+}
+
+
+void UDynamicTexture::ReleaseStagingBuffer(int32 Index)
+{
+	FScopeLock Lock(&StagingMutex);
+
+	if (StagingBuffers.IsValidIndex(Index))
+		FPlatformAtomics::InterlockedExchange(&StagingBuffers[Index]->State, FDynamicTextureStagingBuffer::Free);
+}
+
+
+bool UDynamicTexture::UpdateFromSource(const uint8* Src, int32 SrcPitch, ESourcePixelLayout Layout, bool PremultiplyAlpha)
+{
+	if (!Created || !Src || Texture2D->GetPixelFormat() != EPixelFormat::PF_B8G8R8A8)
+		return false;
+
+	int32 Index = INDEX_NONE;
+	uint8* Staging = AcquireStagingBuffer(Index);
+	if (!Staging)
+		return false;
+
+	FPixelFormatConversion::ConvertToBGRA8(Src, SrcPitch, Layout, Width, Height, Staging, Width * 4, PremultiplyAlpha);
+	return SubmitStagingBuffer(Index);
+}
+
+
 bool UDynamicTexture::UpdateRandomGpu()
 {
     static float gTime = 0.f;
 	if (Created)
 	{
 		gTime += 0.1f;
-		uint8* px = new uint8[Width * Height * 4];
-		UDynamicTexture::RandomTexture(gTime, Width, Height, px);
+
+		// Returned to the pool by the render command, once the upload has read it
+		TArray<uint8>* px = FUploadBufferPool::Get().Acquire(Width * Height * 4);
+		UDynamicTexture::RandomTexture(gTime, Width, Height, px->GetData());
 
 		UpdateTextureRegionsParams params = {
 			/*Texture = */ Texture2D,
@@ -199,13 +572,16 @@ bool UDynamicTexture::UpdateRandomGpu()
 			/*Regions = */ &UpdateTextureRegion,
 			/*SrcPitch = */ static_cast<uint32>(Width * sizeof(uint8) * 4),
 			/*SrcBpp = */ sizeof(uint8) * 4,
-			///*SrcData = */ reinterpret_cast<const uint8*>(Pixels->GetData()),
-			/*SrcData = */ px,
+			/*SrcData = */ px->GetData(),
 			/*FreeData = */ false,
+			/*OnUploaded = */ [px]() { FUploadBufferPool::Get().Release(px); },
 		};
-		UpdateTextureRegions(params, Uploaded);
 
-		delete[] px;
+		if (!UpdateTextureRegions(params, Uploaded))
+		{
+			FUploadBufferPool::Get().Release(px);
+			return false;
+		}
 
 		return true;
 	}
@@ -214,6 +590,73 @@ bool UDynamicTexture::UpdateRandomGpu()
 }
 
 
+bool UDynamicTexture::StartIngest(int32 Capacity)
+{
+	if (!Created || !Texture2D || !Texture2D->Resource)
+		return false;
+
+	StopIngest();
+
+	TSharedPtr<FDynamicTextureIngest, ESPMode::ThreadSafe> NewIngest = MakeShared<FDynamicTextureIngest, ESPMode::ThreadSafe>(
+		Capacity, static_cast<FTexture2DResource*>(Texture2D->Resource), Width, Height, Texture2D->GetPixelFormat());
+	ENQUEUE_RENDER_COMMAND(RegisterDynamicTextureIngest)([NewIngest](FRHICommandListImmediate& RHICmdList)
+		{
+			NewIngest->Register();
+		});
+
+	FScopeLock Lock(&IngestMutex);
+	Ingest = NewIngest;
+	return true;
+}
+
+
+void UDynamicTexture::StopIngest()
+{
+	TSharedPtr<FDynamicTextureIngest, ESPMode::ThreadSafe> OldIngest;
+	{
+		FScopeLock Lock(&IngestMutex);
+		OldIngest = MoveTemp(Ingest);
+		Ingest.Reset();
+	}
+
+	if (!OldIngest.IsValid())
+		return;
+
+	// A producer still pushing holds its own reference, the last one deletes the ingest
+	ENQUEUE_RENDER_COMMAND(UnregisterDynamicTextureIngest)([OldIngest](FRHICommandListImmediate& RHICmdList)
+		{
+			OldIngest->Unregister();
+			OldIngest->ReleaseQueuedFrames();
+		});
+}
+
+
+bool UDynamicTexture::PushFrame(const FDynamicTextureFrame& Frame)
+{
+	TSharedPtr<FDynamicTextureIngest, ESPMode::ThreadSafe> CurrentIngest;
+	{
+		FScopeLock Lock(&IngestMutex);
+		CurrentIngest = Ingest;
+	}
+	return CurrentIngest.IsValid() && CurrentIngest->PushFrame(Frame);
+}
+
+
+bool UDynamicTexture::GetIngestStats(FDynamicTextureIngestStats& OutStats) const
+{
+	TSharedPtr<FDynamicTextureIngest, ESPMode::ThreadSafe> CurrentIngest;
+	{
+		FScopeLock Lock(&IngestMutex);
+		CurrentIngest = Ingest;
+	}
+	if (!CurrentIngest.IsValid())
+		return false;
+
+	OutStats = CurrentIngest->GetStats();
+	return true;
+}
+
+
 void UDynamicTexture::UpdatePixels(const TArray<uint8>& PixelData)
 {
     Pixels = &PixelData;
@@ -221,40 +664,104 @@ void UDynamicTexture::UpdatePixels(const TArray<uint8>& PixelData)
 
 
 
+// Parabolic sine approximation for X in [-PI, PI], absolute error below 0.0011
+static FORCEINLINE float FastSinReduced(float X)
+{
+	const float Y = (4.0f / PI) * X - (4.0f / (PI * PI)) * X * FMath::Abs(X);
+	return 0.225f * (Y * FMath::Abs(Y) - Y) + Y;
+}
+
+static FORCEINLINE float FastSin(float X)
+{
+	return FastSinReduced(X - (2.0f * PI) * FMath::RoundToFloat(X * (1.0f / (2.0f * PI))));
+}
+
+#if PLATFORM_CPU_X86_FAMILY
+static FORCEINLINE __m128 FastSin4(__m128 X)
+{
+	const __m128 SignMask = _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+
+	// Range reduction to [-PI, PI], the conversion rounds to nearest
+	const __m128 Turns = _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(X, _mm_set1_ps(1.0f / (2.0f * PI)))));
+	X = _mm_sub_ps(X, _mm_mul_ps(Turns, _mm_set1_ps(2.0f * PI)));
+
+	const __m128 AbsX = _mm_andnot_ps(SignMask, X);
+	__m128 Y = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(4.0f / PI), X), _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(4.0f / (PI * PI)), X), AbsX));
+
+	const __m128 AbsY = _mm_andnot_ps(SignMask, Y);
+	return _mm_add_ps(_mm_mul_ps(_mm_set1_ps(0.225f), _mm_sub_ps(_mm_mul_ps(Y, AbsY), Y)), Y);
+}
+#endif
+
+// Output of the plasma sum S of four sines in [-4, 4], as the original int(4 * 127 + 127 * S) / 4
+static FORCEINLINE uint8 PlasmaValue(float Sum)
+{
+	return static_cast<uint8>(FMath::Clamp(static_cast<int32>(508.0f + 127.0f * Sum) >> 2, 0, 255));
+}
+
 void UDynamicTexture::RandomTexture(float Time, int Width, int Height, uint8* Pixels)
 {
-    //Time += 0.1f;
-    
-    const float t = Time;
+	// Simple "plasma effect": several combined sine waves.
+	// The terms in x, y and x + y come from tables, only the radial term is evaluated per pixel,
+	// with a fast sine that keeps the output within 1 of the exact version.
+	const float t = Time;
 
-    int textureRowPitch = Width * 4;	// 4 bpp
+	TArray<float> SinX;
+	SinX.SetNumUninitialized(Width + 4);
+	for (int32 x = 0; x < Width; ++x)
+		SinX[x] = sinf(x / 7.0f + t);
 
-    unsigned char* dst = (unsigned char*)Pixels;
+	TArray<float> SinXY;
+	SinXY.SetNumUninitialized(Width + Height + 4);
+	for (int32 i = 0; i < Width + Height; ++i)
+		SinXY[i] = sinf(i / 6.0f - t);
 
-    for (int y = 0; y < Height; ++y)
-    {
-        unsigned char* ptr = dst;
-        for (int x = 0; x < Width; ++x)
-        {
-            // Simple "plasma effect": several combined sine waves
-            int vv = int((127.0f + (127.0f * sinf(x / 7.0f + t))) + (127.0f + (127.0f * sinf(y / 5.0f - t))) +
-                (127.0f + (127.0f * sinf((x + y) / 6.0f - t))) +
-                (127.0f + (127.0f * sinf(sqrtf(float(x * x + y * y)) / 4.0f - t)))) /
-                4;
-
-            // Write the texture pixel
-            ptr[0] = vv;
-            ptr[1] = vv;
-            ptr[2] = vv;
-            ptr[3] = vv;
-
-            // To next pixel (our pixels are 4 bpp)
-            ptr += 4;
-        }
+	const int32 textureRowPitch = Width * 4;	// 4 bpp
 
-        // To next image row
-        dst += textureRowPitch;
-    }
+	ParallelFor(Height, [&](int32 y)
+	{
+		const float SinY = sinf(y / 5.0f - t);
+		const float* SinXYRow = SinXY.GetData() + y;
+		uint32* dst = reinterpret_cast<uint32*>(Pixels + y * textureRowPitch);
+		const float YSquared = static_cast<float>(y * y);
+
+		int32 x = 0;
+
+#if PLATFORM_CPU_X86_FAMILY
+		const __m128 SinY4 = _mm_set1_ps(SinY);
+		const __m128 YSquared4 = _mm_set1_ps(YSquared);
+		const __m128 Time4 = _mm_set1_ps(t);
+		__m128 X4 = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+
+		for (; x + 4 <= Width; x += 4)
+		{
+			const __m128 Radius = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(X4, X4), YSquared4));
+			const __m128 Radial = FastSin4(_mm_sub_ps(_mm_mul_ps(Radius, _mm_set1_ps(0.25f)), Time4));
+
+			__m128 Sum = _mm_add_ps(_mm_loadu_ps(SinX.GetData() + x), _mm_loadu_ps(SinXYRow + x));
+			Sum = _mm_add_ps(_mm_add_ps(Sum, SinY4), Radial);
+
+			__m128i V = _mm_srai_epi32(_mm_cvttps_epi32(_mm_add_ps(_mm_set1_ps(508.0f), _mm_mul_ps(_mm_set1_ps(127.0f), Sum))), 2);
+
+			// Saturates to 16 then to 8 bits, which clamps to [0, 255], the four values land in the low bytes
+			V = _mm_packus_epi16(_mm_packs_epi32(V, V), _mm_setzero_si128());
+
+			// Same value in all four channels
+			V = _mm_unpacklo_epi8(V, V);
+			V = _mm_unpacklo_epi16(V, V);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), V);
+
+			X4 = _mm_add_ps(X4, _mm_set1_ps(4.0f));
+		}
+#endif
+
+		for (; x < Width; ++x)
+		{
+			const float Radial = FastSin(sqrtf(static_cast<float>(x * x) + YSquared) / 4.0f - t);
+			const uint32 vv = PlasmaValue(SinX[x] + SinY + SinXYRow[x] + Radial);
+			dst[x] = vv | (vv << 8) | (vv << 16) | (vv << 24);
+		}
+	});
 }
 
 
@@ -284,27 +791,70 @@ bool UDynamicTexture::Load(FString ImagePath)
 		return false;
 	}
 
-	int bpp = (image.get_format_dxt() == nv_dds::DXT5) ? 4 : 3;
+	const EPixelFormat PixelFormat = (image.get_format_dxt() == nv_dds::DXT5) ? EPixelFormat::PF_DXT5 : EPixelFormat::PF_DXT1;
+	const FPixelFormatInfo& FormatInfo = GPixelFormats[PixelFormat];
 
-	CreateResource(image.get_width(), image.get_height(), (image.get_format_dxt() == nv_dds::DXT5) ? EPixelFormat::PF_DXT5 : EPixelFormat::PF_DXT1);
+	// nv_dds keeps the base level as the image surface and the smaller levels as its mipmaps
+	const nv_dds::CTexture& BaseSurface = image.get_surface(0);
+	const int32 NumMips = 1 + BaseSurface.get_num_mipmaps();
 
+	if (!CreateResource(image.get_width(), image.get_height(), PixelFormat, TextureAddress::TA_Wrap, NumMips))
+		return false;
 
-	if (Created)
+	auto GetLevel = [&BaseSurface](int32 MipIndex) -> const nv_dds::CSurface&
+	{
+		return (MipIndex == 0) ? BaseSurface : BaseSurface.get_mipmap(MipIndex - 1);
+	};
+
+	// All levels are copied into one pooled buffer, since the image is gone before the render thread uploads them
+	const int32 NumTextureMips = Texture2D->GetNumMips();
+	TArray<uint32> MipOffsets;
+	uint32 TotalSize = 0;
+	for (int32 MipIndex = 0; MipIndex < NumTextureMips; ++MipIndex)
 	{
-		
+		MipOffsets.Add(TotalSize);
+		TotalSize += GetLevel(MipIndex).get_size();
+	}
+
+	TArray<uint8>* Data = FUploadBufferPool::Get().Acquire(TotalSize);
+	for (int32 MipIndex = 0; MipIndex < NumTextureMips; ++MipIndex)
+	{
+		const nv_dds::CSurface& Level = GetLevel(MipIndex);
+		FMemory::Memcpy(Data->GetData() + MipOffsets[MipIndex], static_cast<uint8_t*>(Level), Level.get_size());
+	}
+
+	// Render commands run in order, so the upload of the last level returns the buffer
+	bool Enqueued = false;
+	for (int32 MipIndex = 0; MipIndex < NumTextureMips; ++MipIndex)
+	{
+		const nv_dds::CSurface& Level = GetLevel(MipIndex);
+		const FUpdateTextureRegion2D MipRegion(0, 0, 0, 0, Level.get_width(), Level.get_height());
+		const bool LastMip = (MipIndex == NumTextureMips - 1);
+
 		UpdateTextureRegionsParams params = {
 			/*Texture = */ Texture2D,
-			/*MipIndex = */ 0,
+			/*MipIndex = */ MipIndex,
 			/*NumRegions = */ 1,
-			/*Regions = */ &UpdateTextureRegion,
-			/*SrcPitch = */ static_cast<uint32>(image.get_width() * sizeof(uint8) * bpp),
-			/*SrcBpp = */ sizeof(uint8) * bpp,
-			/*SrcData = */ image,
+			/*Regions = */ &MipRegion,
+			/*SrcPitch = */ static_cast<uint32>(FMath::DivideAndRoundUp<int32>(Level.get_width(), FormatInfo.BlockSizeX) * FormatInfo.BlockBytes),
+			/*SrcBpp = */ static_cast<uint32>(FormatInfo.BlockBytes),
+			/*SrcData = */ Data->GetData() + MipOffsets[MipIndex],
 			/*FreeData = */ false,
+			/*OnUploaded = */ LastMip ? TFunction<void()>([Data]() { FUploadBufferPool::Get().Release(Data); }) : TFunction<void()>(),
 		};
-		UpdateTextureRegions(params, Uploaded);
-		return true;
+		Enqueued = UpdateTextureRegions(params, Uploaded);
+
+		if (!Enqueued)
+			break;
 	}
 
-	return false;
-}
\ No newline at end of file
+	if (!Enqueued)
+	{
+		// Commands that did get enqueued still read from the buffer
+		FlushRenderingCommands();
+		FUploadBufferPool::Get().Release(Data);
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,164 @@
+#include "DynamicTextureIngest.h"
+#include "ImageLoaderStats.h"
+#include "TextureResource.h"
+#include "RHI.h"
+
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Ingest Frames Presented"), STAT_IngestFramesPresented, STATGROUP_ImageLoader);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Ingest Frames Dropped"), STAT_IngestFramesDropped, STATGROUP_ImageLoader);
+
+
+FDynamicTextureIngest::FDynamicTextureIngest(int32 Capacity, FTexture2DResource* InResource, int32 InWidth, int32 InHeight, EPixelFormat InFormat)
+	// Registered by the owner on the render thread
+	: FTickableObjectRenderThread(false, false)
+	, Slots(MakeUnique<FSlot[]>(FMath::Max(2, Capacity)))
+	, NumSlots(FMath::Max(2, Capacity))
+	, MinPitch(FMath::DivideAndRoundUp(InWidth, GPixelFormats[InFormat].BlockSizeX) * GPixelFormats[InFormat].BlockBytes)
+	, Resource(InResource)
+	, Width(InWidth)
+	, Height(InHeight)
+	, Format(InFormat)
+{
+	for (uint64 Position = 0; Position < NumSlots; ++Position)
+		Slots[Position].Sequence = Position;
+}
+
+FDynamicTextureIngest::~FDynamicTextureIngest()
+{
+	ReleaseQueuedFrames();
+}
+
+void FDynamicTextureIngest::ReleaseQueuedFrames()
+{
+	FDynamicTextureFrame Frame;
+	while (Dequeue(Frame))
+		Release(Frame);
+}
+
+bool FDynamicTextureIngest::PushFrame(FDynamicTextureFrame Frame)
+{
+	if (!Frame.Data || Frame.Format != Format || Frame.Pitch < MinPitch)
+	{
+		Rejected.Increment();
+		return false;
+	}
+
+	// Producers race for a position, the one that moves PushPosition past it owns the slot
+	uint64 Position = PushPosition.Load();
+	FSlot* Slot = nullptr;
+	for (;;)
+	{
+		Slot = &Slots[Position % NumSlots];
+		const int64 Lap = static_cast<int64>(Slot->Sequence.Load() - Position);
+
+		if (Lap == 0)
+		{
+			if (PushPosition.CompareExchange(Position, Position + 1))
+				break;
+		}
+		else if (Lap < 0)
+		{
+			// The consumer has not taken the frame pushed there a lap earlier, the ring is full
+			Rejected.Increment();
+			return false;
+		}
+		else
+		{
+			Position = PushPosition.Load();
+		}
+	}
+
+	Frame.PushCycles = FPlatformTime::Cycles64();
+	Slot->Frame = MoveTemp(Frame);
+
+	// Publishes the frame to the consumer
+	Slot->Sequence = Position + 1;
+	return true;
+}
+
+bool FDynamicTextureIngest::Dequeue(FDynamicTextureFrame& OutFrame)
+{
+	FSlot& Slot = Slots[PopPosition % NumSlots];
+
+	// A producer that has claimed the slot but not written it yet holds back the later frames, it is close to done
+	if (Slot.Sequence.Load() != PopPosition + 1)
+		return false;
+
+	OutFrame = MoveTemp(Slot.Frame);
+	Slot.Frame = FDynamicTextureFrame();
+
+	// Frees the slot for the position a lap later
+	Slot.Sequence = PopPosition + NumSlots;
+	++PopPosition;
+	return true;
+}
+
+FDynamicTextureIngestStats FDynamicTextureIngest::GetStats() const
+{
+	FDynamicTextureIngestStats Stats;
+	Stats.Presented = Presented.GetValue();
+	Stats.Dropped = Dropped.GetValue();
+	Stats.Rejected = Rejected.GetValue();
+	Stats.LastLatencyMs = LastLatencyUs.GetValue() / 1000.0f;
+	Stats.MaxLatencyMs = MaxLatencyUs.GetValue() / 1000.0f;
+	return Stats;
+}
+
+TStatId FDynamicTextureIngest::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(FDynamicTextureIngest, STATGROUP_Tickables);
+}
+
+void FDynamicTextureIngest::Release(FDynamicTextureFrame& Frame)
+{
+	if (Frame.OnReleased)
+		Frame.OnReleased();
+	Frame = FDynamicTextureFrame();
+}
+
+void FDynamicTextureIngest::Tick(float DeltaTime)
+{
+	check(IsInRenderingThread());
+
+	// Only the newest frame is presented, older ones are stale by now
+	FDynamicTextureFrame Newest;
+	FDynamicTextureFrame Frame;
+	bool HasFrame = false;
+
+	while (Dequeue(Frame))
+	{
+		if (HasFrame)
+		{
+			Release(Newest);
+			Dropped.Increment();
+			INC_DWORD_STAT(STAT_IngestFramesDropped);
+		}
+		Newest = MoveTemp(Frame);
+		HasFrame = true;
+	}
+
+	if (!HasFrame)
+		return;
+
+	if (Newest.Format != Format || !Newest.Data || Newest.Pitch < MinPitch || !Resource || !Resource->GetTexture2DRHI())
+	{
+		Release(Newest);
+		Dropped.Increment();
+		INC_DWORD_STAT(STAT_IngestFramesDropped);
+		return;
+	}
+
+	// The RHI copies the source data, so the frame can be released right after
+	const FUpdateTextureRegion2D Region(0, 0, 0, 0, Width, Height);
+	RHIUpdateTexture2D(Resource->GetTexture2DRHI(), 0, Region, Newest.Pitch, Newest.Data);
+
+	const int32 LatencyUs = static_cast<int32>(FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - Newest.PushCycles) * 1000.0);
+	LastLatencyUs.Set(LatencyUs);
+	if (LatencyUs > MaxLatencyUs.GetValue())
+		MaxLatencyUs.Set(LatencyUs);
+
+	Presented.Increment();
+	INC_DWORD_STAT(STAT_IngestFramesPresented);
+
+	Release(Newest);
+}
@@ -0,0 +1,185 @@
+#include "EncryptedImageFile.h"
+#include "LicenseValidator.h"
+#include "EncryptionContextOpenSSL.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+THIRD_PARTY_INCLUDES_START
+#include <openssl/rand.h>
+THIRD_PARTY_INCLUDES_END
+
+
+static const uint32 EncryptedImageTag = 0x43454C49; // 'ILEC'
+static const int32 EncryptedImageIvSize = 16;
+static const int32 EncryptedImageHeaderSize = sizeof(uint32) + EncryptedImageIvSize;
+static const int32 AesBlockSize = 16;
+
+// Large enough to amortize the read and decrypt calls, small enough to stay in cache between them
+static const int32 DecryptChunkSize = 256 * 1024;
+
+// Frames loaded while the license is being validated, e.g. at startup, wait this long for the verdict
+static const float LicenseWaitSeconds = 10.0f;
+
+
+bool FEncryptedImageFile::IsEncrypted(const FString& Path)
+{
+	return Path.EndsWith(TEXT(".enc"), ESearchCase::IgnoreCase);
+}
+
+FString FEncryptedImageFile::GetImagePath(const FString& Path)
+{
+	return IsEncrypted(Path) ? Path.LeftChop(4) : Path;
+}
+
+
+bool FEncryptedImageFile::DecryptChunks(const uint8* Iv, int64 CipherSize, TFunctionRef<const uint8*(int64 Offset, int32 Size)> ReadChunk, const FString& Path, TArray<uint8>& OutData)
+{
+	if (CipherSize <= 0 || CipherSize % AesBlockSize != 0 || CipherSize > MAX_int32 - AesBlockSize)
+	{
+		UE_LOG(LogTemp, Error, TEXT("FEncryptedImageFile: Invalid ciphertext size in %s"), *Path);
+		return false;
+	}
+
+	// Worker threads wait for a validation in progress, the game thread is not blocked on it
+	FLicenseValidator& Validator = FLicenseValidator::Get();
+	if (Validator.GetStatus() == ELicenseStatus::Pending && !IsInGameThread() && !Validator.WaitForValidation(LicenseWaitSeconds))
+	{
+		UE_LOG(LogTemp, Error, TEXT("FEncryptedImageFile: The license is still being validated, could not decrypt %s"), *Path);
+		return false;
+	}
+
+	TArray<uint8> Key;
+	if (!Validator.GetContentKey(Key))
+	{
+		UE_LOG(LogTemp, Error, TEXT("FEncryptedImageFile: No valid license to decrypt %s"), *Path);
+		return false;
+	}
+
+	EPlatformCryptoResult Result = EPlatformCryptoResult::Failure;
+	FEncryptionContextOpenSSL OpenSslCtx;
+	TUniquePtr<IPlatformCryptoDecryptor> Decryptor = OpenSslCtx.CreateDecryptor_AES_256_CBC(Key, MakeArrayView(Iv, EncryptedImageIvSize), Result);
+	if (!Decryptor.IsValid() || Result != EPlatformCryptoResult::Success)
+	{
+		UE_LOG(LogTemp, Error, TEXT("FEncryptedImageFile: Could not create the decryptor for %s"), *Path);
+		return false;
+	}
+
+	// The plaintext is never longer than the ciphertext. The extra block is the room the decryptor asks for per update.
+	OutData.SetNumUninitialized(static_cast<int32>(CipherSize) + AesBlockSize);
+	int32 Written = 0;
+
+	for (int64 Offset = 0; Offset < CipherSize; Offset += DecryptChunkSize)
+	{
+		const int32 Size = static_cast<int32>(FMath::Min<int64>(DecryptChunkSize, CipherSize - Offset));
+		const uint8* Chunk = ReadChunk(Offset, Size);
+		if (!Chunk)
+		{
+			UE_LOG(LogTemp, Error, TEXT("FEncryptedImageFile: Failed to read %s"), *Path);
+			return false;
+		}
+
+		int32 ChunkWritten = 0;
+		if (Decryptor->Update(MakeArrayView(Chunk, Size), MakeArrayView(OutData.GetData() + Written, OutData.Num() - Written), ChunkWritten) != EPlatformCryptoResult::Success)
+		{
+			UE_LOG(LogTemp, Error, TEXT("FEncryptedImageFile: Failed to decrypt %s"), *Path);
+			return false;
+		}
+		Written += ChunkWritten;
+	}
+
+	// Checks and strips the padding, which fails for a wrong key
+	int32 FinalWritten = 0;
+	if (Decryptor->Finalize(MakeArrayView(OutData.GetData() + Written, OutData.Num() - Written), FinalWritten) != EPlatformCryptoResult::Success)
+	{
+		UE_LOG(LogTemp, Error, TEXT("FEncryptedImageFile: Failed to decrypt %s, the key may not match"), *Path);
+		return false;
+	}
+
+	OutData.SetNum(Written + FinalWritten, false);
+	return true;
+}
+
+
+bool FEncryptedImageFile::ReadFile(const FString& Path, TArray<uint8>& OutData)
+{
+	TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*Path));
+	if (!Reader)
+	{
+		UE_LOG(LogTemp, Error, TEXT("FEncryptedImageFile: File not found: %s"), *Path);
+		return false;
+	}
+
+	uint32 Tag = 0;
+	uint8 Iv[EncryptedImageIvSize];
+	*Reader << Tag;
+	Reader->Serialize(Iv, EncryptedImageIvSize);
+	if (Reader->IsError() || Tag != EncryptedImageTag)
+	{
+		UE_LOG(LogTemp, Error, TEXT("FEncryptedImageFile: Not an encrypted image: %s"), *Path);
+		return false;
+	}
+
+	// Each chunk is decrypted right after it is read, while it is still in cache
+	TArray<uint8> Chunk;
+	Chunk.SetNumUninitialized(DecryptChunkSize);
+	FArchive& Ar = *Reader;
+
+	return DecryptChunks(Iv, Ar.TotalSize() - EncryptedImageHeaderSize, [&Ar, &Chunk](int64 Offset, int32 Size) -> const uint8*
+	{
+		Ar.Serialize(Chunk.GetData(), Size);
+		return Ar.IsError() ? nullptr : Chunk.GetData();
+	}, Path, OutData);
+}
+
+
+bool FEncryptedImageFile::Decrypt(const TArray<uint8>& FileData, const FString& Path, TArray<uint8>& OutData)
+{
+	if (FileData.Num() < EncryptedImageHeaderSize || FMemory::Memcmp(FileData.GetData(), &EncryptedImageTag, sizeof(uint32)) != 0)
+	{
+		UE_LOG(LogTemp, Error, TEXT("FEncryptedImageFile: Not an encrypted image: %s"), *Path);
+		return false;
+	}
+
+	const uint8* Ciphertext = FileData.GetData() + EncryptedImageHeaderSize;
+	return DecryptChunks(FileData.GetData() + sizeof(uint32), FileData.Num() - EncryptedImageHeaderSize, [Ciphertext](int64 Offset, int32 Size)
+	{
+		return Ciphertext + Offset;
+	}, Path, OutData);
+}
+
+
+bool FEncryptedImageFile::EncryptFile(const FString& SourcePath, const FString& EncryptedPath, const TArray<uint8>& Key)
+{
+	TArray<uint8> Source;
+	if (!FFileHelper::LoadFileToArray(Source, *SourcePath))
+	{
+		UE_LOG(LogTemp, Error, TEXT("FEncryptedImageFile: Failed to load file: %s"), *SourcePath);
+		return false;
+	}
+
+	// CBC needs an unpredictable IV, from the cryptographic generator
+	TArray<uint8> Iv;
+	Iv.SetNumUninitialized(EncryptedImageIvSize);
+	if (RAND_bytes(Iv.GetData(), EncryptedImageIvSize) != 1)
+	{
+		UE_LOG(LogTemp, Error, TEXT("FEncryptedImageFile: Could not generate an IV for %s"), *SourcePath);
+		return false;
+	}
+
+	EPlatformCryptoResult Result = EPlatformCryptoResult::Failure;
+	FEncryptionContextOpenSSL OpenSslCtx;
+	const TArray<uint8> Encrypted = OpenSslCtx.Encrypt_AES_256_CBC(Source, Key, Iv, Result);
+	if (Result != EPlatformCryptoResult::Success)
+	{
+		UE_LOG(LogTemp, Error, TEXT("FEncryptedImageFile: Failed to encrypt %s"), *SourcePath);
+		return false;
+	}
+
+	TArray<uint8> FileData;
+	FileData.Reserve(EncryptedImageHeaderSize + Encrypted.Num());
+	FileData.Append(reinterpret_cast<const uint8*>(&EncryptedImageTag), sizeof(uint32));
+	FileData.Append(Iv);
+	FileData.Append(Encrypted);
+	return FFileHelper::SaveArrayToFile(FileData, *EncryptedPath);
+}
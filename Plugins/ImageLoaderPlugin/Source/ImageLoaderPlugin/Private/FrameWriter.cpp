@@ -0,0 +1,372 @@
+#include "FrameWriter.h"
+#include "ImageLoaderStats.h"
+#include "UploadBufferPool.h"
+#include "PixelFormatConversion.h"
+#include "Engine/Texture2D.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "TextureResource.h"
+#include "RenderingThread.h"
+#include "RHI.h"
+#include "Math/Float16Color.h"
+#include "Async/Async.h"
+#include "HAL/FileManager.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "IImageWrapperModule.h"
+#include "IImageWrapper.h"
+#include "nv_dds.h"
+
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Frame Writer Pending"), STAT_FrameWriterPending, STATGROUP_ImageLoader);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Frame Writer Frames Written"), STAT_FrameWriterWritten, STATGROUP_ImageLoader);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Frame Writer Frames Dropped"), STAT_FrameWriterDropped, STATGROUP_ImageLoader);
+
+// Loaded on the game thread, the encoders only use it
+static IImageWrapperModule* FrameWriterImageWrapper = nullptr;
+
+
+// Owned by the module, so it is gone before the engine shuts down rather than destroyed with the statics
+static TUniquePtr<FFrameWriter> WriterInstance;
+
+FFrameWriter& FFrameWriter::Get()
+{
+	check(WriterInstance.IsValid());
+	return *WriterInstance;
+}
+
+bool FFrameWriter::IsAvailable()
+{
+	return WriterInstance.IsValid();
+}
+
+void FFrameWriter::Startup()
+{
+	if (!WriterInstance.IsValid())
+		WriterInstance = TUniquePtr<FFrameWriter>(new FFrameWriter());
+}
+
+void FFrameWriter::Shutdown()
+{
+	WriterInstance.Reset();
+}
+
+FFrameWriter::FFrameWriter()
+{
+	// The staging textures must go before the RHI shuts down, which is before the module shuts down on exit
+	EnginePreExitHandle = FCoreDelegates::OnEnginePreExit.AddRaw(this, &FFrameWriter::ReleaseResources);
+}
+
+FFrameWriter::~FFrameWriter()
+{
+	// Unloaded before the engine exits, the RHI is still alive
+	if (EnginePreExitHandle.IsValid())
+		ReleaseResources();
+}
+
+bool FFrameWriter::IsSupportedFormat(EPixelFormat PixelFormat)
+{
+	return PixelFormat == PF_B8G8R8A8 || PixelFormat == PF_R8G8B8A8 || PixelFormat == PF_FloatRGBA;
+}
+
+void FFrameWriter::SetQueueLimits(int32 InMaxReadbacks, int32 InMaxEncodes)
+{
+	MaxReadbacks = FMath::Max(1, InMaxReadbacks);
+	MaxEncodes = FMath::Max(1, InMaxEncodes);
+}
+
+
+bool FFrameWriter::WriteFrame(UTexture* Texture, const FString& FilePath, EFrameFileFormat Format)
+{
+	check(IsInGameThread());
+
+	FTextureResource* Resource = Texture ? Texture->Resource : nullptr;
+	if (!Resource)
+	{
+		UE_LOG(LogTemp, Error, TEXT("FFrameWriter: No texture to write to %s"), *FilePath);
+		return false;
+	}
+
+	// Rejected early here, the render thread reads the size and format of what it copies from the RHI texture
+	EPixelFormat PixelFormat = PF_Unknown;
+	if (const UTexture2D* Texture2D = Cast<UTexture2D>(Texture))
+		PixelFormat = Texture2D->GetPixelFormat();
+	else if (const UTextureRenderTarget2D* RenderTarget = Cast<UTextureRenderTarget2D>(Texture))
+		PixelFormat = RenderTarget->GetFormat();
+
+	if (!IsSupportedFormat(PixelFormat))
+	{
+		UE_LOG(LogTemp, Error, TEXT("FFrameWriter: Unsupported pixel format of %s"), *Texture->GetName());
+		return false;
+	}
+
+	// Both queues are checked here, so a full encoder queue backs up into the readbacks and drops new frames
+	if (ReadbackCount.GetValue() >= MaxReadbacks.Load() || EncodeCount.GetValue() >= MaxEncodes.Load())
+	{
+		DroppedCount.Increment();
+		INC_DWORD_STAT(STAT_FrameWriterDropped);
+		return false;
+	}
+
+	if (!FrameWriterImageWrapper)
+		FrameWriterImageWrapper = &FModuleManager::LoadModuleChecked<IImageWrapperModule>(TEXT("ImageWrapper"));
+
+	ReadbackCount.Increment();
+	PendingCount.Increment();
+	INC_DWORD_STAT(STAT_FrameWriterPending);
+
+	FReadback Readback;
+	Readback.FilePath = FilePath;
+	Readback.Format = Format;
+
+	ENQUEUE_RENDER_COMMAND(FrameWriterCopy)([this, Resource, Readback](FRHICommandListImmediate& RHICmdList) mutable
+	{
+		FRHITexture2D* Source = Resource->TextureRHI ? Resource->TextureRHI->GetTexture2D() : nullptr;
+		if (!Source)
+		{
+			UE_LOG(LogTemp, Error, TEXT("FFrameWriter: Texture released before %s could be written"), *Readback.FilePath);
+			FailReadback_RenderThread();
+			return;
+		}
+
+		// The RHI texture is what gets copied. A streamed texture only has its resident mips, smaller than the texture.
+		Readback.Width = Source->GetSizeX();
+		Readback.Height = Source->GetSizeY();
+		Readback.PixelFormat = Source->GetFormat();
+
+		if (!IsSupportedFormat(Readback.PixelFormat))
+		{
+			UE_LOG(LogTemp, Error, TEXT("FFrameWriter: Unsupported pixel format of the texture written to %s"), *Readback.FilePath);
+			FailReadback_RenderThread();
+			return;
+		}
+
+		const int32 Found = IdleStaging.IndexOfByPredicate([&Readback](const FTexture2DRHIRef& Staging)
+		{
+			return Staging->GetSizeX() == Readback.Width && Staging->GetSizeY() == Readback.Height && Staging->GetFormat() == Readback.PixelFormat;
+		});
+
+		if (Found != INDEX_NONE)
+		{
+			Readback.Staging = IdleStaging[Found];
+			IdleStaging.RemoveAtSwap(Found);
+		}
+		else
+		{
+			FRHIResourceCreateInfo CreateInfo;
+			Readback.Staging = RHICreateTexture2D(Readback.Width, Readback.Height, Readback.PixelFormat, 1, 1, TexCreate_CPUReadback, CreateInfo);
+		}
+
+		// The fence tells when the copy is done, so mapping never waits for the GPU
+		Readback.Fence = RHICreateGPUFence(TEXT("FrameWriterReadback"));
+		RHICmdList.CopyToResolveTarget(Source, Readback.Staging, FResolveParams());
+		RHICmdList.WriteGPUFence(Readback.Fence);
+
+		InFlight.Add(MoveTemp(Readback));
+	});
+
+	return true;
+}
+
+
+void FFrameWriter::FailReadback_RenderThread()
+{
+	FailedCount.Increment();
+	ReadbackCount.Decrement();
+	PendingCount.Decrement();
+	DEC_DWORD_STAT(STAT_FrameWriterPending);
+}
+
+
+void FFrameWriter::PollReadbacks_RenderThread(FRHICommandListImmediate& RHICmdList)
+{
+	check(IsInRenderingThread());
+
+	for (int32 Index = 0; Index < InFlight.Num();)
+	{
+		FReadback& Readback = InFlight[Index];
+		if (!Readback.Fence->Poll())
+		{
+			++Index;
+			continue;
+		}
+
+		// Keeps the frame on the GPU until an encoder is free
+		if (EncodeCount.GetValue() >= MaxEncodes.Load())
+			break;
+
+		const int32 BytesPerPixel = GPixelFormats[Readback.PixelFormat].BlockBytes;
+		const int32 RowBytes = Readback.Width * BytesPerPixel;
+		TArray<uint8>* Pixels = FUploadBufferPool::Get().Acquire(RowBytes * Readback.Height);
+
+		void* Data = nullptr;
+		int32 MappedWidth = 0, MappedHeight = 0;
+		RHICmdList.MapStagingSurface(Readback.Staging, Readback.Fence, Data, MappedWidth, MappedHeight);
+
+		if (Data)
+		{
+			// Rows of the staging texture are padded to the alignment of the RHI, the mapped width tells the pitch
+			const int32 Pitch = MappedWidth * BytesPerPixel;
+			for (int32 Row = 0; Row < Readback.Height; ++Row)
+				FMemory::Memcpy(Pixels->GetData() + Row * RowBytes, static_cast<const uint8*>(Data) + Row * Pitch, RowBytes);
+		}
+		RHICmdList.UnmapStagingSurface(Readback.Staging);
+
+		if (IdleStaging.Num() < MaxReadbacks.Load())
+			IdleStaging.Add(Readback.Staging);
+
+		EncodeCount.Increment();
+		ReadbackCount.Decrement();
+
+		const bool Mapped = (Data != nullptr);
+		Async(EAsyncExecution::ThreadPool, [this, Mapped, Pixels, FilePath = MoveTemp(Readback.FilePath), Format = Readback.Format, Width = Readback.Width, Height = Readback.Height, PixelFormat = Readback.PixelFormat]()
+		{
+			if (Mapped && EncodeAndWrite(FilePath, Format, Width, Height, PixelFormat, *Pixels))
+			{
+				WrittenCount.Increment();
+				INC_DWORD_STAT(STAT_FrameWriterWritten);
+			}
+			else
+			{
+				FailedCount.Increment();
+			}
+
+			FUploadBufferPool::Get().Release(Pixels);
+			EncodeCount.Decrement();
+			PendingCount.Decrement();
+			DEC_DWORD_STAT(STAT_FrameWriterPending);
+		});
+
+		InFlight.RemoveAt(Index);
+	}
+}
+
+
+bool FFrameWriter::EncodeAndWrite(const FString& FilePath, EFrameFileFormat Format, int32 Width, int32 Height, EPixelFormat PixelFormat, const TArray<uint8>& Pixels)
+{
+	if (!IFileManager::Get().MakeDirectory(*FPaths::GetPath(FilePath), true))
+	{
+		UE_LOG(LogTemp, Error, TEXT("FFrameWriter: Could not create the directory of %s"), *FilePath);
+		return false;
+	}
+
+	if (Format == EFrameFileFormat::E_Raw)
+		return FFileHelper::SaveArrayToFile(Pixels, *FilePath);
+
+	// PNG and DDS are written as 8-bit BGRA
+	const int32 NumPixels = Width * Height;
+	TArray<uint8>* Converted = nullptr;
+	const TArray<uint8>* BGRA = &Pixels;
+
+	if (PixelFormat != PF_B8G8R8A8)
+	{
+		Converted = FUploadBufferPool::Get().Acquire(NumPixels * 4);
+		BGRA = Converted;
+
+		if (PixelFormat == PF_R8G8B8A8)
+		{
+			FPixelFormatConversion::ConvertToBGRA8(Pixels.GetData(), 0, ESourcePixelLayout::RGBA8, Width, Height, Converted->GetData());
+		}
+		else
+		{
+			// Half float render targets hold linear color
+			const FFloat16Color* Src = reinterpret_cast<const FFloat16Color*>(Pixels.GetData());
+			FColor* Dst = reinterpret_cast<FColor*>(Converted->GetData());
+			for (int32 Index = 0; Index < NumPixels; ++Index)
+				Dst[Index] = FLinearColor(Src[Index]).ToFColor(true);
+		}
+	}
+
+	bool Written = false;
+	if (Format == EFrameFileFormat::E_PNG)
+	{
+		TSharedPtr<IImageWrapper> ImageWrapper = FrameWriterImageWrapper->CreateImageWrapper(EImageFormat::PNG);
+		if (ImageWrapper.IsValid() && ImageWrapper->SetRaw(BGRA->GetData(), NumPixels * 4, Width, Height, ERGBFormat::BGRA, 8))
+			Written = FFileHelper::SaveArrayToFile(ImageWrapper->GetCompressed(), *FilePath);
+	}
+	else
+	{
+		try
+		{
+			// nv_dds writes BGRA as A8R8G8B8, the layout the loader reads back
+			nv_dds::CDDSImage image;
+			image.create_textureFlat(GL_BGRA_EXT, 4, nv_dds::CTexture(Width, Height, 1, NumPixels * 4, BGRA->GetData()));
+			image.save(TCHAR_TO_UTF8(*FPaths::ConvertRelativePathToFull(FilePath)), false);
+			Written = true;
+		}
+		catch (std::exception& ex)
+		{
+			UE_LOG(LogTemp, Error, TEXT("%s Failed to save nv_dds image file: %s"), UTF8_TO_TCHAR(ex.what()), *FilePath);
+		}
+	}
+
+	if (Converted)
+		FUploadBufferPool::Get().Release(Converted);
+
+	if (!Written)
+		UE_LOG(LogTemp, Error, TEXT("FFrameWriter: Failed to write %s"), *FilePath);
+
+	return Written;
+}
+
+
+void FFrameWriter::Tick(float DeltaTime)
+{
+	if (ReadbackCount.GetValue() == 0)
+		return;
+
+	ENQUEUE_RENDER_COMMAND(FrameWriterPoll)([this](FRHICommandListImmediate& RHICmdList)
+	{
+		PollReadbacks_RenderThread(RHICmdList);
+	});
+}
+
+bool FFrameWriter::IsTickable() const
+{
+	return PendingCount.GetValue() > 0;
+}
+
+TStatId FFrameWriter::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(FFrameWriter, STATGROUP_Tickables);
+}
+
+
+bool FFrameWriter::Flush(float MaxWaitSeconds)
+{
+	check(IsInGameThread());
+
+	const double EndTime = FPlatformTime::Seconds() + MaxWaitSeconds;
+	while (PendingCount.GetValue() > 0)
+	{
+		if (FPlatformTime::Seconds() > EndTime)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("FFrameWriter: %d frames still pending after %.1f seconds"), PendingCount.GetValue(), MaxWaitSeconds);
+			return false;
+		}
+
+		// Submits the copies and polls them, the encoders finish on their own
+		Tick(0.0f);
+		FlushRenderingCommands();
+
+		if (PendingCount.GetValue() > 0)
+			FPlatformProcess::Sleep(0.001f);
+	}
+
+	return true;
+}
+
+void FFrameWriter::ReleaseResources()
+{
+	FCoreDelegates::OnEnginePreExit.Remove(EnginePreExitHandle);
+	EnginePreExitHandle.Reset();
+
+	Flush();
+
+	ENQUEUE_RENDER_COMMAND(FrameWriterRelease)([this](FRHICommandListImmediate& RHICmdList)
+	{
+		InFlight.Empty();
+		IdleStaging.Empty();
+	});
+	FlushRenderingCommands();
+}
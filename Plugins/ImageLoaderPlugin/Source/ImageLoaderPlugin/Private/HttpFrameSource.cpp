@@ -0,0 +1,292 @@
+#include "HttpFrameSource.h"
+#include "HttpModule.h"
+#include "Interfaces/IHttpRequest.h"
+#include "Interfaces/IHttpResponse.h"
+#include "Async/Async.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+#include "Misc/SecureHash.h"
+
+
+FHttpFrameSource& FHttpFrameSource::Get()
+{
+	static FHttpFrameSource Source;
+	return Source;
+}
+
+bool FHttpFrameSource::IsUrl(const FString& Path)
+{
+	return Path.StartsWith(TEXT("http://"), ESearchCase::IgnoreCase) || Path.StartsWith(TEXT("https://"), ESearchCase::IgnoreCase);
+}
+
+FString FHttpFrameSource::ResolveUrl(const FString& BaseUrl, const FString& Entry)
+{
+	if (IsUrl(Entry))
+		return Entry;
+
+	FString Url = BaseUrl;
+	int32 QueryStart = INDEX_NONE;
+	if (Url.FindChar(TEXT('?'), QueryStart))
+		Url = Url.Left(QueryStart);
+
+	const int32 SchemeEnd = Url.Find(TEXT("://"));
+	const int32 HostStart = (SchemeEnd == INDEX_NONE) ? 0 : SchemeEnd + 3;
+	const int32 PathStart = Url.Find(TEXT("/"), ESearchCase::CaseSensitive, ESearchDir::FromStart, HostStart);
+
+	// Host relative entry
+	if (Entry.StartsWith(TEXT("/")))
+		return ((PathStart == INDEX_NONE) ? Url : Url.Left(PathStart)) + Entry;
+
+	// Relative to the directory of the manifest
+	if (PathStart == INDEX_NONE)
+		return Url + TEXT("/") + Entry;
+
+	int32 LastSlash = INDEX_NONE;
+	Url.FindLastChar(TEXT('/'), LastSlash);
+	return Url.Left(LastSlash + 1) + Entry;
+}
+
+
+void FHttpFrameSource::SetMaxParallelRequests(int32 Count)
+{
+	check(IsInGameThread());
+
+	MaxParallelRequests = FMath::Max(1, Count);
+	StartDownloads();
+}
+
+void FHttpFrameSource::SetCacheDirectory(const FString& Directory)
+{
+	FScopeLock Lock(&Mutex);
+
+	CacheDirectory = Directory;
+	if (!CacheDirectory.IsEmpty() && !IFileManager::Get().MakeDirectory(*CacheDirectory, true))
+	{
+		UE_LOG(LogTemp, Error, TEXT("FHttpFrameSource: Could not create cache directory %s"), *CacheDirectory);
+		CacheDirectory.Empty();
+	}
+}
+
+FString FHttpFrameSource::GetCacheDirectory() const
+{
+	FScopeLock Lock(&Mutex);
+	return CacheDirectory;
+}
+
+void FHttpFrameSource::SetSequenceFrames(FName Sequence, const TArray<FString>& FrameUrls, TFunction<int32()> GetPlayhead)
+{
+	check(IsInGameThread());
+
+	RemoveSequence(Sequence);
+
+	FSequence& NewSequence = Sequences.Add(Sequence);
+	NewSequence.NumFrames = FrameUrls.Num();
+	NewSequence.GetPlayhead = MoveTemp(GetPlayhead);
+
+	for (int32 Index = 0; Index < FrameUrls.Num(); ++Index)
+		SequenceFrames.Add(FrameUrls[Index], { Sequence, Index });
+}
+
+void FHttpFrameSource::RemoveSequence(FName Sequence)
+{
+	check(IsInGameThread());
+
+	if (Sequences.Remove(Sequence) > 0)
+	{
+		for (auto It = SequenceFrames.CreateIterator(); It; ++It)
+		{
+			if (It.Value().Sequence == Sequence)
+				It.RemoveCurrent();
+		}
+	}
+}
+
+int32 FHttpFrameSource::GetPlayheadDistance(const FString& Url) const
+{
+	const FSequenceFrame* Frame = SequenceFrames.Find(Url);
+	const FSequence* Sequence = Frame ? Sequences.Find(Frame->Sequence) : nullptr;
+	if (!Sequence || Sequence->NumFrames < 1 || !Sequence->GetPlayhead)
+		return 0;
+
+	// Frames behind the playhead are shown last, once playback has looped
+	const int32 Playhead = FMath::Clamp(Sequence->GetPlayhead(), 0, Sequence->NumFrames - 1);
+	return (Frame->Index - Playhead + Sequence->NumFrames) % Sequence->NumFrames;
+}
+
+FString FHttpFrameSource::GetCachePath(const FString& Url) const
+{
+	FString UrlPath = Url;
+	int32 QueryStart = INDEX_NONE;
+	if (UrlPath.FindChar(TEXT('?'), QueryStart))
+		UrlPath = UrlPath.Left(QueryStart);
+
+	// The extension is kept, it selects the decoder
+	return FPaths::Combine(CacheDirectory, FMD5::HashAnsiString(*Url) + FPaths::GetExtension(UrlPath, true));
+}
+
+
+void FHttpFrameSource::FetchManifest(const FString& Url, TFunction<void(const TArray<FString>& FrameUrls)> OnFetched)
+{
+	check(IsInGameThread());
+
+	TSharedRef<IHttpRequest> Request = FHttpModule::Get().CreateRequest();
+	Request->SetURL(Url);
+	Request->SetVerb(TEXT("GET"));
+	Request->OnProcessRequestComplete().BindLambda([Url, OnFetched](FHttpRequestPtr, FHttpResponsePtr Response, bool Succeeded)
+	{
+		TArray<FString> FrameUrls;
+
+		if (Succeeded && Response.IsValid() && EHttpResponseCodes::IsOk(Response->GetResponseCode()))
+		{
+			TArray<FString> Lines;
+			Response->GetContentAsString().ParseIntoArrayLines(Lines);
+
+			for (FString& Line : Lines)
+			{
+				Line.TrimStartAndEndInline();
+				if (!Line.IsEmpty() && !Line.StartsWith(TEXT("#")))
+					FrameUrls.Add(ResolveUrl(Url, Line));
+			}
+		}
+		else
+		{
+			UE_LOG(LogTemp, Error, TEXT("FHttpFrameSource: Could not fetch manifest %s (%d)"), *Url, Response.IsValid() ? Response->GetResponseCode() : 0);
+		}
+
+		OnFetched(FrameUrls);
+	});
+	Request->ProcessRequest();
+}
+
+
+void FHttpFrameSource::FetchFrame(const FString& Url, TFunction<void(FBytes)> OnFetched)
+{
+	FString CachePath;
+	{
+		FScopeLock Lock(&Mutex);
+		if (!CacheDirectory.IsEmpty())
+			CachePath = GetCachePath(Url);
+	}
+
+	if (CachePath.IsEmpty())
+	{
+		if (IsInGameThread())
+			QueueDownload({ Url, OnFetched });
+		else
+			ForwardDownload({ Url, OnFetched });
+		return;
+	}
+
+	// The cache is read on the thread pool, only misses go through the request slots
+	Async(EAsyncExecution::ThreadPool, [this, Url, CachePath, OnFetched]()
+	{
+		FBytes Data = MakeShared<TArray<uint8>, ESPMode::ThreadSafe>();
+		if (FFileHelper::LoadFileToArray(*Data, *CachePath, FILEREAD_Silent))
+		{
+			CacheHitCount.Increment();
+			OnFetched(Data);
+			return;
+		}
+
+		ForwardDownload({ Url, OnFetched });
+	});
+}
+
+
+void FHttpFrameSource::QueueDownload(FPendingFetch&& Fetch)
+{
+	check(IsInGameThread());
+
+	Fetch.Order = NextFetchOrder++;
+	PendingDownloads.Add(MoveTemp(Fetch));
+	StartDownloads();
+}
+
+void FHttpFrameSource::ForwardDownload(FPendingFetch&& Fetch)
+{
+	ForwardedDownloads.Enqueue(MoveTemp(Fetch));
+	AsyncTask(ENamedThreads::GameThread, [this]() { QueueForwardedDownloads(); });
+}
+
+void FHttpFrameSource::QueueForwardedDownloads()
+{
+	check(IsInGameThread());
+
+	FPendingFetch Fetch;
+	while (ForwardedDownloads.Dequeue(Fetch))
+	{
+		Fetch.Order = NextFetchOrder++;
+		PendingDownloads.Add(MoveTemp(Fetch));
+	}
+
+	StartDownloads();
+}
+
+void FHttpFrameSource::StartDownloads()
+{
+	if (RunningDownloads >= MaxParallelRequests || PendingDownloads.Num() < 1)
+		return;
+
+	// The playheads have moved since the last request, or have been seeked
+	for (FPendingFetch& Pending : PendingDownloads)
+		Pending.Distance = GetPlayheadDistance(Pending.Url);
+
+	PendingDownloads.Sort([](const FPendingFetch& A, const FPendingFetch& B)
+	{
+		return (A.Distance != B.Distance) ? (A.Distance > B.Distance) : (A.Order > B.Order);
+	});
+
+	while (RunningDownloads < MaxParallelRequests && PendingDownloads.Num() > 0)
+	{
+		FPendingFetch Fetch = PendingDownloads.Pop(false);
+		++RunningDownloads;
+
+		const FString Url = Fetch.Url;
+		TFunction<void(FBytes)> OnFetched = MoveTemp(Fetch.OnFetched);
+
+		TSharedRef<IHttpRequest> Request = FHttpModule::Get().CreateRequest();
+		Request->SetURL(Url);
+		Request->SetVerb(TEXT("GET"));
+		Request->OnProcessRequestComplete().BindLambda([this, Url, OnFetched](FHttpRequestPtr, FHttpResponsePtr Response, bool Succeeded)
+		{
+			--RunningDownloads;
+
+			FBytes Data;
+			if (Succeeded && Response.IsValid() && EHttpResponseCodes::IsOk(Response->GetResponseCode()))
+			{
+				Data = MakeShared<TArray<uint8>, ESPMode::ThreadSafe>(Response->GetContent());
+				DownloadCount.Increment();
+			}
+			else
+			{
+				UE_LOG(LogTemp, Error, TEXT("FHttpFrameSource: Could not fetch frame %s (%d)"), *Url, Response.IsValid() ? Response->GetResponseCode() : 0);
+			}
+
+			FString CachePath;
+			{
+				FScopeLock Lock(&Mutex);
+				if (Data.IsValid() && !CacheDirectory.IsEmpty())
+					CachePath = GetCachePath(Url);
+			}
+
+			// Decoded first, the cache write only delays later runs
+			Async(EAsyncExecution::ThreadPool, [Data, CachePath, OnFetched]()
+			{
+				OnFetched(Data);
+
+				if (!CachePath.IsEmpty())
+				{
+					// Written under a temporary name, so that a reader never sees a partial entry
+					const FString TempPath = CachePath + FString::Printf(TEXT(".%u.tmp"), FPlatformTLS::GetCurrentThreadId());
+					if (FFileHelper::SaveArrayToFile(*Data, *TempPath) && !IFileManager::Get().Move(*CachePath, *TempPath))
+						IFileManager::Get().Delete(*TempPath);
+				}
+			});
+
+			StartDownloads();
+		});
+		Request->ProcessRequest();
+	}
+}
@@ -0,0 +1,121 @@
+#include "ImageDownscale.h"
+#include "Runtime/Core/Public/Async/ParallelFor.h"
+
+#if PLATFORM_CPU_X86_FAMILY
+#include <emmintrin.h>
+#endif
+
+
+// Below this many output pixels the rows are processed on the calling thread
+static const int32 ParallelDownscaleMinPixels = 256 * 256;
+
+
+#if PLATFORM_CPU_X86_FAMILY
+// Averages the 2x2 blocks of 4 source pixels of two rows into 2 destination pixels, widened to 16 bits
+// so the result is rounded exactly like the scalar path
+static FORCEINLINE __m128i HalveBlock(const uint8* Row0, const uint8* Row1)
+{
+	const __m128i Zero = _mm_setzero_si128();
+	const __m128i R0 = _mm_loadu_si128((const __m128i*)Row0);
+	const __m128i R1 = _mm_loadu_si128((const __m128i*)Row1);
+
+	// Vertical sums of pixels 0 and 1, then of pixels 2 and 3
+	__m128i Lo = _mm_add_epi16(_mm_unpacklo_epi8(R0, Zero), _mm_unpacklo_epi8(R1, Zero));
+	__m128i Hi = _mm_add_epi16(_mm_unpackhi_epi8(R0, Zero), _mm_unpackhi_epi8(R1, Zero));
+
+	// Horizontal sums land in the low half of each
+	Lo = _mm_add_epi16(Lo, _mm_srli_si128(Lo, 8));
+	Hi = _mm_add_epi16(Hi, _mm_srli_si128(Hi, 8));
+
+	return _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(Lo, Hi), _mm_set1_epi16(2)), 2);
+}
+#endif
+
+static void HalveRow(const uint8* Row0, const uint8* Row1, int32 DstWidth, uint8* Dst)
+{
+	int32 X = 0;
+
+#if PLATFORM_CPU_X86_FAMILY
+	// 8 source pixels of two rows give 4 destination pixels per iteration
+	for (; X + 4 <= DstWidth; X += 4)
+	{
+		const __m128i A = HalveBlock(Row0 + X * 8, Row1 + X * 8);
+		const __m128i B = HalveBlock(Row0 + X * 8 + 16, Row1 + X * 8 + 16);
+		_mm_storeu_si128((__m128i*)(Dst + X * 4), _mm_packus_epi16(A, B));
+	}
+#endif
+
+	for (; X < DstWidth; ++X)
+	{
+		const uint8* P0 = Row0 + X * 8;
+		const uint8* P1 = Row1 + X * 8;
+		for (int32 C = 0; C < 4; ++C)
+		{
+			Dst[X * 4 + C] = static_cast<uint8>((P0[C] + P0[C + 4] + P1[C] + P1[C + 4] + 2) >> 2);
+		}
+	}
+}
+
+
+void FImageDownscale::HalveBGRA8(const uint8* Src, int32 Width, int32 Height, uint8* OutPixels)
+{
+	const int32 SrcPitch = Width * 4;
+	const int32 DstWidth = Width / 2;
+	const int32 DstHeight = Height / 2;
+	const int32 DstPitch = DstWidth * 4;
+
+	auto ProcessRow = [=](int32 Y)
+	{
+		const uint8* Row0 = Src + (Y * 2) * SrcPitch;
+		HalveRow(Row0, Row0 + SrcPitch, DstWidth, OutPixels + Y * DstPitch);
+	};
+
+	if (DstWidth * DstHeight < ParallelDownscaleMinPixels)
+	{
+		for (int32 Y = 0; Y < DstHeight; ++Y)
+			ProcessRow(Y);
+	}
+	else
+	{
+		ParallelFor(DstHeight, ProcessRow);
+	}
+}
+
+
+bool FImageDownscale::DownscaleBGRA8(const uint8* Src, int32 Width, int32 Height, int32 Levels, TArray<uint8>& OutPixels, int32& OutWidth, int32& OutHeight)
+{
+	if (Levels < 0 || (Width >> Levels) < 1 || (Height >> Levels) < 1)
+		return false;
+
+	if (Levels == 0)
+	{
+		OutPixels.Reset();
+		OutPixels.Append(Src, Width * Height * 4);
+		OutWidth = Width;
+		OutHeight = Height;
+		return true;
+	}
+
+	TArray<uint8> Scratch;
+	const uint8* Level = Src;
+
+	for (int32 Idx = 0; Idx < Levels; ++Idx)
+	{
+		const int32 DstWidth = Width / 2;
+		const int32 DstHeight = Height / 2;
+
+		TArray<uint8> Dst;
+		Dst.SetNumUninitialized(DstWidth * DstHeight * 4);
+		HalveBGRA8(Level, Width, Height, Dst.GetData());
+
+		Scratch = MoveTemp(Dst);
+		Level = Scratch.GetData();
+		Width = DstWidth;
+		Height = DstHeight;
+	}
+
+	OutPixels = MoveTemp(Scratch);
+	OutWidth = Width;
+	OutHeight = Height;
+	return true;
+}
@@ -0,0 +1,260 @@
+#include "ImageFrameCache.h"
+#include "EncryptedImageFile.h"
+#include "HAL/PlatformFilemanager.h"
+#include "HAL/FileManager.h"
+#include "Misc/Paths.h"
+#include "Misc/SecureHash.h"
+#include "Misc/ScopeLock.h"
+#include "RenderUtils.h"
+
+
+// Entries are trimmed down to this fraction of the cap, so that a full cache is not trimmed on every store
+static const double FrameCacheTrimRatio = 0.9;
+
+static const uint32 FrameCacheMagic = 0x43464C49; // 'ILFC'
+static const uint32 FrameCacheVersion = 2;
+
+// Larger than any texture, and small enough for the size of an entry not to overflow
+static const int32 FrameCacheMaxDimension = 16384;
+
+struct FFrameCacheHeader
+{
+	uint32 Magic;
+	uint32 Version;
+	int32 Width;
+	int32 Height;
+	int32 PixelFormat;
+	int32 DataSize;
+	int32 SourceWidth;
+	int32 SourceHeight;
+};
+
+
+FImageFrameCache& FImageFrameCache::Get()
+{
+	static FImageFrameCache Cache;
+	return Cache;
+}
+
+void FImageFrameCache::Configure(const FString& Directory, int32 MaxSizeMB)
+{
+	{
+		FScopeLock Lock(&Mutex);
+
+		CacheDirectory = Directory;
+		MaxSizeBytes = static_cast<int64>(FMath::Max(0, MaxSizeMB)) << 20;
+		CurrentSizeBytes = 0;
+
+		if (CacheDirectory.IsEmpty())
+			return;
+
+		if (!IFileManager::Get().MakeDirectory(*CacheDirectory, true))
+		{
+			UE_LOG(LogTemp, Error, TEXT("FImageFrameCache: Could not create cache directory %s"), *CacheDirectory);
+			CacheDirectory.Empty();
+			return;
+		}
+
+		IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+		PlatformFile.IterateDirectoryStat(*CacheDirectory, [this](const TCHAR* Filename, const FFileStatData& StatData)
+		{
+			if (!StatData.bIsDirectory)
+				CurrentSizeBytes += StatData.FileSize;
+			return true;
+		});
+	}
+
+	UE_LOG(LogTemp, Warning, TEXT("FImageFrameCache: Using %s, %d / %d MB"), *CacheDirectory, static_cast<int32>(CurrentSizeBytes >> 20), MaxSizeMB);
+	Trim();
+}
+
+bool FImageFrameCache::IsEnabled() const
+{
+	FScopeLock Lock(&Mutex);
+	return !CacheDirectory.IsEmpty();
+}
+
+FString FImageFrameCache::GetEntryPath(const FString& Directory, const FString& SourcePath, int32 Variant)
+{
+	const FFileStatData StatData = IFileManager::Get().GetStatData(*SourcePath);
+	if (!StatData.bIsValid)
+		return FString();
+
+	const FString Key = FString::Printf(TEXT("%s|%lld|%lld|%d"), *FPaths::ConvertRelativePathToFull(SourcePath), StatData.FileSize, StatData.ModificationTime.GetTicks(), Variant);
+	return FPaths::Combine(Directory, FMD5::HashAnsiString(*Key) + TEXT(".frame"));
+}
+
+bool FImageFrameCache::Load(const FString& SourcePath, int32 Variant, TArray<uint8>& OutPixels, int32& OutWidth, int32& OutHeight, EPixelFormat& OutFormat,
+	int32& OutSourceWidth, int32& OutSourceHeight)
+{
+	// Encrypted sources are never stored, see Store
+	if (FEncryptedImageFile::IsEncrypted(SourcePath))
+		return false;
+
+	FString Directory;
+	{
+		FScopeLock Lock(&Mutex);
+		Directory = CacheDirectory;
+	}
+	if (Directory.IsEmpty())
+		return false;
+
+	// The source is stat'ed outside the lock, so loads on other threads do not queue behind the disk
+	const FString EntryPath = GetEntryPath(Directory, SourcePath, Variant);
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	TUniquePtr<IFileHandle> Handle(EntryPath.IsEmpty() ? nullptr : PlatformFile.OpenRead(*EntryPath));
+	if (!Handle)
+	{
+		MissCount.Increment();
+		return false;
+	}
+
+	// The pixels are copied into a single mip, so their size must be exactly that of the format and dimensions,
+	// and tiers reduce the source by four at most. Anything else is a corrupt or stale entry.
+	FFrameCacheHeader Header;
+	if (!Handle->Read(reinterpret_cast<uint8*>(&Header), sizeof(Header)) ||
+		Header.Magic != FrameCacheMagic || Header.Version != FrameCacheVersion ||
+		Header.Width <= 0 || Header.Height <= 0 || Header.Width > FrameCacheMaxDimension || Header.Height > FrameCacheMaxDimension || Header.DataSize <= 0 ||
+		Header.SourceWidth < Header.Width || Header.SourceHeight < Header.Height ||
+		Header.SourceWidth > Header.Width * 4 + 3 || Header.SourceHeight > Header.Height * 4 + 3 ||
+		Header.PixelFormat <= PF_Unknown || Header.PixelFormat >= PF_MAX ||
+		Header.Width % GPixelFormats[Header.PixelFormat].BlockSizeX != 0 || Header.Height % GPixelFormats[Header.PixelFormat].BlockSizeY != 0 ||
+		static_cast<SIZE_T>(Header.DataSize) != CalcTextureSize(Header.Width, Header.Height, static_cast<EPixelFormat>(Header.PixelFormat), 1) ||
+		Handle->Size() != static_cast<int64>(sizeof(Header)) + Header.DataSize)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("FImageFrameCache: Ignoring invalid entry %s for %s"), *EntryPath, *SourcePath);
+		MissCount.Increment();
+		return false;
+	}
+
+	OutPixels.SetNumUninitialized(Header.DataSize);
+	if (!Handle->Read(OutPixels.GetData(), Header.DataSize))
+	{
+		MissCount.Increment();
+		return false;
+	}
+	Handle.Reset();
+
+	OutWidth = Header.Width;
+	OutHeight = Header.Height;
+	OutFormat = static_cast<EPixelFormat>(Header.PixelFormat);
+	OutSourceWidth = Header.SourceWidth;
+	OutSourceHeight = Header.SourceHeight;
+
+	// The modification time of an entry is its last use, which drives the LRU trimming
+	PlatformFile.SetTimeStamp(*EntryPath, FDateTime::UtcNow());
+
+	HitCount.Increment();
+	return true;
+}
+
+void FImageFrameCache::Store(const FString& SourcePath, int32 Variant, const uint8* Pixels, int32 Size, int32 Width, int32 Height, EPixelFormat Format,
+	int32 SourceWidth, int32 SourceHeight)
+{
+	// Decrypted frames would be left on disk in the clear
+	if (FEncryptedImageFile::IsEncrypted(SourcePath))
+		return;
+
+	FString Directory;
+	{
+		FScopeLock Lock(&Mutex);
+		Directory = CacheDirectory;
+	}
+	if (Directory.IsEmpty() || Size <= 0)
+		return;
+
+	const FString EntryPath = GetEntryPath(Directory, SourcePath, Variant);
+	if (EntryPath.IsEmpty())
+		return;
+
+	// Written under a temporary name, so that a reader never sees a partial entry
+	const FString TempPath = EntryPath + FString::Printf(TEXT(".%u.tmp"), FPlatformTLS::GetCurrentThreadId());
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	{
+		TUniquePtr<IFileHandle> Handle(PlatformFile.OpenWrite(*TempPath));
+		if (!Handle)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("FImageFrameCache: Could not write %s"), *TempPath);
+			return;
+		}
+
+		const FFrameCacheHeader Header = { FrameCacheMagic, FrameCacheVersion, Width, Height, static_cast<int32>(Format), Size, SourceWidth, SourceHeight };
+		if (!Handle->Write(reinterpret_cast<const uint8*>(&Header), sizeof(Header)) || !Handle->Write(Pixels, Size))
+		{
+			Handle.Reset();
+			PlatformFile.DeleteFile(*TempPath);
+			return;
+		}
+	}
+
+	// A replaced entry no longer counts towards the cache size
+	const int64 ReplacedSize = PlatformFile.FileSize(*EntryPath);
+	PlatformFile.DeleteFile(*EntryPath);
+	if (!PlatformFile.MoveFile(*EntryPath, *TempPath))
+	{
+		PlatformFile.DeleteFile(*TempPath);
+		return;
+	}
+
+	bool NeedsTrim = false;
+	{
+		FScopeLock Lock(&Mutex);
+		CurrentSizeBytes += sizeof(FFrameCacheHeader) + Size - FMath::Max<int64>(ReplacedSize, 0);
+		NeedsTrim = (MaxSizeBytes > 0 && CurrentSizeBytes > MaxSizeBytes);
+	}
+
+	if (NeedsTrim)
+		Trim();
+}
+
+void FImageFrameCache::Trim()
+{
+	FScopeLock Lock(&Mutex);
+
+	if (CacheDirectory.IsEmpty() || MaxSizeBytes <= 0 || CurrentSizeBytes <= MaxSizeBytes)
+		return;
+
+	struct FEntry
+	{
+		FString Path;
+		int64 Size;
+		FDateTime LastUse;
+	};
+
+	TArray<FEntry> Entries;
+	int64 TotalSize = 0;
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	PlatformFile.IterateDirectoryStat(*CacheDirectory, [&Entries, &TotalSize](const TCHAR* Filename, const FFileStatData& StatData)
+	{
+		if (!StatData.bIsDirectory)
+		{
+			Entries.Add({ Filename, StatData.FileSize, StatData.ModificationTime });
+			TotalSize += StatData.FileSize;
+		}
+		return true;
+	});
+
+	Entries.Sort([](const FEntry& A, const FEntry& B) { return A.LastUse < B.LastUse; });
+
+	const int64 TargetSize = static_cast<int64>(MaxSizeBytes * FrameCacheTrimRatio);
+	int32 Deleted = 0;
+
+	for (const FEntry& Entry : Entries)
+	{
+		if (TotalSize <= TargetSize)
+			break;
+
+		if (PlatformFile.DeleteFile(*Entry.Path))
+		{
+			TotalSize -= Entry.Size;
+			++Deleted;
+		}
+	}
+
+	CurrentSizeBytes = TotalSize;
+
+	UE_LOG(LogTemp, Warning, TEXT("FImageFrameCache: Trimmed %d entries, %d MB left"), Deleted, static_cast<int32>(CurrentSizeBytes >> 20));
+}
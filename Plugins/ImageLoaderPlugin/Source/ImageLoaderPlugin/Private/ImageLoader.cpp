@@ -3,6 +3,12 @@
 #include "IImageWrapperModule.h"
 #include "RenderUtils.h"
 #include "Engine/Texture2D.h"
+#include "Engine/VolumeTexture.h"
+#include "ImageDownscale.h"
+#include "ImageFrameCache.h"
+#include "PixelFormatConversion.h"
+#include "HttpFrameSource.h"
+#include "EncryptedImageFile.h"
 
 #include "Runtime/RHI/Public/RHICommandList.h"
 
@@ -13,62 +19,140 @@
 // Module loading is not allowed outside of the main thread, so we load the ImageWrapper module ahead of time.
 static IImageWrapperModule* ImageWrapperModule = nullptr;
 
-UImageLoader* UImageLoader::LoadImageFromDiskAsync(UObject* Outer, const FString& ImagePath, int32 Id)
+UImageLoader* UImageLoader::LoadImageFromDiskAsync(UObject* Outer, const FString& ImagePath, int32 Id, ETextureResolutionTier Tier)
 {
 	// This simply creates a new ImageLoader object and starts an asynchronous load.
 	UImageLoader* Loader = NewObject<UImageLoader>();
-	Loader->LoadImageAsync(Outer, ImagePath, Id);
+	Loader->LoadImageAsync(Outer, ImagePath, Id, Tier);
 	return Loader;
 }
 
-void UImageLoader::LoadImageAsync(UObject* Outer, const FString& ImagePath, int32 Id)
+void UImageLoader::LoadImageAsync(UObject* Outer, const FString& ImagePath, int32 Id, ETextureResolutionTier Tier)
 {
+	LoadId = Id;
+
 	// The asynchronous loading operation is represented by a Future, which will contain the result value once the operation is done.
 	// We store the Future in this object, so we can retrieve the result value in the completion callback below.
-	Future = LoadImageFromDiskAsync(Outer, ImagePath, [this, Id]()
+	TWeakObjectPtr<UImageLoader> WeakThis(this);
+	Future = LoadImageFromDiskAsync(Outer, ImagePath, [WeakThis]()
 	{
-		// This is the same Future object that we assigned above, but later in time.
-		// At this point, loading is done and the Future contains a value.
-		if (Future.IsValid())
+		// Notify listeners about the loaded texture on the game thread, unless WaitForCompletion has done so already.
+		AsyncTask(ENamedThreads::GameThread, [WeakThis]()
 		{
-			// Notify listeners about the loaded texture on the game thread.
-			AsyncTask(ENamedThreads::GameThread, [this, Id]() { LoadCompleted.Broadcast(Future.Get(), Id); });
-		}
-	});
+			if (WeakThis.IsValid())
+				WeakThis->BroadcastCompleted();
+		});
+	}, Tier);
+}
+
+bool UImageLoader::WaitForCompletion(float MaxWaitSeconds)
+{
+	check(IsInGameThread());
+
+	if (Completed)
+		return true;
+
+	if (!Future.IsValid() || !Future.WaitFor(FTimespan::FromSeconds(FMath::Max(0.0f, MaxWaitSeconds))))
+		return false;
+
+	BroadcastCompleted();
+	return true;
+}
+
+void UImageLoader::BroadcastCompleted()
+{
+	// This is the same Future object that was assigned when the load started, but later in time.
+	// At this point, loading is done and the Future contains a value.
+	if (Completed || !Future.IsValid())
+		return;
+
+	Completed = true;
+	LoadCompleted.Broadcast(Future.Get(), LoadId);
 }
 
-TFuture<UTexture2D*> UImageLoader::LoadImageFromDiskAsync(UObject* Outer, const FString& ImagePath, TFunction<void()> CompletionCallback)
+TFuture<UTexture2D*> UImageLoader::LoadImageFromDiskAsync(UObject* Outer, const FString& ImagePath, TFunction<void()> CompletionCallback, ETextureResolutionTier Tier)
 {
 	// Run the image loading function asynchronously through a lambda expression, capturing the ImagePath string by value.
 	// Run it on the thread pool, so we can load multiple images simultaneously without interrupting other tasks.
 
-	if (FPaths::GetExtension(ImagePath).Compare("dds", ESearchCase::IgnoreCase) == 0)
+	if (FHttpFrameSource::IsUrl(ImagePath))
+	{
+		// Downloaded first, then decoded on the thread pool straight from the response bytes
+		TSharedRef<TPromise<UTexture2D*>, ESPMode::ThreadSafe> Promise = MakeShared<TPromise<UTexture2D*>, ESPMode::ThreadSafe>(MoveTemp(CompletionCallback));
+		FHttpFrameSource::Get().FetchFrame(ImagePath, [=](FHttpFrameSource::FBytes Data)
+		{
+			Promise->SetValue(Data.IsValid() ? LoadImageFromMemory(Outer, *Data, ImagePath, Tier) : nullptr);
+		});
+		return Promise->GetFuture();
+	}
+	else if (FPaths::GetExtension(ImagePath).Compare("dds", ESearchCase::IgnoreCase) == 0)
 	{
-		return Async(EAsyncExecution::ThreadPool, [=]() { return LoadDDSFromDisk(Outer, ImagePath); }, CompletionCallback);
+		return Async(EAsyncExecution::ThreadPool, [=]() { return LoadDDSFromDisk(Outer, ImagePath, Tier); }, CompletionCallback);
 	}
 	else
 	{
-		return Async(EAsyncExecution::ThreadPool, [=]() { return LoadImageFromDisk(Outer, ImagePath); }, CompletionCallback);
+		return Async(EAsyncExecution::ThreadPool, [=]() { return LoadImageFromDisk(Outer, ImagePath, Tier); }, CompletionCallback);
 	}
 }
 
-UTexture2D* UImageLoader::LoadImageFromDisk(UObject* Outer, const FString& ImagePath)
+// An image decoded in the layout its decoder produces natively. The wrapper owns the memory RawData points to.
+struct FDecodedImage
 {
-	// Check if the file exists first
-	if (!FPaths::FileExists(ImagePath))
+	TSharedPtr<IImageWrapper> ImageWrapper;
+	const TArray<uint8>* RawData = nullptr;
+	ESourcePixelLayout Layout = ESourcePixelLayout::BGRA8;
+	int32 Width = 0;
+	int32 Height = 0;
+
+	bool IsValid() const { return RawData != nullptr; }
+
+	/** The pixels in 8-bit BGRA, converted into Scratch unless they are already in that layout. */
+	const uint8* GetBGRA8(TArray<uint8>& Scratch) const
 	{
-		UE_LOG(LogTemp, Error, TEXT("File not found: %s"), *ImagePath);
-		return nullptr;
+		if (Layout == ESourcePixelLayout::BGRA8)
+			return RawData->GetData();
+
+		Scratch.SetNumUninitialized(Width * Height * 4);
+		FPixelFormatConversion::ConvertToBGRA8(RawData->GetData(), 0, Layout, Width, Height, Scratch.GetData());
+		return Scratch.GetData();
 	}
+};
 
-	// Load the compressed byte data from the file
-	TArray<uint8> FileData;
-	if (!FFileHelper::LoadFileToArray(FileData, *ImagePath))
+// Picks the layout the decoder of a format produces without its own per-pixel conversion
+static void GetNativeLayout(EImageFormat ImageFormat, const IImageWrapper& ImageWrapper, ERGBFormat& OutFormat, int32& OutBitDepth, ESourcePixelLayout& OutLayout)
+{
+	const bool IsGray = (ImageWrapper.GetFormat() == ERGBFormat::Gray);
+	const bool Is16Bit = (ImageWrapper.GetBitDepth() == 16);
+
+	// The jpeg decoder outputs RGBA and swizzles to BGRA with a scalar loop
+	if (ImageFormat == EImageFormat::JPEG)
 	{
-		UE_LOG(LogTemp, Error, TEXT("Failed to load file: %s"), *ImagePath);
-		return nullptr;
+		OutFormat = IsGray ? ERGBFormat::Gray : ERGBFormat::RGBA;
+		OutBitDepth = 8;
+		OutLayout = IsGray ? ESourcePixelLayout::Gray8 : ESourcePixelLayout::RGBA8;
+		return;
+	}
+
+	// 16-bit color pngs are rounded to 8 bits here instead of being truncated by libpng.
+	// Gray pngs are left to libpng, a gray format may still carry alpha.
+	if (ImageFormat == EImageFormat::PNG && Is16Bit && !IsGray)
+	{
+		OutFormat = ERGBFormat::RGBA;
+		OutBitDepth = 16;
+		OutLayout = ESourcePixelLayout::RGBA16;
+		return;
 	}
 
+	OutFormat = ERGBFormat::BGRA;
+	OutBitDepth = 8;
+	OutLayout = ESourcePixelLayout::BGRA8;
+}
+
+// Decompresses the bytes of an image file. The pixels are left in the native layout of the decoder, see FPixelFormatConversion.
+static FDecodedImage DecodeImageData(const TArray<uint8>& FileData, const FString& ImagePath)
+{
+	FDecodedImage Image;
+
 	if (!ImageWrapperModule)
 	{
 		ImageWrapperModule = FModuleManager::LoadModulePtr<IImageWrapperModule>(TEXT("ImageWrapper"));
@@ -79,35 +163,241 @@ UTexture2D* UImageLoader::LoadImageFromDisk(UObject* Outer, const FString& Image
 	if (ImageFormat == EImageFormat::Invalid)
 	{
 		UE_LOG(LogTemp, Error, TEXT("Unrecognized image file format: %s"), *ImagePath);
-		return nullptr;
+		return Image;
 	}
 
 	// Create an image wrapper for the detected image format
 	TSharedPtr<IImageWrapper> ImageWrapper = ImageWrapperModule->CreateImageWrapper(ImageFormat);
-	if (!ImageWrapper.IsValid())
+	if (!ImageWrapper.IsValid() || !ImageWrapper->SetCompressed(FileData.GetData(), FileData.Num()))
 	{
 		UE_LOG(LogTemp, Error, TEXT("Failed to create image wrapper for file: %s"), *ImagePath);
-		return nullptr;
+		return Image;
 	}
 
-	// Decompress the image data
-	const TArray<uint8>* RawData = nullptr;
-	ImageWrapper->SetCompressed(FileData.GetData(), FileData.Num());
-	ImageWrapper->GetRaw(ERGBFormat::BGRA, 8, RawData);
-	if (RawData == nullptr)
+	// Decompress the image data, falling back to the BGRA conversion of the decoder
+	ERGBFormat RawFormat = ERGBFormat::BGRA;
+	int32 RawBitDepth = 8;
+	GetNativeLayout(ImageFormat, *ImageWrapper, RawFormat, RawBitDepth, Image.Layout);
+
+	if (!ImageWrapper->GetRaw(RawFormat, RawBitDepth, Image.RawData) && Image.Layout != ESourcePixelLayout::BGRA8)
+	{
+		Image.Layout = ESourcePixelLayout::BGRA8;
+		ImageWrapper->GetRaw(ERGBFormat::BGRA, 8, Image.RawData);
+	}
+
+	if (Image.RawData == nullptr)
 	{
 		UE_LOG(LogTemp, Error, TEXT("Failed to decompress image file: %s"), *ImagePath);
+		return Image;
+	}
+
+	Image.ImageWrapper = ImageWrapper;
+	Image.Width = ImageWrapper->GetWidth();
+	Image.Height = ImageWrapper->GetHeight();
+	return Image;
+}
+
+// Reads and decompresses an image file
+static FDecodedImage DecodeImageFile(const FString& ImagePath)
+{
+	// Check if the file exists first
+	if (!FPaths::FileExists(ImagePath))
+	{
+		UE_LOG(LogTemp, Error, TEXT("File not found: %s"), *ImagePath);
+		return FDecodedImage();
+	}
+
+	// Load the compressed byte data from the file, decrypting it while it is read
+	TArray<uint8> FileData;
+	const bool Loaded = FEncryptedImageFile::IsEncrypted(ImagePath) ? FEncryptedImageFile::ReadFile(ImagePath, FileData) : FFileHelper::LoadFileToArray(FileData, *ImagePath);
+	if (!Loaded)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to load file: %s"), *ImagePath);
+		return FDecodedImage();
+	}
+
+	return DecodeImageData(FileData, ImagePath);
+}
+
+static UTexture2D* CreateDecodedTexture(UObject* Outer, const FDecodedImage& Image, const FString& ImagePath, ETextureResolutionTier Tier);
+static UTexture2D* CreateDDSTexture(UObject* Outer, nv_dds::CDDSImage& image, const FString& ImagePath, ETextureResolutionTier Tier);
+
+// Lets nv_dds read a file held in memory without copying it
+struct FMemoryStreamBuf : public std::streambuf
+{
+	explicit FMemoryStreamBuf(const TArray<uint8>& Data)
+	{
+		char* Begin = reinterpret_cast<char*>(const_cast<uint8*>(Data.GetData()));
+		setg(Begin, Begin, Begin + Data.Num());
+	}
+};
+
+// Attaches the size of the source image to a frame, for the resolution tier it ended up at to be known
+static UTexture2D* SetSourceSize(UTexture2D* Texture, int32 SourceSizeX, int32 SourceSizeY)
+{
+	if (Texture)
+	{
+		UImageSourceUserData* SourceData = NewObject<UImageSourceUserData>(Texture);
+		SourceData->SourceSizeX = SourceSizeX;
+		SourceData->SourceSizeY = SourceSizeY;
+		Texture->AddAssetUserData(SourceData);
+	}
+	return Texture;
+}
+
+// Creates the texture straight from the frame cache, skipping decode. Returns nullptr on a cache miss.
+static UTexture2D* LoadCachedTexture(UObject* Outer, const FString& ImagePath, ETextureResolutionTier Tier)
+{
+	FImageFrameCache& FrameCache = FImageFrameCache::Get();
+	if (!FrameCache.IsEnabled())
+	{
 		return nullptr;
 	}
-	// Create the texture and upload the uncompressed image data
+
+	TArray<uint8> CachedData;
+	int32 CachedWidth = 0;
+	int32 CachedHeight = 0;
+	EPixelFormat CachedFormat = EPixelFormat::PF_Unknown;
+	int32 SourceWidth = 0;
+	int32 SourceHeight = 0;
+	if (!FrameCache.Load(ImagePath, static_cast<int32>(Tier), CachedData, CachedWidth, CachedHeight, CachedFormat, SourceWidth, SourceHeight))
+	{
+		return nullptr;
+	}
+
 	FString TextureBaseName = TEXT("Texture_") + FPaths::GetBaseFilename(ImagePath);
-	return CreateTexture(Outer, *RawData, ImageWrapper->GetWidth(), ImageWrapper->GetHeight(), EPixelFormat::PF_B8G8R8A8, FName(*TextureBaseName));
+	return SetSourceSize(UImageLoader::CreateTexture(Outer, CachedData, CachedWidth, CachedHeight, CachedFormat, FName(*TextureBaseName)), SourceWidth, SourceHeight);
 }
 
+// Creates the texture of the bytes of a plain image file
+static UTexture2D* LoadImageData(UObject* Outer, const TArray<uint8>& FileData, const FString& ImagePath, ETextureResolutionTier Tier)
+{
+	if (FPaths::GetExtension(FEncryptedImageFile::GetImagePath(ImagePath)).Equals(TEXT("dds"), ESearchCase::IgnoreCase))
+	{
+		nv_dds::CDDSImage image;
+		try
+		{
+			FMemoryStreamBuf StreamBuf(FileData);
+			std::istream Stream(&StreamBuf);
+			image.load(Stream, false);
+		}
+		catch (const std::exception& ex)
+		{
+			UE_LOG(LogTemp, Error, TEXT("%s Failed to load nv_dds image data: %s"), UTF8_TO_TCHAR(ex.what()), *ImagePath);
+			return nullptr;
+		}
+
+		return CreateDDSTexture(Outer, image, ImagePath, Tier);
+	}
 
+	const FDecodedImage Image = DecodeImageData(FileData, ImagePath);
+	if (!Image.IsValid())
+	{
+		return nullptr;
+	}
 
+	return CreateDecodedTexture(Outer, Image, ImagePath, Tier);
+}
 
-UTexture2D* UImageLoader::CreateTexture(UObject* Outer, const TArray<uint8>& PixelData, int32 InSizeX, int32 InSizeY, EPixelFormat InFormat, FName BaseName)
+UTexture2D* UImageLoader::LoadImageFromDisk(UObject* Outer, const FString& ImagePath, ETextureResolutionTier Tier)
+{
+	// Encrypted files are decrypted while they are read, then loaded from memory like downloaded ones
+	if (FEncryptedImageFile::IsEncrypted(ImagePath))
+	{
+		TArray<uint8> FileData;
+		if (!FEncryptedImageFile::ReadFile(ImagePath, FileData))
+		{
+			return nullptr;
+		}
+
+		return LoadImageData(Outer, FileData, ImagePath, Tier);
+	}
+
+	if (UTexture2D* CachedTexture = LoadCachedTexture(Outer, ImagePath, Tier))
+	{
+		return CachedTexture;
+	}
+
+	const FDecodedImage Image = DecodeImageFile(ImagePath);
+	if (!Image.IsValid())
+	{
+		return nullptr;
+	}
+
+	return CreateDecodedTexture(Outer, Image, ImagePath, Tier);
+}
+
+UTexture2D* UImageLoader::LoadImageFromMemory(UObject* Outer, const TArray<uint8>& FileData, const FString& ImagePath, ETextureResolutionTier Tier)
+{
+	if (FEncryptedImageFile::IsEncrypted(ImagePath))
+	{
+		TArray<uint8> Decrypted;
+		if (!FEncryptedImageFile::Decrypt(FileData, ImagePath, Decrypted))
+		{
+			return nullptr;
+		}
+
+		return LoadImageData(Outer, Decrypted, ImagePath, Tier);
+	}
+
+	return LoadImageData(Outer, FileData, ImagePath, Tier);
+}
+
+// Creates the texture of a decoded image at the resolution of the tier
+static UTexture2D* CreateDecodedTexture(UObject* Outer, const FDecodedImage& Image, const FString& ImagePath, ETextureResolutionTier Tier)
+{
+	FString TextureBaseName = TEXT("Texture_") + FPaths::GetBaseFilename(ImagePath);
+	FImageFrameCache& FrameCache = FImageFrameCache::Get();
+
+	// Reduce the resolution before the texture is created, so only the reduced frame is ever uploaded
+	if (Tier != ETextureResolutionTier::E_Full)
+	{
+		TArray<uint8> Converted;
+		TArray<uint8> ScaledData;
+		int32 ScaledWidth = 0;
+		int32 ScaledHeight = 0;
+		if (FImageDownscale::DownscaleBGRA8(Image.GetBGRA8(Converted), Image.Width, Image.Height, static_cast<int32>(Tier), ScaledData, ScaledWidth, ScaledHeight))
+		{
+			FrameCache.Store(ImagePath, static_cast<int32>(Tier), ScaledData.GetData(), ScaledData.Num(), ScaledWidth, ScaledHeight, EPixelFormat::PF_B8G8R8A8, Image.Width, Image.Height);
+			return SetSourceSize(UImageLoader::CreateTexture(Outer, ScaledData, ScaledWidth, ScaledHeight, EPixelFormat::PF_B8G8R8A8, FName(*TextureBaseName)), Image.Width, Image.Height);
+		}
+
+		UE_LOG(LogTemp, Warning, TEXT("Image too small for the requested resolution tier, loading it at full size: %s"), *ImagePath);
+	}
+
+	// The cache stores BGRA, so the conversion is done once up front. Otherwise it writes straight into the texture.
+	if (FrameCache.IsEnabled())
+	{
+		TArray<uint8> Converted;
+		const uint8* Pixels = Image.GetBGRA8(Converted);
+		FrameCache.Store(ImagePath, static_cast<int32>(Tier), Pixels, Image.Width * Image.Height * 4, Image.Width, Image.Height, EPixelFormat::PF_B8G8R8A8, Image.Width, Image.Height);
+		return SetSourceSize(UImageLoader::CreateTexture(Outer, Pixels, 0, ESourcePixelLayout::BGRA8, Image.Width, Image.Height, FName(*TextureBaseName)), Image.Width, Image.Height);
+	}
+
+	// Create the texture and upload the uncompressed image data
+	return SetSourceSize(UImageLoader::CreateTexture(Outer, Image.RawData->GetData(), 0, Image.Layout, Image.Width, Image.Height, FName(*TextureBaseName)), Image.Width, Image.Height);
+}
+
+bool UImageLoader::LoadRawImageFromDisk(const FString& ImagePath, TArray<uint8>& OutPixels, int32& OutWidth, int32& OutHeight)
+{
+	const FDecodedImage Image = DecodeImageFile(ImagePath);
+	if (!Image.IsValid())
+	{
+		return false;
+	}
+
+	OutPixels.SetNumUninitialized(Image.Width * Image.Height * 4);
+	FPixelFormatConversion::ConvertToBGRA8(Image.RawData->GetData(), 0, Image.Layout, Image.Width, Image.Height, OutPixels.GetData());
+	OutWidth = Image.Width;
+	OutHeight = Image.Height;
+	return true;
+}
+
+
+
+
+// Creates a transient texture with a single mip, which Fill writes the pixel data of
+static UTexture2D* CreateTransientTexture(UObject* Outer, int32 InSizeX, int32 InSizeY, EPixelFormat InFormat, FName BaseName, TFunctionRef<void(uint8* MipData)> Fill)
 {
 	// Shamelessly copied from UTexture2D::CreateTransient with a few modifications
 	if (InSizeX <= 0 || InSizeY <= 0 ||
@@ -140,32 +430,177 @@ UTexture2D* UImageLoader::CreateTexture(UObject* Outer, const TArray<uint8>& Pix
 	Mip->SizeY = InSizeY;
 	Mip->BulkData.Lock(LOCK_READ_WRITE);
 	void* TextureData = Mip->BulkData.Realloc(NumBlocksX * NumBlocksY * GPixelFormats[InFormat].BlockBytes);
-	FMemory::Memcpy(TextureData, PixelData.GetData(), PixelData.Num());
+	Fill(static_cast<uint8*>(TextureData));
 	Mip->BulkData.Unlock();
 
 	NewTexture->UpdateResource();
 	return NewTexture;
+}
+
+UTexture2D* UImageLoader::CreateTexture(UObject* Outer, const TArray<uint8>& PixelData, int32 InSizeX, int32 InSizeY, EPixelFormat InFormat, FName BaseName)
+{
+	if (InSizeX <= 0 || InSizeY <= 0 || static_cast<SIZE_T>(PixelData.Num()) != CalcTextureSize(InSizeX, InSizeY, InFormat, 1))
+	{
+		UE_LOG(LogTemp, Error, TEXT("UImageLoader::CreateTexture: %d bytes do not match a %dx%d %s texture"), PixelData.Num(), InSizeX, InSizeY, GPixelFormats[InFormat].Name);
+		return nullptr;
+	}
+
+	return CreateTransientTexture(Outer, InSizeX, InSizeY, InFormat, BaseName, [&PixelData](uint8* MipData)
+	{
+		FMemory::Memcpy(MipData, PixelData.GetData(), PixelData.Num());
+	});
+}
 
+UTexture2D* UImageLoader::CreateTexture(UObject* Outer, const uint8* Src, int32 SrcPitch, ESourcePixelLayout Layout, int32 InSizeX, int32 InSizeY, FName BaseName, bool PremultiplyAlpha)
+{
+	// Converted straight into the mip, without an intermediate BGRA copy
+	return CreateTransientTexture(Outer, InSizeX, InSizeY, EPixelFormat::PF_B8G8R8A8, BaseName, [=](uint8* MipData)
+	{
+		FPixelFormatConversion::ConvertToBGRA8(Src, SrcPitch, Layout, InSizeX, InSizeY, MipData, 0, PremultiplyAlpha);
+	});
 }
 
 
 
 
-UTexture2D* UImageLoader::LoadDDSFromDisk(UObject* Outer, const FString& ImagePath)
+UVolumeTexture* UImageLoader::CreateVolumeTexture(UObject* Outer, const TArray<uint8>& PixelData, int32 InSizeX, int32 InSizeY, int32 InSizeZ, EPixelFormat InFormat, FName BaseName)
+{
+	const FPixelFormatInfo& FormatInfo = GPixelFormats[InFormat];
+	if (InSizeX <= 0 || InSizeY <= 0 || InSizeZ <= 0 ||
+		(InSizeX % FormatInfo.BlockSizeX) != 0 ||
+		(InSizeY % FormatInfo.BlockSizeY) != 0)
+	{
+		UE_LOG(LogTemp, Error, TEXT("UImageLoader::CreateVolumeTexture: Invalid size %d x %d x %d"), InSizeX, InSizeY, InSizeZ);
+		return nullptr;
+	}
+
+	if (!GSupportsTexture3D || FMath::Max3(InSizeX, InSizeY, InSizeZ) > GMaxVolumeTextureDimensions)
+	{
+		UE_LOG(LogTemp, Error, TEXT("UImageLoader::CreateVolumeTexture: %d x %d x %d volume textures are not supported by the RHI"), InSizeX, InSizeY, InSizeZ);
+		return nullptr;
+	}
+
+	// The volume has to fit the pixel array it is copied from, whose size is an int32
+	const int64 SliceSize = static_cast<int64>(InSizeX / FormatInfo.BlockSizeX) * (InSizeY / FormatInfo.BlockSizeY) * FormatInfo.BlockBytes;
+	const int64 VolumeSize = SliceSize * InSizeZ;
+	if (VolumeSize > MAX_int32)
+	{
+		UE_LOG(LogTemp, Error, TEXT("UImageLoader::CreateVolumeTexture: %d x %d x %d volume is too large"), InSizeX, InSizeY, InSizeZ);
+		return nullptr;
+	}
+
+	if (PixelData.Num() < VolumeSize)
+	{
+		UE_LOG(LogTemp, Error, TEXT("UImageLoader::CreateVolumeTexture: %d bytes of pixel data for %d slices of %lld bytes"), PixelData.Num(), InSizeZ, SliceSize);
+		return nullptr;
+	}
+
+	FName TextureName = MakeUniqueObjectName(Outer, UVolumeTexture::StaticClass(), BaseName);
+	UVolumeTexture* NewTexture = NewObject<UVolumeTexture>(Outer, TextureName, RF_Transient);
+
+	NewTexture->PlatformData = new FTexturePlatformData();
+	NewTexture->PlatformData->SizeX = InSizeX;
+	NewTexture->PlatformData->SizeY = InSizeY;
+	// The slice count lives in the low bits of the packed data
+	NewTexture->PlatformData->PackedData = static_cast<uint32>(InSizeZ);
+	NewTexture->PlatformData->PixelFormat = InFormat;
+
+	// A single mip, mipping a flipbook along its depth would blend unrelated frames
+	FTexture2DMipMap* Mip = new FTexture2DMipMap();
+	NewTexture->PlatformData->Mips.Add(Mip);
+	Mip->SizeX = InSizeX;
+	Mip->SizeY = InSizeY;
+	Mip->SizeZ = InSizeZ;
+	Mip->BulkData.Lock(LOCK_READ_WRITE);
+	void* TextureData = Mip->BulkData.Realloc(VolumeSize);
+	FMemory::Memcpy(TextureData, PixelData.GetData(), VolumeSize);
+	Mip->BulkData.Unlock();
+
+	NewTexture->UpdateResource();
+	return NewTexture;
+}
+
+bool UImageLoader::LoadDDSVolumeFromDisk(const FString& ImagePath, TArray<uint8>& OutData, int32& OutWidth, int32& OutHeight, int32& OutDepth, EPixelFormat& OutFormat)
 {
 	nv_dds::CDDSImage image;
-	bool flip_image = false;
 
 	try
 	{
-		image.load(TCHAR_TO_UTF8(*ImagePath), flip_image);
+		image.load(TCHAR_TO_UTF8(*ImagePath), false);
+	}
+	catch (const std::exception& ex)
+	{
+		UE_LOG(LogTemp, Error, TEXT("%s Failed to load nv_dds image file: %s"), UTF8_TO_TCHAR(ex.what()), *ImagePath);
+		return false;
+	}
+
+	if (!image.is_volume())
+	{
+		UE_LOG(LogTemp, Error, TEXT("Not a volume texture: %s"), *ImagePath);
+		return false;
+	}
 
+	const nv_dds::CSurface& Surface = image.get_surface(0);
+	OutWidth = Surface.get_width();
+	OutHeight = Surface.get_height();
+	OutDepth = Surface.get_depth();
+
+	if (image.is_compressed())
+	{
 		if (image.get_format_dxt() != nv_dds::DXT1 && image.get_format_dxt() != nv_dds::DXT5)
 		{
-			UE_LOG(LogTemp, Error, TEXT("%Unsupported DXT format: %s"), *ImagePath);
-			return nullptr;
+			UE_LOG(LogTemp, Error, TEXT("Unsupported DXT format: %s"), *ImagePath);
+			return false;
 		}
 
+		OutFormat = (image.get_format_dxt() == nv_dds::DXT5) ? EPixelFormat::PF_DXT5 : EPixelFormat::PF_DXT1;
+		OutData.Reset();
+		OutData.Append(static_cast<uint8_t*>(Surface), Surface.get_size());
+		return true;
+	}
+
+	ESourcePixelLayout Layout;
+	switch (image.get_format())
+	{
+	case GL_BGRA_EXT:	Layout = ESourcePixelLayout::BGRA8; break;
+	case GL_RGBA:		Layout = ESourcePixelLayout::RGBA8; break;
+	case GL_BGR_EXT:	Layout = ESourcePixelLayout::BGR8; break;
+	case GL_RGB:		Layout = ESourcePixelLayout::RGB8; break;
+	case GL_LUMINANCE:	Layout = ESourcePixelLayout::Gray8; break;
+	default:
+		UE_LOG(LogTemp, Error, TEXT("Unsupported DDS volume format: %s"), *ImagePath);
+		return false;
+	}
+
+	// The slices are stored one after the other, so the volume converts as one tall image
+	if (static_cast<int64>(OutWidth) * OutHeight * OutDepth * 4 > MAX_int32)
+	{
+		UE_LOG(LogTemp, Error, TEXT("DDS volume too large: %s"), *ImagePath);
+		return false;
+	}
+
+	OutFormat = EPixelFormat::PF_B8G8R8A8;
+	OutData.SetNumUninitialized(OutWidth * OutHeight * OutDepth * 4);
+	FPixelFormatConversion::ConvertToBGRA8(static_cast<uint8_t*>(Surface), 0, Layout, OutWidth, OutHeight * OutDepth, OutData.GetData());
+	return true;
+}
+
+
+
+
+UTexture2D* UImageLoader::LoadDDSFromDisk(UObject* Outer, const FString& ImagePath, ETextureResolutionTier Tier)
+{
+	if (UTexture2D* CachedTexture = LoadCachedTexture(Outer, ImagePath, Tier))
+	{
+		return CachedTexture;
+	}
+
+	nv_dds::CDDSImage image;
+	bool flip_image = false;
+
+	try
+	{
+		image.load(TCHAR_TO_UTF8(*ImagePath), flip_image);
 	}
 	catch (const std::exception& ex)
 	{
@@ -173,11 +608,31 @@ UTexture2D* UImageLoader::LoadDDSFromDisk(UObject* Outer, const FString& ImagePa
 		return nullptr;
 	}
 
+	return CreateDDSTexture(Outer, image, ImagePath, Tier);
+}
+
+// Creates the texture of a loaded DXT1/DXT5 image from the mip level matching the tier
+static UTexture2D* CreateDDSTexture(UObject* Outer, nv_dds::CDDSImage& image, const FString& ImagePath, ETextureResolutionTier Tier)
+{
+	if (image.get_format_dxt() != nv_dds::DXT1 && image.get_format_dxt() != nv_dds::DXT5)
+	{
+		UE_LOG(LogTemp, Error, TEXT("%Unsupported DXT format: %s"), *ImagePath);
+		return nullptr;
+	}
 
 	try
 	{
-		int32 SizeX = image.get_width();
-		int32 SizeY = image.get_height();
+		// nv_dds keeps the base level as the image surface and the smaller levels as its mipmaps.
+		// Use the mip matching the tier, as long as it is still made of whole blocks.
+		int32 MipLevel = FMath::Min(static_cast<int32>(Tier), static_cast<int32>(image.get_num_mipmaps()));
+		while (MipLevel > 0 && ((image.get_mipmap(MipLevel - 1).get_width() % 4) != 0 || (image.get_mipmap(MipLevel - 1).get_height() % 4) != 0))
+		{
+			--MipLevel;
+		}
+		const nv_dds::CSurface& Surface = (MipLevel > 0) ? image.get_mipmap(MipLevel - 1) : image.get_surface(0);
+
+		int32 SizeX = Surface.get_width();
+		int32 SizeY = Surface.get_height();
 		int32 BlockSizeX = 4;
 		int32 BlockSizeY = 4;
 		int32 BlockBytes = 16;
@@ -203,11 +658,14 @@ UTexture2D* UImageLoader::LoadDDSFromDisk(UObject* Outer, const FString& ImagePa
 		Mip->SizeX = SizeX;
 		Mip->SizeY = SizeY;
 		Mip->BulkData.Lock(LOCK_READ_WRITE);
-		void* TextureData = Mip->BulkData.Realloc(image.get_size());
-		FMemory::Memcpy(TextureData, image, image.get_size());
+		void* TextureData = Mip->BulkData.Realloc(Surface.get_size());
+		FMemory::Memcpy(TextureData, (uint8_t*)Surface, Surface.get_size());
 		Mip->BulkData.Unlock();
+
+		FImageFrameCache::Get().Store(ImagePath, static_cast<int32>(Tier), (uint8_t*)Surface, Surface.get_size(), SizeX, SizeY, NewTexture->PlatformData->PixelFormat,
+			image.get_width(), image.get_height());
 		NewTexture->UpdateResource();
-		return NewTexture;
+		return SetSourceSize(NewTexture, image.get_width(), image.get_height());
 	}
 	catch (const std::exception& ex)
 	{
@@ -261,3 +719,16 @@ bool UImageLoader::CopyTexture(UTexture2D* SourceTexture2D, UTexture2D* DestText
 	return true;
 }
 
+
+bool UImageLoader::GetSourceSize(UTexture2D* Texture, int32& OutSizeX, int32& OutSizeY)
+{
+	const UImageSourceUserData* SourceData = Texture ? Texture->GetAssetUserData<UImageSourceUserData>() : nullptr;
+	if (!SourceData)
+	{
+		return false;
+	}
+
+	OutSizeX = SourceData->SourceSizeX;
+	OutSizeY = SourceData->SourceSizeY;
+	return true;
+}
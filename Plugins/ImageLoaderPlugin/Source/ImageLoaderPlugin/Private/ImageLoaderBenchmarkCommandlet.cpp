@@ -0,0 +1,448 @@
+#include "ImageLoaderBenchmarkCommandlet.h"
+#include "ImageLoader.h"
+#include "ImageFrameCache.h"
+#include "Engine/Texture2D.h"
+#include "RenderingThread.h"
+#include "RHI.h"
+#include "Async/Async.h"
+#include "HAL/FileManager.h"
+#include "Misc/App.h"
+#include "Misc/DateTime.h"
+#include "Misc/EngineVersion.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "UObject/Package.h"
+#include "UObject/UObjectGlobals.h"
+#include "IImageWrapperModule.h"
+#include "IImageWrapper.h"
+#include "Serialization/JsonWriter.h"
+#include "Policies/PrettyJsonPrintPolicy.h"
+#include "nv_dds.h"
+
+
+// GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, which nv_dds only defines in its source
+static const unsigned int DDSFormatDXT1 = 0x83F1;
+
+static const int32 JpegQuality = 85;
+
+// CreateTexture does not depend on the content, so a few source images are cycled
+static const int32 CreateTextureSources = 4;
+
+
+struct FBenchmarkRun
+{
+	FString Stage;
+	FString Format;
+	int32 Width = 0;
+	int32 Height = 0;
+	int32 Threads = 0;
+	int32 Failures = 0;
+	int64 InputBytes = 0;
+	double Seconds = 0.0;
+	TArray<double> LatenciesMs;
+};
+
+
+/** Frame content with gradients, hard edges and noise, so it compresses neither trivially nor not at all. */
+static void GenerateImage(int32 Width, int32 Height, int32 Seed, TArray<uint8>& OutPixels)
+{
+	OutPixels.SetNumUninitialized(Width * Height * 4);
+	uint8* Pixel = OutPixels.GetData();
+
+	for (int32 Y = 0; Y < Height; ++Y)
+	{
+		for (int32 X = 0; X < Width; ++X, Pixel += 4)
+		{
+			uint32 Hash = (X * 73856093u) ^ (Y * 19349663u) ^ (Seed * 83492791u);
+			Hash ^= Hash >> 13;
+			Hash *= 0x5bd1e995u;
+			const uint8 Noise = static_cast<uint8>(Hash >> 27);
+
+			Pixel[0] = static_cast<uint8>(X * 255 / Width + Seed * 7) ^ Noise;
+			Pixel[1] = static_cast<uint8>(Y * 255 / Height) ^ Noise;
+			Pixel[2] = (((X + Seed * 16) / 64 + Y / 64) & 1) ? 220 : 40;
+			Pixel[3] = 255;
+		}
+	}
+}
+
+static FORCEINLINE uint16 ToRGB565(const uint8* BGRA)
+{
+	return static_cast<uint16>(((BGRA[2] >> 3) << 11) | ((BGRA[1] >> 2) << 5) | (BGRA[0] >> 3));
+}
+
+/** Crude DXT1 compression, endpoints from the bounding box of each block. Only the layout of the output matters here. */
+static void EncodeDXT1(const TArray<uint8>& Pixels, int32 Width, int32 Height, TArray<uint8>& OutBlocks)
+{
+	OutBlocks.SetNumUninitialized((Width / 4) * (Height / 4) * 8);
+	uint8* Block = OutBlocks.GetData();
+
+	for (int32 BlockY = 0; BlockY < Height; BlockY += 4)
+	{
+		for (int32 BlockX = 0; BlockX < Width; BlockX += 4, Block += 8)
+		{
+			uint8 Min[3] = { 255, 255, 255 }, Max[3] = { 0, 0, 0 };
+			for (int32 Index = 0; Index < 16; ++Index)
+			{
+				const uint8* Pixel = Pixels.GetData() + ((BlockY + Index / 4) * Width + BlockX + Index % 4) * 4;
+				for (int32 Channel = 0; Channel < 3; ++Channel)
+				{
+					Min[Channel] = FMath::Min(Min[Channel], Pixel[Channel]);
+					Max[Channel] = FMath::Max(Max[Channel], Pixel[Channel]);
+				}
+			}
+
+			// Four color mode needs Color0 > Color1, a flat block simply uses index 0
+			uint16 Color0 = ToRGB565(Max), Color1 = ToRGB565(Min);
+			const bool Swapped = (Color0 < Color1);
+			if (Swapped)
+				Swap(Color0, Color1);
+
+			uint32 Indices = 0;
+			if (Color0 != Color1)
+			{
+				// Palette order is Color0, Color1, 2/3 Color0 + 1/3 Color1, 1/3 Color0 + 2/3 Color1
+				static const uint32 Palette[4] = { 1, 3, 2, 0 };
+				const int32 Range = FMath::Max(1, (Max[0] - Min[0]) + (Max[1] - Min[1]) + (Max[2] - Min[2]));
+
+				for (int32 Index = 0; Index < 16; ++Index)
+				{
+					const uint8* Pixel = Pixels.GetData() + ((BlockY + Index / 4) * Width + BlockX + Index % 4) * 4;
+					const int32 Distance = (Pixel[0] - Min[0]) + (Pixel[1] - Min[1]) + (Pixel[2] - Min[2]);
+					const int32 Step = FMath::Min(3, Distance * 4 / Range);
+					Indices |= Palette[Swapped ? 3 - Step : Step] << (Index * 2);
+				}
+			}
+
+			FMemory::Memcpy(Block, &Color0, 2);
+			FMemory::Memcpy(Block + 2, &Color1, 2);
+			FMemory::Memcpy(Block + 4, &Indices, 4);
+		}
+	}
+}
+
+static bool WriteCorpusFile(const FString& Path, const FString& Format, int32 Width, int32 Height, const TArray<uint8>& Pixels)
+{
+	if (Format == TEXT("dds"))
+	{
+		TArray<uint8> Blocks;
+		EncodeDXT1(Pixels, Width, Height, Blocks);
+
+		try
+		{
+			nv_dds::CDDSImage image;
+			image.create_textureFlat(DDSFormatDXT1, 4, nv_dds::CTexture(Width, Height, 1, Blocks.Num(), Blocks.GetData()));
+			image.save(TCHAR_TO_UTF8(*Path), false);
+			return true;
+		}
+		catch (std::exception& ex)
+		{
+			UE_LOG(LogTemp, Error, TEXT("%s Failed to save nv_dds image file: %s"), UTF8_TO_TCHAR(ex.what()), *Path);
+			return false;
+		}
+	}
+
+	IImageWrapperModule& ImageWrapperModule = FModuleManager::LoadModuleChecked<IImageWrapperModule>(TEXT("ImageWrapper"));
+	const bool Jpeg = (Format == TEXT("jpg"));
+	TSharedPtr<IImageWrapper> ImageWrapper = ImageWrapperModule.CreateImageWrapper(Jpeg ? EImageFormat::JPEG : EImageFormat::PNG);
+	if (!ImageWrapper.IsValid() || !ImageWrapper->SetRaw(Pixels.GetData(), Pixels.Num(), Width, Height, ERGBFormat::BGRA, 8))
+		return false;
+
+	return FFileHelper::SaveArrayToFile(ImageWrapper->GetCompressed(Jpeg ? JpegQuality : 0), *Path);
+}
+
+
+/**
+Runs Work on NumItems items from Threads threads, timing every item.
+@return Wall time in seconds.
+*/
+static double RunParallel(int32 NumItems, int32 Threads, TFunctionRef<bool(int32 Item)> Work, TArray<double>& OutLatenciesMs, int32& OutFailures)
+{
+	FThreadSafeCounter Next;
+	FThreadSafeCounter Failures;
+	TArray<TArray<double>> ThreadLatencies;
+	ThreadLatencies.SetNum(Threads);
+
+	TArray<TFuture<void>> Workers;
+	const double StartTime = FPlatformTime::Seconds();
+
+	for (int32 Thread = 0; Thread < Threads; ++Thread)
+	{
+		TArray<double>* Latencies = &ThreadLatencies[Thread];
+		Workers.Add(Async(EAsyncExecution::Thread, [&Next, &Failures, &Work, Latencies, NumItems]()
+		{
+			for (int32 Item = Next.Increment() - 1; Item < NumItems; Item = Next.Increment() - 1)
+			{
+				const uint64 StartCycles = FPlatformTime::Cycles64();
+				if (!Work(Item))
+					Failures.Increment();
+				Latencies->Add(FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles));
+			}
+		}));
+	}
+
+	for (TFuture<void>& Worker : Workers)
+		Worker.Wait();
+
+	const double Seconds = FPlatformTime::Seconds() - StartTime;
+
+	for (const TArray<double>& Latencies : ThreadLatencies)
+		OutLatenciesMs.Append(Latencies);
+	OutFailures += Failures.GetValue();
+
+	return Seconds;
+}
+
+/**
+Runs a stage over Frames items per iteration. The textures of an iteration are collected before the next one,
+outside of the measured time, so memory stays bounded by one iteration.
+*/
+static FBenchmarkRun RunStage(const FString& Stage, const FString& Format, int32 Width, int32 Height, int32 Threads, int32 Frames, int32 Iterations,
+	const TArray<int64>& ItemBytes, TFunctionRef<UTexture2D*(int32 Item)> Load)
+{
+	FBenchmarkRun Run;
+	Run.Stage = Stage;
+	Run.Format = Format;
+	Run.Width = Width;
+	Run.Height = Height;
+	Run.Threads = Threads;
+
+	// Warms up the code paths and modules of the stage, unmeasured
+	Load(0);
+
+	for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+	{
+		Run.Seconds += RunParallel(Frames, Threads, [&Load](int32 Item) { return Load(Item) != nullptr; }, Run.LatenciesMs, Run.Failures);
+
+		FlushRenderingCommands();
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+	}
+
+	for (int32 Item = 0; Item < Frames; ++Item)
+		Run.InputBytes += ItemBytes[Item % ItemBytes.Num()] * Iterations;
+
+	Run.LatenciesMs.Sort();
+	return Run;
+}
+
+static double Percentile(const TArray<double>& Sorted, double Fraction)
+{
+	if (Sorted.Num() == 0)
+		return 0.0;
+	const int32 Index = FMath::Clamp(FMath::CeilToInt(Fraction * Sorted.Num()) - 1, 0, Sorted.Num() - 1);
+	return Sorted[Index];
+}
+
+
+static FString WriteReport(const TArray<FBenchmarkRun>& Runs, int32 Frames, int32 Iterations)
+{
+	FString Json;
+	TSharedRef<TJsonWriter<TCHAR, TPrettyJsonPrintPolicy<TCHAR>>> Writer = TJsonWriterFactory<TCHAR, TPrettyJsonPrintPolicy<TCHAR>>::Create(&Json);
+
+	Writer->WriteObjectStart();
+	Writer->WriteValue(TEXT("version"), 1);
+	Writer->WriteValue(TEXT("timestamp"), FDateTime::UtcNow().ToIso8601());
+
+	Writer->WriteObjectStart(TEXT("build"));
+	Writer->WriteValue(TEXT("engineVersion"), FEngineVersion::Current().ToString());
+	Writer->WriteValue(TEXT("buildVersion"), FString(FApp::GetBuildVersion()));
+	Writer->WriteValue(TEXT("configuration"), FString(LexToString(FApp::GetBuildConfiguration())));
+	Writer->WriteValue(TEXT("rhi"), GDynamicRHI ? FString(GDynamicRHI->GetName()) : FString(TEXT("None")));
+	Writer->WriteObjectEnd();
+
+	Writer->WriteObjectStart(TEXT("machine"));
+	Writer->WriteValue(TEXT("platform"), FString(FPlatformProperties::IniPlatformName()));
+	Writer->WriteValue(TEXT("cpu"), FPlatformMisc::GetCPUBrand().TrimStartAndEnd());
+	Writer->WriteValue(TEXT("cores"), FPlatformMisc::NumberOfCores());
+	Writer->WriteValue(TEXT("logicalCores"), FPlatformMisc::NumberOfCoresIncludingHyperthreads());
+	Writer->WriteValue(TEXT("memoryGB"), static_cast<int32>(FPlatformMemory::GetConstants().TotalPhysicalGB));
+	Writer->WriteObjectEnd();
+
+	Writer->WriteValue(TEXT("framesPerIteration"), Frames);
+	Writer->WriteValue(TEXT("iterations"), Iterations);
+
+	Writer->WriteArrayStart(TEXT("runs"));
+	for (const FBenchmarkRun& Run : Runs)
+	{
+		const int32 Completed = Run.LatenciesMs.Num() - Run.Failures;
+		const double Seconds = FMath::Max(Run.Seconds, SMALL_NUMBER);
+
+		Writer->WriteObjectStart();
+		Writer->WriteValue(TEXT("stage"), Run.Stage);
+		Writer->WriteValue(TEXT("format"), Run.Format);
+		Writer->WriteValue(TEXT("width"), Run.Width);
+		Writer->WriteValue(TEXT("height"), Run.Height);
+		Writer->WriteValue(TEXT("threads"), Run.Threads);
+		Writer->WriteValue(TEXT("frames"), Completed);
+		Writer->WriteValue(TEXT("failures"), Run.Failures);
+		Writer->WriteValue(TEXT("seconds"), Run.Seconds);
+		Writer->WriteValue(TEXT("inputBytes"), Run.InputBytes);
+		Writer->WriteValue(TEXT("mbPerSecond"), Run.InputBytes / (1024.0 * 1024.0) / Seconds);
+		Writer->WriteValue(TEXT("framesPerSecond"), Completed / Seconds);
+
+		Writer->WriteObjectStart(TEXT("latencyMs"));
+		Writer->WriteValue(TEXT("min"), Run.LatenciesMs.Num() ? Run.LatenciesMs[0] : 0.0);
+		Writer->WriteValue(TEXT("p50"), Percentile(Run.LatenciesMs, 0.5));
+		Writer->WriteValue(TEXT("p99"), Percentile(Run.LatenciesMs, 0.99));
+		Writer->WriteValue(TEXT("max"), Run.LatenciesMs.Num() ? Run.LatenciesMs.Last() : 0.0);
+		Writer->WriteObjectEnd();
+
+		Writer->WriteObjectEnd();
+	}
+	Writer->WriteArrayEnd();
+
+	Writer->WriteObjectEnd();
+	Writer->Close();
+	return Json;
+}
+
+
+/** Parses a comma separated list, e.g. -Threads=1,4,8 */
+static TArray<FString> ParseList(const TCHAR* Params, const TCHAR* Name, const TCHAR* Default)
+{
+	// The whole comma separated list, FParse stops at the first comma by default
+	FString Value = Default;
+	FParse::Value(Params, Name, Value, false);
+
+	TArray<FString> List;
+	Value.ParseIntoArray(List, TEXT(","), true);
+	return List;
+}
+
+
+UImageLoaderBenchmarkCommandlet::UImageLoaderBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UImageLoaderBenchmarkCommandlet::Main(const FString& Params)
+{
+	const TArray<FString> Formats = ParseList(*Params, TEXT("Formats="), TEXT("png,jpg,dds"));
+	const TArray<FString> Sizes = ParseList(*Params, TEXT("Sizes="), TEXT("1024x1024,1920x1080,3840x2160"));
+	const TArray<FString> ThreadCounts = ParseList(*Params, TEXT("Threads="), *FString::Printf(TEXT("1,4,%d"), FPlatformMisc::NumberOfCoresIncludingHyperthreads()));
+
+	int32 Frames = 16;
+	int32 Iterations = 4;
+	FParse::Value(*Params, TEXT("Frames="), Frames);
+	FParse::Value(*Params, TEXT("Iterations="), Iterations);
+	Frames = FMath::Max(1, Frames);
+	Iterations = FMath::Max(1, Iterations);
+
+	const FString BenchmarkDir = FPaths::ProjectSavedDir() / TEXT("ImageLoaderBenchmark");
+	FString CorpusDir = BenchmarkDir / TEXT("Corpus");
+	FString OutputFile = BenchmarkDir / FString::Printf(TEXT("ImageLoaderBenchmark-%s.json"), *FDateTime::Now().ToString());
+	FParse::Value(*Params, TEXT("Corpus="), CorpusDir);
+	FParse::Value(*Params, TEXT("Output="), OutputFile);
+	const bool Regenerate = FParse::Param(*Params, TEXT("Regenerate"));
+
+	if (!GUsingNullRHI)
+		UE_LOG(LogTemp, Warning, TEXT("ImageLoaderBenchmark: Not running with -nullrhi, texture creation includes the upload to the GPU"));
+
+	// Cached frames would skip the decoding being measured
+	FImageFrameCache::Get().Configure(FString(), 0);
+	IFileManager::Get().MakeDirectory(*CorpusDir, true);
+
+	TArray<FBenchmarkRun> Runs;
+	UObject* Outer = GetTransientPackage();
+
+	for (const FString& Size : Sizes)
+	{
+		FString WidthStr, HeightStr;
+		if (!Size.Split(TEXT("x"), &WidthStr, &HeightStr))
+			WidthStr = HeightStr = Size;
+
+		const int32 Width = FCString::Atoi(*WidthStr);
+		const int32 Height = FCString::Atoi(*HeightStr);
+		if (Width <= 0 || Height <= 0 || Width % 4 != 0 || Height % 4 != 0)
+		{
+			UE_LOG(LogTemp, Error, TEXT("ImageLoaderBenchmark: Invalid size %s, sizes are multiples of 4"), *Size);
+			continue;
+		}
+
+		// Sources of the CreateTexture stage, generated once per size
+		TArray<TArray<uint8>> Sources;
+		Sources.SetNum(CreateTextureSources);
+
+		for (const FString& Format : Formats)
+		{
+			if (Format != TEXT("png") && Format != TEXT("jpg") && Format != TEXT("dds"))
+			{
+				UE_LOG(LogTemp, Error, TEXT("ImageLoaderBenchmark: Unsupported format %s"), *Format);
+				continue;
+			}
+
+			TArray<FString> Files;
+			TArray<int64> FileBytes;
+			for (int32 Frame = 0; Frame < Frames; ++Frame)
+			{
+				const FString Path = CorpusDir / FString::Printf(TEXT("%s_%dx%d_%03d.%s"), *Format, Width, Height, Frame, *Format);
+				if (Regenerate || IFileManager::Get().FileSize(*Path) <= 0)
+				{
+					TArray<uint8>& Pixels = Sources[Frame % CreateTextureSources];
+					GenerateImage(Width, Height, Frame, Pixels);
+					if (!WriteCorpusFile(Path, Format, Width, Height, Pixels))
+					{
+						UE_LOG(LogTemp, Error, TEXT("ImageLoaderBenchmark: Could not write %s"), *Path);
+						return 1;
+					}
+				}
+
+				Files.Add(Path);
+				FileBytes.Add(IFileManager::Get().FileSize(*Path));
+			}
+
+			UE_LOG(LogTemp, Display, TEXT("ImageLoaderBenchmark: %s %dx%d"), *Format, Width, Height);
+
+			const bool Dds = (Format == TEXT("dds"));
+			for (const FString& ThreadCount : ThreadCounts)
+			{
+				const int32 Threads = FMath::Max(1, FCString::Atoi(*ThreadCount));
+				Runs.Add(RunStage(Dds ? TEXT("LoadDDSFromDisk") : TEXT("LoadImageFromDisk"), Format, Width, Height, Threads, Frames, Iterations, FileBytes, [&](int32 Item)
+				{
+					return Dds ? UImageLoader::LoadDDSFromDisk(Outer, Files[Item]) : UImageLoader::LoadImageFromDisk(Outer, Files[Item]);
+				}));
+			}
+		}
+
+		for (int32 Source = 0; Source < CreateTextureSources; ++Source)
+		{
+			if (Sources[Source].Num() == 0)
+				GenerateImage(Width, Height, Source, Sources[Source]);
+		}
+
+		const TArray<int64> PixelBytes = { static_cast<int64>(Width) * Height * 4 };
+		for (const FString& ThreadCount : ThreadCounts)
+		{
+			const int32 Threads = FMath::Max(1, FCString::Atoi(*ThreadCount));
+			Runs.Add(RunStage(TEXT("CreateTexture"), TEXT("bgra8"), Width, Height, Threads, Frames, Iterations, PixelBytes, [&](int32 Item)
+			{
+				return UImageLoader::CreateTexture(Outer, Sources[Item % CreateTextureSources], Width, Height);
+			}));
+		}
+	}
+
+	for (const FBenchmarkRun& Run : Runs)
+	{
+		const double Seconds = FMath::Max(Run.Seconds, SMALL_NUMBER);
+		UE_LOG(LogTemp, Display, TEXT("%-18s %-5s %5dx%-5d %2d threads: %8.1f MB/s %7.1f frames/s  p50 %7.2f ms  p99 %7.2f ms%s"),
+			*Run.Stage, *Run.Format, Run.Width, Run.Height, Run.Threads, Run.InputBytes / (1024.0 * 1024.0) / Seconds,
+			(Run.LatenciesMs.Num() - Run.Failures) / Seconds, Percentile(Run.LatenciesMs, 0.5), Percentile(Run.LatenciesMs, 0.99),
+			Run.Failures ? *FString::Printf(TEXT("  (%d failed)"), Run.Failures) : TEXT(""));
+	}
+
+	if (!FFileHelper::SaveStringToFile(WriteReport(Runs, Frames, Iterations), *OutputFile))
+	{
+		UE_LOG(LogTemp, Error, TEXT("ImageLoaderBenchmark: Could not write %s"), *OutputFile);
+		return 1;
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("ImageLoaderBenchmark: Results written to %s"), *FPaths::ConvertRelativePathToFull(OutputFile));
+
+	int32 Failures = 0;
+	for (const FBenchmarkRun& Run : Runs)
+		Failures += Run.Failures;
+	return Failures > 0 ? 1 : 0;
+}
@@ -1,7 +1,13 @@
 #include "ImageLoaderManager.h"
 #include "TextureBuffer.h"
+#include "TileDeltaBuffer.h"
+#include "VolumeFlipbook.h"
 #include "ImageLoader.h"
+#include "ImageFrameCache.h"
+#include "HttpFrameSource.h"
+#include "TextureBufferPlayerTicker.h"
 #include "Engine.h"
+#include "Misc/ConfigCacheIni.h"
 #include "Runtime/Core/Public/Async/ParallelFor.h"
 #include "Runtime/Core/Public/HAL/FileManagerGeneric.h"
 #include "Runtime/Core/Public/Misc/Paths.h"
@@ -41,76 +47,162 @@ void UImageLoaderManager::Release()
 			ImgSeq->ReleaseBuffer();
 			ImgSeq = nullptr;
 		}
+		FHttpFrameSource::Get().RemoveSequence(Elem.Key);
 	}
 	LoaderMngr->ImgTextureBufferMap.Empty();
+
+	for (auto& Elem : LoaderMngr->TileDeltaBufferMap)
+	{
+		if (Elem.Value && !Elem.Value->IsLoading())
+			Elem.Value->ReleaseBuffer();
+	}
+	LoaderMngr->TileDeltaBufferMap.Empty();
+
+	for (auto& Elem : LoaderMngr->VolumeFlipbookMap)
+	{
+		if (Elem.Value)
+			Elem.Value->ReleaseBuffer();
+	}
+	LoaderMngr->VolumeFlipbookMap.Empty();
+
 	LoaderMngr->ImageLoadingQueueSize = 0;
 	LoaderMngr->ImagePreLoadingQueueSize = 0;
 	LoaderMngr->ImageLoadingPriorityQueue.Empty();
 	LoaderMngr->ImageLoadingQueue.Empty();
+	LoaderMngr->ImageLoadingBackgroundQueue.Empty();
+	LoaderMngr->WarmUpBuffers.Empty();
 }
 
 
 
 
-UTextureBuffer* UImageLoaderManager::LoadImageSequence(UObject* Outer, const FString& Path, bool PingPong, float FrameIntervalInSec, int32 MaxImagesCount, int32 TemporalResolution)
+bool UImageLoaderManager::BuildFileList(const FString& Path, bool PingPong, int32 MaxImagesCount, int32 TemporalResolution, TArray<FString>& FileList)
 {
 	if (Path.IsEmpty())
 	{
 		UE_LOG(LogTemp, Error, TEXT("ImageLoaderManager: File list path is null"));
-		return nullptr;
+		return false;
 	}
 
 	if (!FPaths::FileExists(Path) && !FPaths::DirectoryExists(Path))
 	{
 		UE_LOG(LogTemp, Error, TEXT("ImageLoaderManager: File list or directory does not exist: %s"), *Path);
-		return nullptr;
+		return false;
 	}
-	
-	FName SequenceName = FName(*FPaths::GetPathLeaf(Path));
 
-	if (LoaderMngr->ImgTextureBufferMap.Contains(SequenceName))
+	if (FPaths::DirectoryExists(Path))
 	{
-		return &(*LoaderMngr->ImgTextureBufferMap[SequenceName]);
+		FileList = GetAllFilesInDirectory(Path);
 	}
-	else
+	else if (!FFileHelper::LoadFileToStringArray(FileList, *Path))
 	{
-		TArray<FString> FileList;
-		if (FPaths::DirectoryExists(Path))
-		{
-			FileList = GetAllFilesInDirectory(Path);
-		}
-		else if (!FFileHelper::LoadFileToStringArray(FileList, *Path))
-		{
-			UE_LOG(LogTemp, Error, TEXT("ImageLoaderManager: Could not load path %s"), *Path);
-			return nullptr;
-		}
+		UE_LOG(LogTemp, Error, TEXT("ImageLoaderManager: Could not load path %s"), *Path);
+		return false;
+	}
+
+	if (FileList.Num() < 1)
+	{
+		UE_LOG(LogTemp, Error, TEXT("ImageLoaderManager: The path is invalid or there is no file in it %s"), *Path);
+		return false;
+	}
+
+	ReduceFileList(PingPong, MaxImagesCount, TemporalResolution, FileList);
+	return true;
+}
+
+
+void UImageLoaderManager::ReduceFileList(bool PingPong, int32 MaxImagesCount, int32 TemporalResolution, TArray<FString>& FileList)
+{
+	if (PingPong)
+	{
+		FileList.SetNum(FileList.Num() / 2 + 1, true);
+	}
+
+	if (MaxImagesCount > 0 && MaxImagesCount < FileList.Num())
+	{
+		FileList.SetNum(MaxImagesCount, true);
+	}
+
+	if (TemporalResolution < 1)
+		TemporalResolution = 1;
+
+	TArray<FString> FileListNewRes;
+	for (int32 Idx = 0; Idx < FileList.Num(); Idx += TemporalResolution)
+	{
+		FileListNewRes.Add(FileList[Idx]);
+	}
+	FileList = FileListNewRes;
+}
 
-		if (FileList.Num() < 1)
-		{
-			UE_LOG(LogTemp, Error, TEXT("ImageLoaderManager: The path is invalid or there is no file in it %s"), *Path);
-			return nullptr;
-		}
 
-		if (PingPong)
+UTextureBuffer* UImageLoaderManager::LoadImageSequence(UObject* Outer, const FString& Path, bool PingPong, float FrameIntervalInSec, int32 MaxImagesCount, int32 TemporalResolution, EImageSequenceLoadPriority Priority,
+	ETextureResolutionTier LowestTier)
+{
+	FName SequenceName = FName(*FPaths::GetPathLeaf(Path));
+
+	if (LoaderMngr->ImgTextureBufferMap.Contains(SequenceName))
+	{
+		// Attach to the buffer, which may still be loading, e.g. from the warm-up list
+		UTextureBuffer* TexBuffer = LoaderMngr->ImgTextureBufferMap[SequenceName];
+		PromoteTextureBuffer(TexBuffer, Priority);
+
+		// The finest of the requested limits wins, reloading if the buffer is already coarser
+		if (LowestTier < TexBuffer->LowestResolutionTier)
 		{
-			FileList.SetNum(FileList.Num() / 2 + 1, true);
+			TexBuffer->LowestResolutionTier = LowestTier;
+			if (TexBuffer->ResolutionTier > LowestTier)
+				TexBuffer->RequestResolutionTier(LowestTier);
 		}
+		return TexBuffer;
+	}
+	else if (FHttpFrameSource::IsUrl(Path))
+	{
+		// The buffer is returned right away and starts loading once its manifest has been downloaded
+		FName TexBufferName = MakeUniqueObjectName(Outer, UTexture2D::StaticClass(), SequenceName);
+		UTextureBuffer* TexBuffer = NewObject<UTextureBuffer>(Outer, UTextureBuffer::StaticClass(), TexBufferName);
+		TexBuffer->SequenceName = SequenceName;
+		TexBuffer->PingPong = PingPong;
+		TexBuffer->FrameIntervalInSec = FrameIntervalInSec;
+		TexBuffer->LoadPriority = Priority;
+		TexBuffer->LowestResolutionTier = LowestTier;
+		LoaderMngr->ImgTextureBufferMap.Add(SequenceName, TexBuffer);
 
-		if (MaxImagesCount > 0 && MaxImagesCount < FileList.Num())
+		TWeakObjectPtr<UTextureBuffer> WeakBuffer(TexBuffer);
+		FHttpFrameSource::Get().FetchManifest(Path, [WeakBuffer, Path, PingPong, MaxImagesCount, TemporalResolution](const TArray<FString>& FrameUrls)
 		{
-			FileList.SetNum(MaxImagesCount, true);
-		}
+			if (!WeakBuffer.IsValid() || !LoaderMngr || !LoaderMngr->ImgTextureBufferMap.FindKey(WeakBuffer.Get()))
+				return;
+
+			if (FrameUrls.Num() < 1)
+			{
+				UE_LOG(LogTemp, Error, TEXT("ImageLoaderManager: There is no frame in the manifest %s"), *Path);
+				return;
+			}
+
+			WeakBuffer->FileList = FrameUrls;
+			ReduceFileList(PingPong, MaxImagesCount, TemporalResolution, WeakBuffer->FileList);
 
-		if (TemporalResolution < 1)
-			TemporalResolution = 1;
+			// Downloads waiting for a request slot go by their distance from the frame being played
+			FHttpFrameSource::Get().SetSequenceFrames(WeakBuffer->SequenceName, WeakBuffer->FileList, [WeakBuffer]()
+			{
+				return WeakBuffer.IsValid() ? WeakBuffer->GetIndex() : 0;
+			});
 
-		TArray<FString> FileListNewRes;
-		for (int32 Idx = 0; Idx < FileList.Num(); Idx += TemporalResolution)
+			if (GetMemoryOverrun() > 0)
+				WeakBuffer->RequestResolutionTier(ETextureResolutionTier::E_Half);
+
+			WeakBuffer->LoadImageSequence();
+		});
+
+		return TexBuffer;
+	}
+	else
+	{
+		TArray<FString> FileList;
+		if (!BuildFileList(Path, PingPong, MaxImagesCount, TemporalResolution, FileList))
 		{
-			FileListNewRes.Add(FileList[Idx]);
+			return nullptr;
 		}
-		FileList = FileListNewRes;
-		
 		
         FName TexBufferName = MakeUniqueObjectName(Outer, UTexture2D::StaticClass(), SequenceName);
 		UTextureBuffer* TexBuffer = NewObject<UTextureBuffer>(Outer, UTextureBuffer::StaticClass(), TexBufferName);
@@ -120,23 +212,216 @@ UTextureBuffer* UImageLoaderManager::LoadImageSequence(UObject* Outer, const FSt
         TexBuffer->PingPong = PingPong;
         TexBuffer->FrameIntervalInSec = FrameIntervalInSec;
 		TexBuffer->FileList = FileList;
+		TexBuffer->LoadPriority = Priority;
+		TexBuffer->LowestResolutionTier = LowestTier;
+
+		// Start reduced right away if memory is already short, instead of loading at full size and reloading
+		if (GetMemoryOverrun() > 0)
+			TexBuffer->RequestResolutionTier(ETextureResolutionTier::E_Half);
+
 		TexBuffer->LoadImageSequence();
 
 		return TexBuffer;
 	}
 }
 
+
+UTileDeltaBuffer* UImageLoaderManager::LoadTileDeltaSequence(UObject* Outer, const FString& Path, float FrameIntervalInSec, int32 MaxImagesCount, int32 TemporalResolution, int32 TileSize)
+{
+	FName SequenceName = FName(*FPaths::GetPathLeaf(Path));
+
+	if (LoaderMngr->TileDeltaBufferMap.Contains(SequenceName))
+	{
+		return LoaderMngr->TileDeltaBufferMap[SequenceName];
+	}
+
+	// Deltas are encoded for forward playback only, so the whole sequence is kept
+	TArray<FString> FileList;
+	if (!BuildFileList(Path, false, MaxImagesCount, TemporalResolution, FileList))
+	{
+		return nullptr;
+	}
+
+	FName BufferName = MakeUniqueObjectName(Outer, UTileDeltaBuffer::StaticClass(), SequenceName);
+	UTileDeltaBuffer* DeltaBuffer = NewObject<UTileDeltaBuffer>(Outer, UTileDeltaBuffer::StaticClass(), BufferName);
+	DeltaBuffer->SequenceName = SequenceName;
+	DeltaBuffer->FrameIntervalInSec = FrameIntervalInSec;
+	DeltaBuffer->TileSize = TileSize;
+	DeltaBuffer->FileList = FileList;
+	LoaderMngr->TileDeltaBufferMap.Add(SequenceName, DeltaBuffer);
+
+	DeltaBuffer->LoadImageSequence();
+
+	return DeltaBuffer;
+}
+
+UVolumeFlipbook* UImageLoaderManager::LoadVolumeFlipbook(UObject* Outer, const FString& Path, float FrameIntervalInSec, int32 MaxImagesCount, int32 TemporalResolution, ETextureResolutionTier Tier)
+{
+	FName SequenceName = FName(*FPaths::GetPathLeaf(Path));
+
+	if (LoaderMngr->VolumeFlipbookMap.Contains(SequenceName))
+	{
+		return LoaderMngr->VolumeFlipbookMap[SequenceName];
+	}
+
+	// A dds volume already holds all frames, anything else is a sequence to pack
+	TArray<FString> FileList;
+	if (FPaths::GetExtension(Path).Equals(TEXT("dds"), ESearchCase::IgnoreCase))
+	{
+		if (!FPaths::FileExists(Path))
+		{
+			UE_LOG(LogTemp, Error, TEXT("ImageLoaderManager: Volume texture does not exist: %s"), *Path);
+			return nullptr;
+		}
+		FileList.Add(Path);
+	}
+	else if (!BuildFileList(Path, false, MaxImagesCount, TemporalResolution, FileList))
+	{
+		return nullptr;
+	}
+
+	FName FlipbookName = MakeUniqueObjectName(Outer, UVolumeFlipbook::StaticClass(), SequenceName);
+	UVolumeFlipbook* Flipbook = NewObject<UVolumeFlipbook>(Outer, UVolumeFlipbook::StaticClass(), FlipbookName);
+	Flipbook->SequenceName = SequenceName;
+	Flipbook->FrameIntervalInSec = FrameIntervalInSec;
+	Flipbook->ResolutionTier = Tier;
+	Flipbook->FileList = FileList;
+	LoaderMngr->VolumeFlipbookMap.Add(SequenceName, Flipbook);
+
+	Flipbook->LoadImageSequence();
+
+	return Flipbook;
+}
+
+void UImageLoaderManager::StartWarmUp(const TArray<FImageSequenceWarmUp>& Sequences)
+{
+	// Higher priorities are enqueued first, so their first frames are also served first
+	TArray<FImageSequenceWarmUp> Sorted = Sequences;
+	Sorted.StableSort([](const FImageSequenceWarmUp& A, const FImageSequenceWarmUp& B) { return A.Priority > B.Priority; });
+
+	for (const FImageSequenceWarmUp& Sequence : Sorted)
+	{
+		UTextureBuffer* TexBuffer = LoadImageSequence(GetTransientPackage(), Sequence.Path, Sequence.PingPong, Sequence.FrameIntervalInSec, Sequence.MaxImages, Sequence.TemporalResolution, Sequence.Priority);
+		if (TexBuffer)
+		{
+			LoaderMngr->WarmUpBuffers.AddUnique(TexBuffer);
+			UE_LOG(LogTemp, Log, TEXT("UImageLoaderManager::StartWarmUp: %s %d frames"), *TexBuffer->SequenceName.ToString(), TexBuffer->FileList.Num());
+		}
+		else
+		{
+			UE_LOG(LogTemp, Error, TEXT("UImageLoaderManager::StartWarmUp: Could not warm up %s"), *Sequence.Path);
+		}
+	}
+}
+
+
+void UImageLoaderManager::StartConfiguredWarmUp(const TCHAR* ConfigSection)
+{
+	TArray<FString> Entries;
+	GConfig->GetArray(ConfigSection, TEXT("WarmUpSequences"), Entries, GGameIni);
+
+	TArray<FImageSequenceWarmUp> Sequences;
+	for (const FString& Entry : Entries)
+	{
+		FImageSequenceWarmUp Sequence;
+		FImageSequenceWarmUp::StaticStruct()->ImportText(*Entry, &Sequence, nullptr, PPF_None, GLog, TEXT("WarmUpSequences"));
+
+		if (Sequence.Path.IsEmpty())
+		{
+			UE_LOG(LogTemp, Error, TEXT("UImageLoaderManager::StartConfiguredWarmUp: Invalid entry %s"), *Entry);
+			continue;
+		}
+		Sequences.Add(Sequence);
+	}
+
+	if (Sequences.Num() > 0)
+		StartWarmUp(Sequences);
+}
+
+
+float UImageLoaderManager::GetWarmUpProgress()
+{
+	int32 TotalFrames = 0;
+	float LoadedFrames = 0.0f;
+
+	for (const UTextureBuffer* TexBuffer : LoaderMngr->WarmUpBuffers)
+	{
+		if (TexBuffer)
+		{
+			TotalFrames += TexBuffer->FileList.Num();
+			LoadedFrames += TexBuffer->GetLoadProgress() * TexBuffer->FileList.Num();
+		}
+	}
+
+	return (TotalFrames > 0) ? LoadedFrames / TotalFrames : 1.0f;
+}
+
+
+bool UImageLoaderManager::IsWarmUpComplete()
+{
+	for (const UTextureBuffer* TexBuffer : LoaderMngr->WarmUpBuffers)
+	{
+		if (TexBuffer && !TexBuffer->IsFinished())
+			return false;
+	}
+	return true;
+}
+
+
+void UImageLoaderManager::SetPlaybackGroupRate(FName Group, float Rate)
+{
+	FTextureBufferPlayerTicker::Get().SetGroupPlaybackRate(Group, Rate);
+}
+
+
+void UImageLoaderManager::SeekPlaybackGroup(FName Group, float Seconds)
+{
+	FTextureBufferPlayerTicker::Get().SeekGroup(Group, Seconds);
+}
+
+
+float UImageLoaderManager::GetPlaybackGroupTime(FName Group)
+{
+	return FTextureBufferPlayerTicker::Get().GetGroupTime(Group);
+}
+
+
 bool UImageLoaderManager::UnloadImageSequence(const FString& Path)
 {
 	FName SequenceName = FName(*FPaths::GetPathLeaf(Path));
 
+	if (LoaderMngr->VolumeFlipbookMap.Contains(SequenceName))
+	{
+		UVolumeFlipbook* Flipbook = LoaderMngr->VolumeFlipbookMap[SequenceName];
+		LoaderMngr->VolumeFlipbookMap.Remove(SequenceName);
+		Flipbook->ReleaseBuffer();
+		return true;
+	}
+
+	if (LoaderMngr->TileDeltaBufferMap.Contains(SequenceName))
+	{
+		UTileDeltaBuffer* DeltaBuffer = LoaderMngr->TileDeltaBufferMap[SequenceName];
+
+		if (DeltaBuffer->IsLoading())
+		{
+			UE_LOG(LogTemp, Error, TEXT("UImageLoaderManager::UnloadImageSequence Cannot unload because it is still encoding tiles %s"), *DeltaBuffer->SequenceName.ToString());
+			return false;
+		}
+
+		LoaderMngr->TileDeltaBufferMap.Remove(SequenceName);
+		DeltaBuffer->ReleaseBuffer();
+		return true;
+	}
+
 	if (LoaderMngr->ImgTextureBufferMap.Contains(SequenceName))
 	{
 		UTextureBuffer*& TexBuffer = LoaderMngr->ImgTextureBufferMap[SequenceName];
 
 		if (!TexBuffer->IsLoading())
 		{
+			LoaderMngr->WarmUpBuffers.Remove(TexBuffer);
 			LoaderMngr->ImgTextureBufferMap.Remove(SequenceName);
+			FHttpFrameSource::Get().RemoveSequence(SequenceName);
 			TexBuffer->ReleaseBuffer();
 			TexBuffer = nullptr;
 			return true;
@@ -152,26 +437,116 @@ bool UImageLoaderManager::UnloadImageSequence(const FString& Path)
 
 bool UImageLoaderManager::IsLoading() const
 {
-	return !LoaderMngr->ImageLoadingQueue.IsEmpty();
+	return !LoaderMngr->ImageLoadingPriorityQueue.IsEmpty() || !LoaderMngr->ImageLoadingQueue.IsEmpty() || !LoaderMngr->ImageLoadingBackgroundQueue.IsEmpty();
 }
 
 bool UImageLoaderManager::LoadTextureBufferImages(UTextureBuffer* TexBuffer)
 {
 	TexBuffer->Status = ETextureBufferStatus::E_Enqueued;
 
+	EnqueueTextureBufferImages(TexBuffer, 0, TexBuffer->BeginLoadGeneration());
+
+	StartImageLoading();
+
+	return true;
+}
+
+
+bool UImageLoaderManager::ReloadTextureBufferImages(UTextureBuffer* TexBuffer)
+{
+	const int32 Num = TexBuffer->FileList.Num();
+	if (Num < 1)
+		return false;
+
+	// Frames closest to the playhead are replaced first
+	EnqueueTextureBufferImages(TexBuffer, FMath::Clamp(TexBuffer->GetIndex(), 0, Num - 1), TexBuffer->BeginLoadGeneration());
+
+	StartImageLoading();
+
+	return true;
+}
+
+
+void UImageLoaderManager::EnqueueTextureBufferImages(UTextureBuffer* TexBuffer, int32 StartIndex, int32 Generation)
+{
+	const int32 Num = TexBuffer->FileList.Num();
 
-	LoaderMngr->ImageLoadingPriorityQueue.Enqueue(TPair<UTextureBuffer*, int32>(TexBuffer, 0));
-	LoaderMngr->ImagePreLoadingQueueSize++;
+	// The first frame goes ahead so the sequence gets a fallback texture early, unless the whole sequence is low priority
+	TQueue<FImageLoadRequest>* FirstQueue = &LoaderMngr->ImageLoadingPriorityQueue;
+	TQueue<FImageLoadRequest>* OtherQueue = &LoaderMngr->ImageLoadingQueue;
+
+	if (!TexBuffer->OnScreen)
+	{
+		// Nobody sees the sequence, it only gets what is left over
+		FirstQueue = &LoaderMngr->ImageLoadingBackgroundQueue;
+		OtherQueue = &LoaderMngr->ImageLoadingBackgroundQueue;
+	}
+	else switch (TexBuffer->LoadPriority)
+	{
+	case EImageSequenceLoadPriority::E_High:
+		OtherQueue = &LoaderMngr->ImageLoadingPriorityQueue;
+		break;
+	case EImageSequenceLoadPriority::E_Low:
+		FirstQueue = &LoaderMngr->ImageLoadingQueue;
+		OtherQueue = &LoaderMngr->ImageLoadingBackgroundQueue;
+		break;
+	default:
+		break;
+	}
 
-	for (int32 Idx = 1; Idx < TexBuffer->FileList.Num(); ++Idx)
+	for (int32 Offset = 0; Offset < Num; ++Offset)
 	{
-		LoaderMngr->ImageLoadingQueue.Enqueue(TPair<UTextureBuffer*, int32>(TexBuffer, Idx));
+		TQueue<FImageLoadRequest>* Queue = (Offset == 0) ? FirstQueue : OtherQueue;
+		Queue->Enqueue(FImageLoadRequest{ TexBuffer, (StartIndex + Offset) % Num, Generation });
 		LoaderMngr->ImagePreLoadingQueueSize++;
 	}
+}
 
-	StartImageLoading();
 
-	return true;
+void UImageLoaderManager::PromoteTextureBuffer(UTextureBuffer* TexBuffer, EImageSequenceLoadPriority Priority)
+{
+	if (!TexBuffer || Priority <= TexBuffer->LoadPriority)
+		return;
+
+	TexBuffer->LoadPriority = Priority;
+	RequeuePendingImages(TexBuffer);
+}
+
+
+void UImageLoaderManager::SetTextureBufferOnScreen(UTextureBuffer* TexBuffer, bool OnScreen)
+{
+	if (!TexBuffer || TexBuffer->OnScreen == OnScreen)
+		return;
+
+	TexBuffer->OnScreen = OnScreen;
+	RequeuePendingImages(TexBuffer);
+}
+
+
+void UImageLoaderManager::SetTextureBufferScreenTier(UTextureBuffer* TexBuffer, ETextureResolutionTier Tier)
+{
+	if (!TexBuffer || TexBuffer->HighestResolutionTier == Tier)
+		return;
+
+	TexBuffer->HighestResolutionTier = Tier;
+	TexBuffer->ScreenTierChangeTime = FPlatformTime::Seconds();
+
+	// Dropping to the coarser tier is always done, raising it only with memory to spare.
+	// Otherwise BalanceMemoryBudget raises it later when there is room.
+	if (Tier > TexBuffer->ResolutionTier || GetMemoryOverrun() < 0)
+		TexBuffer->RequestResolutionTier(Tier);
+}
+
+
+void UImageLoaderManager::RequeuePendingImages(UTextureBuffer* TexBuffer)
+{
+	if (TexBuffer->Status != ETextureBufferStatus::E_Enqueued && TexBuffer->Status != ETextureBufferStatus::E_Loading && !TexBuffer->IsChangingResolutionTier())
+		return;
+
+	// The entries already queued become stale and are dropped when they come up.
+	// Frames dispatched before keep their mark, so they are not loaded twice.
+	EnqueueTextureBufferImages(TexBuffer, FMath::Clamp(TexBuffer->GetIndex(), 0, FMath::Max(0, TexBuffer->FileList.Num() - 1)), TexBuffer->RequeueLoadGeneration());
+	StartImageLoading();
 }
 
 
@@ -187,49 +562,42 @@ bool UImageLoaderManager::StartImageLoading()
 
 bool UImageLoaderManager::LoadImageFromQueue()
 {
-	TPair<UTextureBuffer*, int32> pair;
+	// Background entries are only served when nothing else is waiting
+	TQueue<FImageLoadRequest>* Queues[] = { &LoaderMngr->ImageLoadingPriorityQueue, &LoaderMngr->ImageLoadingQueue, &LoaderMngr->ImageLoadingBackgroundQueue };
 
-	if (LoaderMngr->ImageLoadingPriorityQueue.Dequeue(pair))
-	{
-		LoaderMngr->ImagePreLoadingQueueSize--;
-
-		UTextureBuffer* TexBuffer = pair.Key;
-		int32 Idx = pair.Value;
+	FImageLoadRequest Request;
 
-		if (TexBuffer)
-		{
-			UImageLoader* ImageLoader = UImageLoader::LoadImageFromDiskAsync(TexBuffer, TexBuffer->FileList[Idx], Idx);
-			ImageLoader->OnLoadCompleted().AddDynamic(LoaderMngr, &UImageLoaderManager::OnImageLoadCompleted);
-			ImageLoader->OnLoadCompleted().AddDynamic(TexBuffer, &UTextureBuffer::OnImageLoadCompleted);
-			LoaderMngr->ImageLoadingQueueSize++;
-			
-			return true;
-		}
-		else
+	for (TQueue<FImageLoadRequest>* Queue : Queues)
+	{
+		while (Queue->Dequeue(Request))
 		{
-			UE_LOG(LogTemp, Error, TEXT("UImageLoaderManager::LoadImageFromQueue: Invalid buffer"));
-		}
-	}
+			LoaderMngr->ImagePreLoadingQueueSize--;
 
-	if (LoaderMngr->ImageLoadingQueue.Dequeue(pair))
-	{
-		LoaderMngr->ImagePreLoadingQueueSize--; 
+			UTextureBuffer* TexBuffer = Request.TexBuffer;
+			int32 Idx = Request.Index;
 
-		UTextureBuffer* TexBuffer = pair.Key;
-		int32 Idx = pair.Value;
+			if (!TexBuffer)
+			{
+				UE_LOG(LogTemp, Error, TEXT("UImageLoaderManager::LoadImageFromQueue: Invalid buffer"));
+				continue;
+			}
 
-		if (TexBuffer)
-		{
-			UImageLoader* ImageLoader = UImageLoader::LoadImageFromDiskAsync(TexBuffer, TexBuffer->FileList[Idx], Idx);
+			if (!TexBuffer->TryDispatchFrame(Idx, Request.Generation))
+				continue;
+
+			UImageLoader* ImageLoader = UImageLoader::LoadImageFromDiskAsync(TexBuffer, TexBuffer->FileList[Idx], Idx, TexBuffer->GetLoadingTier());
 			ImageLoader->OnLoadCompleted().AddDynamic(LoaderMngr, &UImageLoaderManager::OnImageLoadCompleted);
 			ImageLoader->OnLoadCompleted().AddDynamic(TexBuffer, &UTextureBuffer::OnImageLoadCompleted);
 			LoaderMngr->ImageLoadingQueueSize++;
+
+			FActiveImageLoad ActiveLoad;
+			ActiveLoad.Loader = ImageLoader;
+			ActiveLoad.TexBuffer = TexBuffer;
+			ActiveLoad.Index = Idx;
+			LoaderMngr->ActiveImageLoads.Add(ActiveLoad);
+
 			return true;
 		}
-		else
-		{
-			UE_LOG(LogTemp, Error, TEXT("UImageLoaderManager::LoadImageFromQueue: Invalid buffer"));
-		}
 	}
 
 	return false;
@@ -239,12 +607,195 @@ bool UImageLoaderManager::LoadImageFromQueue()
 void UImageLoaderManager::OnImageLoadCompleted(UTexture2D* Texture, int32 Idx)
 {
 	LoaderMngr->ImageLoadingQueueSize--;
+	LoaderMngr->ActiveImageLoads.RemoveAll([](const FActiveImageLoad& Load) { return !Load.Loader || Load.Loader->IsCompleted(); });
 	LoadImageFromQueue();
 }
 
 
+bool UImageLoaderManager::CompleteImageLoads(UTextureBuffer* TexBuffer, int32 Index, float MaxWaitSeconds)
+{
+	check(IsInGameThread());
+
+	if (!LoaderMngr || LoaderMngr->ActiveImageLoads.Num() < 1)
+		return false;
+
+	// A frame still queued gets the slot of the oldest load, the next one to finish most likely
+	const FActiveImageLoad* Wanted = LoaderMngr->ActiveImageLoads.FindByPredicate([TexBuffer, Index](const FActiveImageLoad& Load)
+	{
+		return Load.TexBuffer == TexBuffer && Load.Index == Index;
+	});
+	UImageLoader* Waited = Wanted ? Wanted->Loader : LoaderMngr->ActiveImageLoads[0].Loader;
+
+	bool Completed = Waited && Waited->WaitForCompletion(MaxWaitSeconds);
+
+	// Completing a load changes the list, as the next queued frames start
+	TArray<UImageLoader*> Loaded;
+	for (const FActiveImageLoad& Load : LoaderMngr->ActiveImageLoads)
+	{
+		if (Load.Loader && Load.Loader->IsLoaded() && !Load.Loader->IsCompleted())
+			Loaded.Add(Load.Loader);
+	}
+
+	for (UImageLoader* Loader : Loaded)
+		Completed |= Loader->WaitForCompletion(0.0f);
+
+	return Completed;
+}
+
+
 void UImageLoaderManager::OnImageSequenceLoadComplete(int32 ImageCount, FName SequenceName)
 {
+	BalanceMemoryBudget();
+}
+
+
+void UImageLoaderManager::SetTextureMemoryBudget(int32 BudgetMB, int32 MinFreePhysicalMB)
+{
+	LoaderMngr->TextureMemoryBudgetMB = FMath::Max(0, BudgetMB);
+	LoaderMngr->MinFreePhysicalMemoryMB = FMath::Max(0, MinFreePhysicalMB);
+	BalanceMemoryBudget();
+}
+
+
+void UImageLoaderManager::EnableHttpCache(const FString& Directory)
+{
+	const FString CacheDirectory = (Directory.IsEmpty() || !FPaths::IsRelative(Directory)) ? Directory : FPaths::Combine(FPaths::ProjectSavedDir(), Directory);
+	FHttpFrameSource::Get().SetCacheDirectory(CacheDirectory);
+}
+
+
+void UImageLoaderManager::SetMaxParallelHttpRequests(int32 Count)
+{
+	FHttpFrameSource::Get().SetMaxParallelRequests(Count);
+}
+
+
+void UImageLoaderManager::EnableFrameCache(const FString& Directory, int32 MaxSizeMB)
+{
+	if (Directory.IsEmpty())
+	{
+		UE_LOG(LogTemp, Error, TEXT("UImageLoaderManager::EnableFrameCache: Empty cache directory"));
+		return;
+	}
+
+	const FString CacheDirectory = FPaths::IsRelative(Directory) ? FPaths::Combine(FPaths::ProjectSavedDir(), Directory) : Directory;
+	FImageFrameCache::Get().Configure(CacheDirectory, MaxSizeMB);
+}
+
+
+void UImageLoaderManager::DisableFrameCache()
+{
+	FImageFrameCache::Get().Configure(FString(), 0);
+}
+
+
+void UImageLoaderManager::GetFrameCacheStats(int32& Hits, int32& Misses)
+{
+	Hits = FImageFrameCache::Get().GetHitCount();
+	Misses = FImageFrameCache::Get().GetMissCount();
+}
+
+
+bool UImageLoaderManager::WriteFrame(UTexture* Texture, const FString& FilePath, EFrameFileFormat Format)
+{
+	return FFrameWriter::Get().WriteFrame(Texture, FilePath, Format);
+}
+
+bool UImageLoaderManager::FlushFrameWriter(float MaxWaitSeconds)
+{
+	return FFrameWriter::Get().Flush(MaxWaitSeconds);
+}
+
+void UImageLoaderManager::GetFrameWriterStats(int32& Written, int32& Pending, int32& Dropped, int32& Failed)
+{
+	const FFrameWriter& Writer = FFrameWriter::Get();
+	Written = Writer.GetWrittenCount();
+	Pending = Writer.GetPendingCount();
+	Dropped = Writer.GetDroppedCount();
+	Failed = Writer.GetFailedCount();
+}
+
+
+int32 UImageLoaderManager::GetTextureMemoryUsageMB()
+{
+	int64 UsageKb = 0;
+	for (auto& Elem : LoaderMngr->ImgTextureBufferMap)
+	{
+		if (Elem.Value)
+			UsageKb += Elem.Value->GetResidentSizeKb();
+	}
+	return static_cast<int32>(UsageKb >> 10);
+}
+
+
+int64 UImageLoaderManager::GetMemoryOverrun()
+{
+	int64 Overrun = MIN_int64;
+
+	if (LoaderMngr->TextureMemoryBudgetMB > 0)
+	{
+		Overrun = (static_cast<int64>(GetTextureMemoryUsageMB()) - LoaderMngr->TextureMemoryBudgetMB) << 20;
+	}
+
+	const int64 AvailablePhysical = static_cast<int64>(FPlatformMemory::GetStats().AvailablePhysical);
+	const int64 PhysicalShortage = (static_cast<int64>(LoaderMngr->MinFreePhysicalMemoryMB) << 20) - AvailablePhysical;
+
+	return FMath::Max(Overrun, PhysicalShortage);
+}
+
+
+void UImageLoaderManager::BalanceMemoryBudget()
+{
+	// A frame-locked capture keeps its tiers, the output must not depend on memory or timing
+	if (!LoaderMngr || (FTextureBufferPlayerTicker::IsAvailable() && FTextureBufferPlayerTicker::Get().IsFrameLocked()))
+		return;
+
+	TArray<UTextureBuffer*> Buffers;
+	for (auto& Elem : LoaderMngr->ImgTextureBufferMap)
+	{
+		if (Elem.Value && Elem.Value->IsFinished() && !Elem.Value->IsChangingResolutionTier())
+			Buffers.Add(Elem.Value);
+	}
+
+	// Largest sequences first, they free or take the most memory per step
+	Buffers.Sort([](const UTextureBuffer& A, const UTextureBuffer& B) { return A.GetResidentSizeKb() > B.GetResidentSizeKb(); });
+
+	int64 Overrun = GetMemoryOverrun();
+
+	if (Overrun > 0)
+	{
+		// Every tier step frees about three quarters of the resident size
+		for (UTextureBuffer* Buffer : Buffers)
+		{
+			if (Overrun <= 0)
+				break;
+
+			if (Buffer->ResolutionTier < Buffer->LowestResolutionTier)
+			{
+				const ETextureResolutionTier Lower = static_cast<ETextureResolutionTier>(static_cast<uint8>(Buffer->ResolutionTier) + 1);
+				if (Buffer->RequestResolutionTier(Lower))
+					Overrun -= (static_cast<int64>(Buffer->GetResidentSizeKb()) << 10) * 3 / 4;
+			}
+		}
+	}
+	else
+	{
+		// Raise sequences back one step at a time while the fourfold size still fits
+		int64 Headroom = -Overrun;
+		for (UTextureBuffer* Buffer : Buffers)
+		{
+			if (Buffer->ResolutionTier <= Buffer->HighestResolutionTier)
+				continue;
+
+			const int64 Growth = (static_cast<int64>(Buffer->GetResidentSizeKb()) << 10) * 3;
+			if (Growth >= Headroom)
+				continue;
+
+			const ETextureResolutionTier Higher = static_cast<ETextureResolutionTier>(static_cast<uint8>(Buffer->ResolutionTier) - 1);
+			if (Buffer->RequestResolutionTier(Higher))
+				Headroom -= Growth;
+		}
+	}
 }
 
 
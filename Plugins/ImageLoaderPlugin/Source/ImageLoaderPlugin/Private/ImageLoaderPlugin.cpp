@@ -1,18 +1,79 @@
 // Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
 
 #include "ImageLoaderPlugin.h"
+#include "ImageLoaderManager.h"
+#include "TextureBufferPlayerTicker.h"
+#include "FrameWriter.h"
+#include "Misc/ConfigCacheIni.h"
+#include "Misc/CoreDelegates.h"
+#include "Containers/Ticker.h"
+#include "Engine/Engine.h"
 
 #define LOCTEXT_NAMESPACE "FImageLoaderPluginModule"
 
+static const TCHAR* ImageLoaderConfigSection = TEXT("ImageLoaderPlugin");
+
 void FImageLoaderPluginModule::StartupModule()
 {
 	// This code will execute after your module is loaded into memory; the exact timing is specified in the .uplugin file per-module
+	FTextureBufferPlayerTicker::Startup();
+	FFrameWriter::Startup();
+
+	// The frame cache is opt-in, enabled by setting FrameCacheDirectory in DefaultGame.ini
+	FString FrameCacheDirectory;
+	int32 FrameCacheMaxSizeMB = 4096;
+	if (GConfig && GConfig->GetString(ImageLoaderConfigSection, TEXT("FrameCacheDirectory"), FrameCacheDirectory, GGameIni) && !FrameCacheDirectory.IsEmpty())
+	{
+		GConfig->GetInt(ImageLoaderConfigSection, TEXT("FrameCacheMaxSizeMB"), FrameCacheMaxSizeMB, GGameIni);
+		UImageLoaderManager::EnableFrameCache(FrameCacheDirectory, FrameCacheMaxSizeMB);
+	}
+
+	float MemoryBudgetInterval = 1.0f;
+	if (GConfig)
+		GConfig->GetFloat(ImageLoaderConfigSection, TEXT("MemoryBudgetInterval"), MemoryBudgetInterval, GGameIni);
+	if (MemoryBudgetInterval > 0.0f)
+		MemoryBudgetTickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FImageLoaderPluginModule::TickMemoryBudget), MemoryBudgetInterval);
+
+	if (GEngine && GEngine->IsInitialized())
+		StartConfiguredWarmUp();
+	else
+		PostEngineInitHandle = FCoreDelegates::OnPostEngineInit.AddRaw(this, &FImageLoaderPluginModule::StartConfiguredWarmUp);
 }
 
 void FImageLoaderPluginModule::ShutdownModule()
 {
 	// This function may be called during shutdown to clean up your module.  For modules that support dynamic reloading,
 	// we call this function before unloading the module.
+	FCoreDelegates::OnPostEngineInit.Remove(PostEngineInitHandle);
+
+	if (MemoryBudgetTickerHandle.IsValid())
+		FTicker::GetCoreTicker().RemoveTicker(MemoryBudgetTickerHandle);
+	MemoryBudgetTickerHandle.Reset();
+
+	FFrameWriter::Shutdown();
+	FTextureBufferPlayerTicker::Shutdown();
+}
+
+bool FImageLoaderPluginModule::TickMemoryBudget(float DeltaTime)
+{
+	UImageLoaderManager::BalanceMemoryBudget();
+	return true;
+}
+
+void FImageLoaderPluginModule::StartConfiguredWarmUp()
+{
+	FCoreDelegates::OnPostEngineInit.Remove(PostEngineInitHandle);
+
+	if (IsRunningCommandlet() || !GConfig)
+		return;
+
+	// Loading in the editor would hold the sequences for the whole session, so it has to be asked for
+	bool WarmUpInEditor = false;
+	GConfig->GetBool(ImageLoaderConfigSection, TEXT("WarmUpInEditor"), WarmUpInEditor, GGameIni);
+	if (GIsEditor && !WarmUpInEditor)
+		return;
+
+	UImageLoaderManager::StartConfiguredWarmUp(ImageLoaderConfigSection);
 }
 
 #undef LOCTEXT_NAMESPACE
@@ -0,0 +1,321 @@
+#include "PixelFormatConversion.h"
+#include "Runtime/Core/Public/Async/ParallelFor.h"
+
+#if PLATFORM_CPU_X86_FAMILY
+#include <emmintrin.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define PIXEL_CONVERSION_AVX2 1
+#endif
+#endif
+
+#ifndef PIXEL_CONVERSION_AVX2
+#define PIXEL_CONVERSION_AVX2 0
+#endif
+
+
+// Below this many pixels the rows are converted on the calling thread
+static const int32 ParallelConversionMinPixels = 256 * 256;
+
+
+// Nearest 8-bit value of a 16-bit channel, i.e. round(Value / 257)
+static FORCEINLINE uint8 Narrow16(uint16 Value)
+{
+	const uint32 T = Value + 128;
+	return static_cast<uint8>((T - (T >> 8)) >> 8);
+}
+
+static FORCEINLINE uint8 Premultiply(uint8 Color, uint8 Alpha)
+{
+	const uint32 T = Color * Alpha + 128;
+	return static_cast<uint8>((T + (T >> 8)) >> 8);
+}
+
+
+#if PLATFORM_CPU_X86_FAMILY
+
+// Swaps the R and B bytes of every 32-bit pixel
+static FORCEINLINE __m128i SwapRB(__m128i P)
+{
+	const __m128i GAMask = _mm_set1_epi32(0xFF00FF00);
+	const __m128i RB = _mm_andnot_si128(GAMask, P);
+	return _mm_or_si128(_mm_and_si128(P, GAMask), _mm_or_si128(_mm_slli_epi32(RB, 16), _mm_srli_epi32(RB, 16)));
+}
+
+// Rounds 8 16-bit channels to 8-bit values, still held in 16-bit lanes. The saturating add keeps the top values exact.
+static FORCEINLINE __m128i Narrow16x8(__m128i V)
+{
+	const __m128i T = _mm_adds_epu16(V, _mm_set1_epi16(128));
+	return _mm_srli_epi16(_mm_sub_epi16(T, _mm_srli_epi16(T, 8)), 8);
+}
+
+// Expands 16 gray values to 4 opaque BGRA vectors
+static FORCEINLINE void GrayToBGRA(__m128i G, uint8* Dst)
+{
+	const __m128i Opaque = _mm_set1_epi8(static_cast<char>(0xFF));
+	const __m128i GGLo = _mm_unpacklo_epi8(G, G);
+	const __m128i GALo = _mm_unpacklo_epi8(G, Opaque);
+	const __m128i GGHi = _mm_unpackhi_epi8(G, G);
+	const __m128i GAHi = _mm_unpackhi_epi8(G, Opaque);
+
+	_mm_storeu_si128((__m128i*)(Dst), _mm_unpacklo_epi16(GGLo, GALo));
+	_mm_storeu_si128((__m128i*)(Dst + 16), _mm_unpackhi_epi16(GGLo, GALo));
+	_mm_storeu_si128((__m128i*)(Dst + 32), _mm_unpacklo_epi16(GGHi, GAHi));
+	_mm_storeu_si128((__m128i*)(Dst + 48), _mm_unpackhi_epi16(GGHi, GAHi));
+}
+
+#endif
+
+
+static void SwizzleRow(const uint8* Src, int32 Width, uint8* Dst)
+{
+	int32 X = 0;
+
+#if PIXEL_CONVERSION_AVX2
+	const __m256i Mask = _mm256_setr_epi8(
+		2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+		2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+	for (; X + 8 <= Width; X += 8)
+	{
+		_mm256_storeu_si256((__m256i*)(Dst + X * 4), _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(Src + X * 4)), Mask));
+	}
+#endif
+
+#if PLATFORM_CPU_X86_FAMILY
+	for (; X + 4 <= Width; X += 4)
+	{
+		_mm_storeu_si128((__m128i*)(Dst + X * 4), SwapRB(_mm_loadu_si128((const __m128i*)(Src + X * 4))));
+	}
+#endif
+
+	for (; X < Width; ++X)
+	{
+		Dst[X * 4 + 0] = Src[X * 4 + 2];
+		Dst[X * 4 + 1] = Src[X * 4 + 1];
+		Dst[X * 4 + 2] = Src[X * 4 + 0];
+		Dst[X * 4 + 3] = Src[X * 4 + 3];
+	}
+}
+
+static void RGBRow(const uint8* Src, int32 Width, uint8* Dst, bool SourceIsBGR)
+{
+	int32 X = 0;
+
+#if PIXEL_CONVERSION_AVX2
+	// 4 pixels per 16 byte load, the load must not run past the 3 * Width bytes of the row
+	const __m128i Mask = SourceIsBGR
+		? _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1)
+		: _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+	const __m128i Opaque = _mm_set1_epi32(0xFF000000);
+	for (; X * 3 + 16 <= Width * 3; X += 4)
+	{
+		const __m128i P = _mm_loadu_si128((const __m128i*)(Src + X * 3));
+		_mm_storeu_si128((__m128i*)(Dst + X * 4), _mm_or_si128(_mm_shuffle_epi8(P, Mask), Opaque));
+	}
+#endif
+
+#if PLATFORM_LITTLE_ENDIAN
+	// One 32-bit load per pixel, the last pixel is read bytewise to stay within the row
+	for (; X + 1 < Width; ++X)
+	{
+		uint32 V;
+		FMemory::Memcpy(&V, Src + X * 3, 4);
+		const uint32 Out = SourceIsBGR
+			? ((V & 0x00FFFFFF) | 0xFF000000)
+			: (((V & 0xFF) << 16) | (V & 0xFF00) | ((V >> 16) & 0xFF) | 0xFF000000);
+		FMemory::Memcpy(Dst + X * 4, &Out, 4);
+	}
+#endif
+
+	for (; X < Width; ++X)
+	{
+		const uint8* P = Src + X * 3;
+		Dst[X * 4 + 0] = SourceIsBGR ? P[0] : P[2];
+		Dst[X * 4 + 1] = P[1];
+		Dst[X * 4 + 2] = SourceIsBGR ? P[2] : P[0];
+		Dst[X * 4 + 3] = 0xFF;
+	}
+}
+
+static void Gray8Row(const uint8* Src, int32 Width, uint8* Dst)
+{
+	int32 X = 0;
+
+#if PLATFORM_CPU_X86_FAMILY
+	for (; X + 16 <= Width; X += 16)
+	{
+		GrayToBGRA(_mm_loadu_si128((const __m128i*)(Src + X)), Dst + X * 4);
+	}
+#endif
+
+	for (; X < Width; ++X)
+	{
+		Dst[X * 4 + 0] = Dst[X * 4 + 1] = Dst[X * 4 + 2] = Src[X];
+		Dst[X * 4 + 3] = 0xFF;
+	}
+}
+
+static void Gray16Row(const uint8* Src, int32 Width, uint8* Dst)
+{
+	const uint16* Src16 = reinterpret_cast<const uint16*>(Src);
+	int32 X = 0;
+
+#if PLATFORM_CPU_X86_FAMILY
+	for (; X + 16 <= Width; X += 16)
+	{
+		const __m128i Lo = Narrow16x8(_mm_loadu_si128((const __m128i*)(Src16 + X)));
+		const __m128i Hi = Narrow16x8(_mm_loadu_si128((const __m128i*)(Src16 + X + 8)));
+		GrayToBGRA(_mm_packus_epi16(Lo, Hi), Dst + X * 4);
+	}
+#endif
+
+	for (; X < Width; ++X)
+	{
+		Dst[X * 4 + 0] = Dst[X * 4 + 1] = Dst[X * 4 + 2] = Narrow16(Src16[X]);
+		Dst[X * 4 + 3] = 0xFF;
+	}
+}
+
+static void Color16Row(const uint8* Src, int32 Width, uint8* Dst, bool SourceIsBGRA)
+{
+	const uint16* Src16 = reinterpret_cast<const uint16*>(Src);
+	int32 X = 0;
+
+#if PLATFORM_CPU_X86_FAMILY
+	// 2 pixels per load, 4 pixels per store
+	for (; X + 4 <= Width; X += 4)
+	{
+		const __m128i Lo = Narrow16x8(_mm_loadu_si128((const __m128i*)(Src16 + X * 4)));
+		const __m128i Hi = Narrow16x8(_mm_loadu_si128((const __m128i*)(Src16 + X * 4 + 8)));
+		const __m128i P = _mm_packus_epi16(Lo, Hi);
+		_mm_storeu_si128((__m128i*)(Dst + X * 4), SourceIsBGRA ? P : SwapRB(P));
+	}
+#endif
+
+	for (; X < Width; ++X)
+	{
+		const uint16* P = Src16 + X * 4;
+		Dst[X * 4 + 0] = Narrow16(SourceIsBGRA ? P[0] : P[2]);
+		Dst[X * 4 + 1] = Narrow16(P[1]);
+		Dst[X * 4 + 2] = Narrow16(SourceIsBGRA ? P[2] : P[0]);
+		Dst[X * 4 + 3] = Narrow16(P[3]);
+	}
+}
+
+static void PremultiplyRow(uint8* Pixels, int32 Width)
+{
+	int32 X = 0;
+
+#if PLATFORM_CPU_X86_FAMILY
+	const __m128i Zero = _mm_setzero_si128();
+	const __m128i Half = _mm_set1_epi16(128);
+	const __m128i AlphaMask = _mm_set1_epi32(0xFF000000);
+
+	auto PremultiplyHalf = [&](__m128i C)
+	{
+		const __m128i A = _mm_shufflehi_epi16(_mm_shufflelo_epi16(C, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+		const __m128i T = _mm_add_epi16(_mm_mullo_epi16(C, A), Half);
+		return _mm_srli_epi16(_mm_add_epi16(T, _mm_srli_epi16(T, 8)), 8);
+	};
+
+	for (; X + 4 <= Width; X += 4)
+	{
+		const __m128i P = _mm_loadu_si128((const __m128i*)(Pixels + X * 4));
+		const __m128i Color = _mm_packus_epi16(PremultiplyHalf(_mm_unpacklo_epi8(P, Zero)), PremultiplyHalf(_mm_unpackhi_epi8(P, Zero)));
+		_mm_storeu_si128((__m128i*)(Pixels + X * 4), _mm_or_si128(_mm_andnot_si128(AlphaMask, Color), _mm_and_si128(AlphaMask, P)));
+	}
+#endif
+
+	for (; X < Width; ++X)
+	{
+		uint8* P = Pixels + X * 4;
+		P[0] = Premultiply(P[0], P[3]);
+		P[1] = Premultiply(P[1], P[3]);
+		P[2] = Premultiply(P[2], P[3]);
+	}
+}
+
+
+int32 FPixelFormatConversion::GetBytesPerPixel(ESourcePixelLayout Layout)
+{
+	switch (Layout)
+	{
+	case ESourcePixelLayout::BGRA8:
+	case ESourcePixelLayout::RGBA8:		return 4;
+	case ESourcePixelLayout::RGB8:
+	case ESourcePixelLayout::BGR8:		return 3;
+	case ESourcePixelLayout::Gray8:		return 1;
+	case ESourcePixelLayout::RGBA16:
+	case ESourcePixelLayout::BGRA16:	return 8;
+	case ESourcePixelLayout::Gray16:	return 2;
+	}
+	return 0;
+}
+
+void FPixelFormatConversion::ConvertToBGRA8(const uint8* Src, int32 SrcPitch, ESourcePixelLayout Layout, int32 Width, int32 Height, uint8* Dst, int32 DstPitch, bool PremultiplyAlpha)
+{
+	if (Width <= 0 || Height <= 0)
+		return;
+
+	if (SrcPitch <= 0)
+		SrcPitch = Width * GetBytesPerPixel(Layout);
+	if (DstPitch <= 0)
+		DstPitch = Width * 4;
+
+	// Sources without alpha are opaque, premultiplying would not change them
+	const bool HasAlpha = (Layout == ESourcePixelLayout::BGRA8 || Layout == ESourcePixelLayout::RGBA8 || Layout == ESourcePixelLayout::RGBA16 || Layout == ESourcePixelLayout::BGRA16);
+	PremultiplyAlpha = PremultiplyAlpha && HasAlpha;
+
+	auto ProcessRow = [=](int32 Y)
+	{
+		const uint8* SrcRow = Src + static_cast<int64>(Y) * SrcPitch;
+		uint8* DstRow = Dst + static_cast<int64>(Y) * DstPitch;
+
+		switch (Layout)
+		{
+		case ESourcePixelLayout::BGRA8:
+			if (SrcRow != DstRow)
+				FMemory::Memcpy(DstRow, SrcRow, Width * 4);
+			break;
+		case ESourcePixelLayout::RGBA8:		SwizzleRow(SrcRow, Width, DstRow); break;
+		case ESourcePixelLayout::RGB8:		RGBRow(SrcRow, Width, DstRow, false); break;
+		case ESourcePixelLayout::BGR8:		RGBRow(SrcRow, Width, DstRow, true); break;
+		case ESourcePixelLayout::Gray8:		Gray8Row(SrcRow, Width, DstRow); break;
+		case ESourcePixelLayout::RGBA16:	Color16Row(SrcRow, Width, DstRow, false); break;
+		case ESourcePixelLayout::BGRA16:	Color16Row(SrcRow, Width, DstRow, true); break;
+		case ESourcePixelLayout::Gray16:	Gray16Row(SrcRow, Width, DstRow); break;
+		}
+
+		// Premultiplied while the row is still in cache
+		if (PremultiplyAlpha)
+			PremultiplyRow(DstRow, Width);
+	};
+
+	if (Width * Height < ParallelConversionMinPixels)
+	{
+		for (int32 Y = 0; Y < Height; ++Y)
+			ProcessRow(Y);
+	}
+	else
+	{
+		ParallelFor(Height, ProcessRow);
+	}
+}
+
+void FPixelFormatConversion::PremultiplyAlphaBGRA8(uint8* Pixels, int32 NumPixels)
+{
+	if (NumPixels < ParallelConversionMinPixels)
+	{
+		PremultiplyRow(Pixels, NumPixels);
+		return;
+	}
+
+	// Split into chunks of whole pixels, the image may not be made of rows here
+	const int32 ChunkPixels = 64 * 1024;
+	const int32 NumChunks = FMath::DivideAndRoundUp(NumPixels, ChunkPixels);
+	ParallelFor(NumChunks, [=](int32 Chunk)
+	{
+		const int32 First = Chunk * ChunkPixels;
+		PremultiplyRow(Pixels + static_cast<int64>(First) * 4, FMath::Min(ChunkPixels, NumPixels - First));
+	});
+}
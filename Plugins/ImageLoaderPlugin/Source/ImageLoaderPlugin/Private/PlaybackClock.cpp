@@ -0,0 +1,63 @@
+#include "PlaybackClock.h"
+
+
+static int64 PositiveModulo(int64 Value, int64 Divisor)
+{
+	const int64 Result = Value % Divisor;
+	return (Result < 0) ? Result + Divisor : Result;
+}
+
+
+int64 FPlaybackClock::GetFrameCount(float FrameInterval) const
+{
+	if (FrameInterval <= 0.0f)
+		return 0;
+
+	return static_cast<int64>(FMath::FloorToDouble(Time / FrameInterval));
+}
+
+float FPlaybackClock::GetTimeInFrame(float FrameInterval) const
+{
+	if (FrameInterval <= 0.0f)
+		return 0.0f;
+
+	const double FrameStart = static_cast<double>(GetFrameCount(FrameInterval)) * FrameInterval;
+	return static_cast<float>(Time - FrameStart);
+}
+
+int32 FPlaybackClock::FrameAtTime(double InTime, float FrameInterval, int32 NumFrames, bool PingPong, bool& OutReverse)
+{
+	OutReverse = false;
+
+	if (NumFrames < 2 || FrameInterval <= 0.0f)
+		return 0;
+
+	const int64 Steps = static_cast<int64>(FMath::FloorToDouble(InTime / FrameInterval));
+
+	if (!PingPong)
+		return static_cast<int32>(PositiveModulo(Steps, NumFrames));
+
+	// A ping-pong cycle goes 0..N-1 and back down to 1 before starting over
+	const int64 Period = 2 * (NumFrames - 1);
+	const int64 Step = PositiveModulo(Steps, Period);
+
+	if (Step < NumFrames - 1)
+		return static_cast<int32>(Step);
+
+	OutReverse = true;
+	return static_cast<int32>(Period - Step);
+}
+
+double FPlaybackClock::TimeAtFrame(int32 Frame, float FrameInterval, int32 NumFrames, bool PingPong, bool Reverse)
+{
+	if (NumFrames < 2 || FrameInterval <= 0.0f)
+		return 0.0;
+
+	Frame = FMath::Clamp(Frame, 0, NumFrames - 1);
+
+	int64 Step = Frame;
+	if (PingPong && Reverse && Frame > 0)
+		Step = 2 * (NumFrames - 1) - Frame;
+
+	return static_cast<double>(Step) * FrameInterval;
+}
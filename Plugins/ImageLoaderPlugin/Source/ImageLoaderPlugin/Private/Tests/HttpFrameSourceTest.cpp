@@ -0,0 +1,157 @@
+#include "HttpFrameSource.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS && WITH_HTTPSERVER_TESTS
+
+#include "HttpServerModule.h"
+#include "IHttpRouter.h"
+#include "HttpPath.h"
+#include "HttpRouteHandle.h"
+#include "HttpServerRequest.h"
+#include "HttpServerResponse.h"
+#include "Misc/Paths.h"
+
+
+namespace HttpFrameSourceTest
+{
+	static const uint32 Port = 18421;
+	static const int32 NumFrames = 8;
+	static const int32 SeekFrame = 5;
+	static const double TimeoutSeconds = 10.0;
+	static const FName Sequence(TEXT("HttpFrameSourceTest"));
+
+	struct FState
+	{
+		/** Frames in the order the server has received their requests. Game thread only. */
+		TArray<int32> RequestedFrames;
+
+		FThreadSafeCounter FetchedCount;
+		FThreadSafeCounter FailedCount;
+		int32 Playhead = 0;
+
+		TSharedPtr<IHttpRouter> Router;
+		FHttpRouteHandle Route;
+
+		FString PreviousCacheDirectory;
+		int32 PreviousMaxParallelRequests = 0;
+	};
+
+	typedef TSharedRef<FState, ESPMode::ThreadSafe> FStateRef;
+
+	static FString GetFrameUrl(int32 Index)
+	{
+		return FString::Printf(TEXT("http://127.0.0.1:%u/frames/%d.png"), Port, Index);
+	}
+
+	static void Restore(const FStateRef& State)
+	{
+		FHttpFrameSource& Source = FHttpFrameSource::Get();
+		Source.RemoveSequence(Sequence);
+		Source.SetMaxParallelRequests(State->PreviousMaxParallelRequests);
+		Source.SetCacheDirectory(State->PreviousCacheDirectory);
+
+		if (State->Router.IsValid() && State->Route.IsValid())
+			State->Router->UnbindRoute(State->Route);
+	}
+
+	/** Waits for all frames, then checks the order the server has seen them in. */
+	class FWaitForFramesCommand : public IAutomationLatentCommand
+	{
+	public:
+
+		FWaitForFramesCommand(FAutomationTestBase* InTest, const FStateRef& InState)
+			: Test(InTest)
+			, State(InState)
+		{
+		}
+
+		virtual bool Update() override
+		{
+			if (State->FetchedCount.GetValue() + State->FailedCount.GetValue() < NumFrames && GetCurrentRunTime() < TimeoutSeconds)
+				return false;
+
+			Test->TestEqual(TEXT("Frames fetched"), State->FetchedCount.GetValue(), NumFrames);
+			Test->TestEqual(TEXT("Frames failed"), State->FailedCount.GetValue(), 0);
+
+			// Frame 0 has taken the only request slot before the seek, the others follow the new playhead and wrap around
+			const TArray<int32> Expected = { 0, 5, 6, 7, 1, 2, 3, 4 };
+			FString Order;
+			for (int32 Frame : State->RequestedFrames)
+				Order += FString::Printf(TEXT("%d "), Frame);
+			Test->TestTrue(FString::Printf(TEXT("Frames downloaded by distance from the playhead: %s"), *Order), State->RequestedFrames == Expected);
+
+			Restore(State);
+			return true;
+		}
+
+	private:
+
+		FAutomationTestBase* Test;
+		FStateRef State;
+	};
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FHttpFrameSourcePlayheadOrderTest, "ImageLoader.HttpFrameSource.PlayheadOrder",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FHttpFrameSourcePlayheadOrderTest::RunTest(const FString& Parameters)
+{
+	using namespace HttpFrameSourceTest;
+
+	FStateRef State = MakeShared<FState, ESPMode::ThreadSafe>();
+
+	// A local listener stands in for the frame server, and records the order of the requests
+	State->Router = FHttpServerModule::Get().GetHttpRouter(Port);
+	if (!State->Router.IsValid())
+	{
+		AddError(FString::Printf(TEXT("Could not listen on port %u"), Port));
+		return false;
+	}
+
+	State->Route = State->Router->BindRoute(FHttpPath(TEXT("/frames")), EHttpServerRequestVerbs::VERB_GET,
+		[State](const FHttpServerRequest& Request, const FHttpResultCallback& OnComplete)
+		{
+			State->RequestedFrames.Add(FCString::Atoi(*FPaths::GetBaseFilename(Request.RelativePath.GetPath())));
+			OnComplete(FHttpServerResponse::Create(TEXT("frame"), TEXT("image/png")));
+			return true;
+		});
+	if (!State->Route.IsValid())
+	{
+		AddError(TEXT("Could not bind the frame route"));
+		return false;
+	}
+	FHttpServerModule::Get().StartAllListeners();
+
+	// One request at a time, from the network only, so the order of the requests is that of the pending list
+	FHttpFrameSource& Source = FHttpFrameSource::Get();
+	State->PreviousCacheDirectory = Source.GetCacheDirectory();
+	State->PreviousMaxParallelRequests = Source.GetMaxParallelRequests();
+	Source.SetCacheDirectory(FString());
+	Source.SetMaxParallelRequests(1);
+
+	TArray<FString> FrameUrls;
+	for (int32 Index = 0; Index < NumFrames; ++Index)
+		FrameUrls.Add(GetFrameUrl(Index));
+
+	Source.SetSequenceFrames(Sequence, FrameUrls, [State]() { return State->Playhead; });
+
+	for (const FString& Url : FrameUrls)
+	{
+		Source.FetchFrame(Url, [State](FHttpFrameSource::FBytes Data)
+		{
+			if (Data.IsValid())
+				State->FetchedCount.Increment();
+			else
+				State->FailedCount.Increment();
+		});
+	}
+
+	// Seeks while the frames wait for the request slot
+	State->Playhead = SeekFrame;
+
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitForFramesCommand(this, State));
+	return true;
+}
+
+#endif
@@ -3,6 +3,7 @@
 #include "ImageLoader.h"
 #include "Runtime/Core/Public/Async/ParallelFor.h"
 #include "Runtime/Engine/Classes/Engine/Texture2D.h"
+#include "RenderUtils.h"
 
 
 
@@ -29,35 +30,80 @@ bool UTextureBuffer::IsFinished() const
 
 float UTextureBuffer::GetTimeSinceLastUpdate()
 {
-	return static_cast<float>(FPlatformTime::Seconds() - LastUpdateTime);
+	// Measured on the playback clock, so it stays consistent with the frame selection in Update
+	return Clock.GetTimeInFrame(FrameIntervalInSec);
 }
 
-void UTextureBuffer::Update(float DeltaTime)
+bool UTextureBuffer::Update(float DeltaTime)
 {
-	TimeAccum += DeltaTime;
+	if (TexBuffer.Num() < 1)
+		return false;
+
+	PlayedWhileLoading |= (Status != ETextureBufferStatus::E_Loaded);
+
+	const int64 PrevFrameCount = Clock.GetFrameCount(FrameIntervalInSec);
+
+	Clock.Rate = PlaybackRate;
+	Clock.Advance(DeltaTime);
+
 	//
-	// Check if it's time interval minimum for update
+	// Jump straight to the frame for the elapsed time. Frames in between are never bound.
 	//
-    {
-        //double TimeDiff = FPlatformTime::Seconds() - LastUpdateTime;
-		double TimeDiff = TimeAccum - LastUpdateTime;
-        if (TimeDiff < FrameIntervalInSec)
-        {
-            return;
-        }
-        //LastUpdateTime = FPlatformTime::Seconds();
-		LastUpdateTime = TimeAccum;
-    }
-
-	MoveNext();
-	
-	//UE_LOG(LogTemp, Warning, TEXT("UTextureBuffer::Update: %d %s %s %s"), UpdateIndex, *GetNextTexture()->GetName(), *GetTexture()->GetName(), *GetPrevTexture()->GetName());
-	
+	const int64 Steps = FMath::Abs(Clock.GetFrameCount(FrameIntervalInSec) - PrevFrameCount);
+	if (Steps > 1)
+		SkippedFrames += static_cast<int32>(Steps - 1);
+
+	return SyncIndexToClock();
+}
+
+void UTextureBuffer::SeekToTime(float Seconds)
+{
+	Clock.Seek(Seconds);
+	SyncIndexToClock();
+}
+
+bool UTextureBuffer::SyncToTime(double Time)
+{
+	if (TexBuffer.Num() < 1)
+		return false;
+
+	PlayedWhileLoading |= (Status != ETextureBufferStatus::E_Loaded);
+
+	Clock.Seek(Time);
+	return SyncIndexToClock();
+}
+
+float UTextureBuffer::GetPlaybackTime() const
+{
+	return static_cast<float>(Clock.Time);
+}
+
+int32 UTextureBuffer::GetSkippedFrameCount() const
+{
+	return SkippedFrames;
+}
+
+bool UTextureBuffer::SyncIndexToClock()
+{
+	bool NewReverse = false;
+	const int32 NewIndex = FPlaybackClock::FrameAtTime(Clock.Time, FrameIntervalInSec, TexBuffer.Num(), PingPong, NewReverse);
+
+	const bool Changed = (NewIndex != UpdateIndex);
+	UpdateIndex = NewIndex;
+	Reverse = NewReverse;
+	return Changed;
+}
+
+void UTextureBuffer::SyncClockToIndex()
+{
+	Clock.Seek(FPlaybackClock::TimeAtFrame(UpdateIndex, FrameIntervalInSec, TexBuffer.Num(), PingPong, Reverse));
 }
 
 void UTextureBuffer::GoToBegin()
 {
-	UpdateIndex = (!Reverse) ? 0 : TexBuffer.Num() - 1;
+	UpdateIndex = 0;
+	Reverse = false;
+	SyncClockToIndex();
 }
 
 int32 UTextureBuffer::GetIndex() const
@@ -67,6 +113,7 @@ int32 UTextureBuffer::GetIndex() const
 void UTextureBuffer::SetIndex(int32 Idx)
 {
 	UpdateIndex = FMath::Clamp(Idx, 0, TexBuffer.Num() - 1);
+	SyncClockToIndex();
 }
 
 
@@ -100,6 +147,8 @@ int32 UTextureBuffer::MoveNext()
 		}
 	}
 
+	SyncClockToIndex();
+
 	return UpdateIndex;
 }
 
@@ -111,6 +160,11 @@ UTexture2D* UTextureBuffer::GetTexture()
     return GetFallbackTexture();
 }
 
+bool UTextureBuffer::IsFrameResident(int32 Index) const
+{
+	return TexBuffer.IsValidIndex(Index) && TexBuffer[Index] != nullptr;
+}
+
 UTexture2D* UTextureBuffer::GetPrevTexture()
 {
 	if (TexBuffer.Num() < 1)
@@ -172,6 +226,7 @@ bool UTextureBuffer::LoadImageSequence()
 	}
 
 	LoadingCount = 0;
+	PlayedWhileLoading = false;
 	
 	//TexBuffer.Empty();
 
@@ -187,6 +242,12 @@ bool UTextureBuffer::LoadImageSequence()
 
 void UTextureBuffer::OnImageLoadCompleted(UTexture2D* Texture, int32 Id)
 {
+	if (ReloadingTier && Status == ETextureBufferStatus::E_Loaded)
+	{
+		OnTierReloadCompleted(Texture, Id);
+		return;
+	}
+
 	++LoadingCount;
 	//UE_LOG(LogTemp, Warning, TEXT("%d UTextureBuffer::OnImageLoadCompleted %s"), Id, *FileList[Id]);
 
@@ -210,6 +271,7 @@ void UTextureBuffer::OnImageLoadCompleted(UTexture2D* Texture, int32 Id)
 	if (Texture)
 	{
 		TexBuffer[Id] = Texture;
+		UpdateSourceWidth(Texture);
 	}
 	else
 	{
@@ -222,7 +284,10 @@ void UTextureBuffer::OnImageLoadCompleted(UTexture2D* Texture, int32 Id)
 
 	if (LoadingCount == TexBuffer.Num())
 	{
-		UpdateIndex = 0;
+		// A sequence played while loading, e.g. by a frame-locked capture, carries on from where it is
+		if (!PlayedWhileLoading)
+			UpdateIndex = 0;
+		ResolutionTier = LoadingTier;
 		
         UE_LOG(LogTemp, Warning, TEXT(">> %d %d UTextureBuffer::LoadImageSequence: <Completed> : %s"), FileList.Num(), LoadingCount, *SequenceName.ToString());
 		UImageLoaderManager::GetImageLoaderManager()->OnImageSequenceLoadComplete(FileList.Num(), SequenceName);
@@ -230,7 +295,17 @@ void UTextureBuffer::OnImageLoadCompleted(UTexture2D* Texture, int32 Id)
 		Status = ETextureBufferStatus::E_Loaded;
 		ImageSequenceLoadCompleted.Broadcast(TexBuffer.Num(), FName(*this->GetName()));
 
-		TimeAccum = 0.0f;
+		if (!PlayedWhileLoading)
+		{
+			Reverse = false;
+			Clock.Seek(0.0);
+			SkippedFrames = 0;
+		}
+		PlayedWhileLoading = false;
+
+		// A tier change requested while loading starts now
+		if (RequestedTier != ResolutionTier)
+			RequestResolutionTier(RequestedTier);
 	}
 }
 
@@ -243,4 +318,126 @@ void UTextureBuffer::ReleaseBuffer()
     FallbackTexture = GetTexture();
 	TexBuffer.Empty();
 	Status = ETextureBufferStatus::E_Unloaded;
+	ReloadingTier = false;
+
+	// Drop whatever is still queued for this buffer
+	BeginLoadGeneration();
+}
+
+
+float UTextureBuffer::GetLoadProgress() const
+{
+	if (Status == ETextureBufferStatus::E_Loaded)
+		return 1.0f;
+
+	if (FileList.Num() < 1 || Status == ETextureBufferStatus::E_Unloaded)
+		return 0.0f;
+
+	return FMath::Clamp(static_cast<float>(LoadingCount) / FileList.Num(), 0.0f, 1.0f);
+}
+
+
+int32 UTextureBuffer::BeginLoadGeneration()
+{
+	DispatchedFrames.Init(false, FileList.Num());
+	return ++LoadGeneration;
+}
+
+
+int32 UTextureBuffer::RequeueLoadGeneration()
+{
+	return ++LoadGeneration;
+}
+
+
+bool UTextureBuffer::TryDispatchFrame(int32 Index, int32 Generation)
+{
+	if (Generation != LoadGeneration || !DispatchedFrames.IsValidIndex(Index) || DispatchedFrames[Index])
+		return false;
+
+	DispatchedFrames[Index] = true;
+	return true;
+}
+
+
+bool UTextureBuffer::RequestResolutionTier(ETextureResolutionTier Tier)
+{
+	if (Tier > LowestResolutionTier)
+		Tier = LowestResolutionTier;
+
+	if (Tier < HighestResolutionTier)
+		Tier = HighestResolutionTier;
+
+	RequestedTier = Tier;
+
+	if (Status == ETextureBufferStatus::E_Unloaded)
+	{
+		// Takes effect on the next load
+		LoadingTier = Tier;
+		return true;
+	}
+
+	// A reload or the initial load in progress picks the request up when it finishes
+	if (Status != ETextureBufferStatus::E_Loaded || ReloadingTier)
+		return true;
+
+	if (Tier == ResolutionTier)
+		return false;
+
+	LoadingTier = Tier;
+	TierReloadCount = 0;
+	ReloadingTier = true;
+
+	UE_LOG(LogTemp, Warning, TEXT("UTextureBuffer::RequestResolutionTier: %s %d -> %d"), *SequenceName.ToString(), static_cast<int32>(ResolutionTier), static_cast<int32>(LoadingTier));
+	return UImageLoaderManager::GetImageLoaderManager()->ReloadTextureBufferImages(this);
+}
+
+void UTextureBuffer::OnTierReloadCompleted(UTexture2D* Texture, int32 Id)
+{
+	// On failure the frame keeps its previous resolution
+	if (Texture && TexBuffer.IsValidIndex(Id))
+	{
+		TexBuffer[Id] = Texture;
+		UpdateSourceWidth(Texture);
+	}
+
+	if (++TierReloadCount < TexBuffer.Num())
+		return;
+
+	ReloadingTier = false;
+	ResolutionTier = LoadingTier;
+
+	if (RequestedTier != ResolutionTier)
+		RequestResolutionTier(RequestedTier);
+}
+
+void UTextureBuffer::UpdateSourceWidth(UTexture2D* Texture)
+{
+	int32 SourceSizeX = 0;
+	int32 SourceSizeY = 0;
+	if (UImageLoader::GetSourceSize(Texture, SourceSizeX, SourceSizeY))
+		SourceWidth = FMath::Max(SourceWidth, SourceSizeX);
+}
+
+ETextureResolutionTier UTextureBuffer::GetLoadingTier() const
+{
+	return LoadingTier;
+}
+
+bool UTextureBuffer::IsChangingResolutionTier() const
+{
+	return ReloadingTier;
+}
+
+int32 UTextureBuffer::GetResidentSizeKb() const
+{
+	SIZE_T Bytes = 0;
+	for (const UTexture2D* Texture : TexBuffer)
+	{
+		if (Texture && Texture->PlatformData)
+		{
+			Bytes += CalcTextureSize(Texture->PlatformData->SizeX, Texture->PlatformData->SizeY, Texture->PlatformData->PixelFormat, 1);
+		}
+	}
+	return static_cast<int32>(Bytes >> 10);
 }
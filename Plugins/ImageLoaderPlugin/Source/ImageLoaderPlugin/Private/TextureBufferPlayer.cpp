@@ -7,14 +7,21 @@
 #include "Engine/Texture2D.h"
 #include "Components/MeshComponent.h"
 #include "GameFramework/Actor.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Kismet/GameplayStatics.h"
 #include "UObject/ConstructorHelpers.h"
 #include "TextureBuffer.h"
+#include "TileDeltaBuffer.h"
 #include "ImageLoaderManager.h"
+#include "TextureBufferPlayerTicker.h"
 
 
 UTextureBufferPlayer::UTextureBufferPlayer()
 {
+	// Advanced by FTextureBufferPlayerTicker while playing. The tick stays available to Blueprint subclasses,
+	// BeginPlay enables it for those that implement Event Tick.
 	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
 }
 
 
@@ -22,7 +29,10 @@ void UTextureBufferPlayer::BeginPlay()
 {
 	Super::BeginPlay();
 
-	IsPlaying = false;
+	if (GetClass()->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(UTextureBufferPlayer, ReceiveTick)))
+		SetComponentTickEnabled(true);
+
+	SetIsPlaying(false);
 
 	if (!SetupMaterial())
 		return;
@@ -33,33 +43,96 @@ void UTextureBufferPlayer::BeginPlay()
 
 void UTextureBufferPlayer::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
+	SetIsPlaying(false);
+	if (FTextureBufferPlayerTicker::IsAvailable())
+		FTextureBufferPlayerTicker::Get().RemoveWatchedPlayer(this);
+
 	if (!UnloadOnEndPlay)
 		Unload();
+
+	Super::EndPlay(EndPlayReason);
 }
 
 
-void UTextureBufferPlayer::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+void UTextureBufferPlayer::SetIsPlaying(bool Playing)
 {
-	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+	IsPlaying = Playing;
 
-	if (!TextureBuffer)
+	// Components may outlive the module during shutdown
+	if (!FTextureBufferPlayerTicker::IsAvailable())
 		return;
 
-	if (UpdateTextures())
-		UpdateMaterial();
-
 	if (IsPlaying)
-		TextureBuffer->Update(DeltaTime);
+		FTextureBufferPlayerTicker::Get().AddPlayer(this);
+	else
+		FTextureBufferPlayerTicker::Get().RemovePlayer(this);
+}
+
+
+void UTextureBufferPlayer::UpdateVisibility()
+{
+	if (!TargetMesh)
+	{
+		OnScreen = true;
+		ScreenSize = 1.0f;
+		return;
+	}
+
+	OnScreen = !PauseWhenNotRendered || TargetMesh->WasRecentlyRendered(VisibilityGracePeriod);
+
+	APlayerCameraManager* CameraManager = UGameplayStatics::GetPlayerCameraManager(this, 0);
+	if (!CameraManager)
+	{
+		ScreenSize = 1.0f;
+		return;
+	}
+
+	// Projected diameter of the bounding sphere relative to the width of the view frustum at its distance
+	const FBoxSphereBounds& Bounds = TargetMesh->Bounds;
+	const float Distance = FVector::Dist(Bounds.Origin, CameraManager->GetCameraLocation());
+	const float HalfFOV = FMath::DegreesToRadians(FMath::Clamp(CameraManager->GetFOVAngle(), 1.0f, 170.0f) * 0.5f);
+
+	if (Distance <= Bounds.SphereRadius)
+		ScreenSize = 1.0f;
+	else
+		ScreenSize = FMath::Clamp(Bounds.SphereRadius / (Distance * FMath::Tan(HalfFOV)), 0.0f, 1.0f);
 }
 
 
 bool UTextureBufferPlayer::LoadImageSequenceFromDisk()
 {
-	TextureBuffer = UImageLoaderManager::GetImageLoaderManager()->LoadImageSequence(this, FileListPath, PingPong, FrameIntervalInSeconds, MaxImages, TemporalResolution);
+	if (UseTileDeltas)
+	{
+		TileDeltaBuffer = UImageLoaderManager::GetImageLoaderManager()->LoadTileDeltaSequence(this, FileListPath, FrameIntervalInSeconds, MaxImages, TemporalResolution, TileSize);
+		if (TileDeltaBuffer)
+		{
+			FTextureBufferPlayerTicker::Get().AddWatchedPlayer(this);
+			TileDeltaBuffer->OnImageSequenceLoadCompleted().AddDynamic(this, &UTextureBufferPlayer::OnImageSequenceLoadCompleted);
+			return true;
+		}
+		return false;
+	}
+
+	TextureBuffer = UImageLoaderManager::GetImageLoaderManager()->LoadImageSequence(this, FileListPath, PingPong, FrameIntervalInSeconds, MaxImages, TemporalResolution, LoadPriority, LowestResolutionTier);
 	if (TextureBuffer)
 	{
+		FTextureBufferPlayerTicker::Get().AddWatchedPlayer(this);
 		TextureBuffer->OnImageSequenceLoadInProgress().AddDynamic(this, &UTextureBufferPlayer::OnImageSequenceLoadInProgress);
 		TextureBuffer->OnImageSequenceLoadCompleted().AddDynamic(this, &UTextureBufferPlayer::OnImageSequenceLoadCompleted);
+
+		// A warmed up sequence may already be partly or fully resident
+		if (TextureBuffer->IsFinished())
+		{
+			OnImageSequenceLoadCompleted(TextureBuffer->FileList.Num(), TextureBuffer->SequenceName);
+		}
+		else if (TextureBuffer->IsLoading())
+		{
+			if (FTextureBufferPlayerTicker::Get().IsFrameLocked() && TextureBuffer->IsFrameResident(0))
+				SetIsPlaying(true);
+
+			if (UpdateTextures())
+				UpdateMaterial();
+		}
 		return true;
 	}
 	return false;
@@ -68,6 +141,10 @@ bool UTextureBufferPlayer::LoadImageSequenceFromDisk()
 void UTextureBufferPlayer::OnImageSequenceLoadInProgress(int32 Count, FName SequenceName)
 {
 	//UE_LOG(LogTemp, Warning, TEXT("UTextureBufferPlayer::OnImageSequenceLoadInProgress: %d %s"), Count, *SequenceName.ToString());
+
+	// A frame-locked capture plays from the first frame on, and waits for each next frame to load
+	if (FTextureBufferPlayerTicker::Get().IsFrameLocked())
+		SetIsPlaying(true);
 	
 	if (UpdateTextures())
 		UpdateMaterial();
@@ -77,7 +154,7 @@ void UTextureBufferPlayer::OnImageSequenceLoadInProgress(int32 Count, FName Sequ
 void UTextureBufferPlayer::OnImageSequenceLoadCompleted(int32 Count, FName SequenceName)
 {
 	//UE_LOG(LogTemp, Warning, TEXT("UTextureBufferPlayer::OnImageSequenceLoadCompleted: %d %s"), Count, *SequenceName.ToString());
-	IsPlaying = true;
+	SetIsPlaying(true);
 }
 
 
@@ -91,13 +168,13 @@ bool UTextureBufferPlayer::SetupMaterial()
 	}
 
 	MainMaterial = UKismetMaterialLibrary::CreateDynamicMaterialInstance(this, TemplateMaterial);
+	MaterialMainTexture = nullptr;
+	MaterialPrevTexture = nullptr;
+	MaterialLerpAlpha = -1.0f;
 
-	if (TryToApplyMaterialToMesh)
-	{
-		UMeshComponent* MeshComp = GetOwner()->FindComponentByClass<UMeshComponent>();
-		if (MeshComp)
-			MeshComp->SetMaterial(0, MainMaterial);
-	}
+	TargetMesh = GetOwner()->FindComponentByClass<UMeshComponent>();
+	if (TryToApplyMaterialToMesh && TargetMesh)
+		TargetMesh->SetMaterial(0, MainMaterial);
 
 	return true;
 }
@@ -105,24 +182,47 @@ bool UTextureBufferPlayer::SetupMaterial()
 
 bool UTextureBufferPlayer::UpdateMaterial()
 {
-	if (!MainMaterial || !TextureBuffer)
+	if (!MainMaterial || (!TextureBuffer && !TileDeltaBuffer))
 		return false;
 
-	float lerpAlpha = FMath::Clamp(TextureBuffer->GetTimeSinceLastUpdate() / this->FrameIntervalInSeconds, 0.0f, 1.0f);
+	// Tile deltas are applied in place, so there is no previous frame to blend with
+	float lerpAlpha = 1.0f;
+	if (TextureBuffer)
+		lerpAlpha = FMath::Clamp(TextureBuffer->GetTimeSinceLastUpdate() / TextureBuffer->FrameIntervalInSec, 0.0f, 1.0f);
 
-	MainMaterial->SetTextureParameterValue(MainTextureName, MainTexture);
-	MainMaterial->SetTextureParameterValue(PrevTextureName, PrevTexture);
-	MainMaterial->SetScalarParameterValue(LerpAlphaName, lerpAlpha);
+	// Setting a parameter searches the parameter list and may touch the render proxy, even for an unchanged value
+	if (MainTexture != MaterialMainTexture)
+	{
+		MainMaterial->SetTextureParameterValue(MainTextureName, MainTexture);
+		MaterialMainTexture = MainTexture;
+	}
+	if (PrevTexture != MaterialPrevTexture)
+	{
+		MainMaterial->SetTextureParameterValue(PrevTextureName, PrevTexture);
+		MaterialPrevTexture = PrevTexture;
+	}
+	if (lerpAlpha != MaterialLerpAlpha)
+	{
+		MainMaterial->SetScalarParameterValue(LerpAlphaName, lerpAlpha);
+		MaterialLerpAlpha = lerpAlpha;
+	}
 	return true;
 }
 
 
 bool UTextureBufferPlayer::UpdateTextures()
 {
+	if (TileDeltaBuffer)
+	{
+		MainTexture = TileDeltaBuffer->GetTexture();
+		PrevTexture = MainTexture;
+		return (MainTexture != nullptr);
+	}
+
 	if (!TextureBuffer)
 		return false;
 
-	if (TextureBuffer->IsFinished())
+	if (TextureBuffer->IsFinished() || TextureBuffer->IsFrameResident(TextureBuffer->GetIndex()))
 	{
 		MainTexture = TextureBuffer->GetTexture();
 		PrevTexture = TextureBuffer->GetPrevTexture();
@@ -138,28 +238,65 @@ bool UTextureBufferPlayer::UpdateTextures()
 
 void UTextureBufferPlayer::Play()
 {
+	if (PlaybackGroup != NAME_None)
+	{
+		FTextureBufferPlayerTicker::Get().SeekGroup(PlaybackGroup, 0.0f);
+		return;
+	}
+
 	if (TextureBuffer)
 		TextureBuffer->GoToBegin();
+
+	if (TileDeltaBuffer)
+		TileDeltaBuffer->SeekToTime(0.0f);
+
+	// A paused player is not refreshed by the ticker
+	if (UpdateTextures())
+		UpdateMaterial();
 }
 
 void UTextureBufferPlayer::Pause()
 {
-	IsPlaying = false;
+	SetIsPlaying(false);
 }
 
 void UTextureBufferPlayer::Resume()
 {
-	IsPlaying = true;
+	SetIsPlaying(true);
 }
 
 void UTextureBufferPlayer::PauseResume()
 {
-	IsPlaying = !IsPlaying;
+	SetIsPlaying(!IsPlaying);
+}
+
+void UTextureBufferPlayer::SeekToTime(float Seconds)
+{
+	if (PlaybackGroup != NAME_None)
+	{
+		FTextureBufferPlayerTicker::Get().SeekGroup(PlaybackGroup, Seconds);
+		return;
+	}
+
+	if (TextureBuffer)
+		TextureBuffer->SeekToTime(Seconds);
+
+	if (TileDeltaBuffer)
+		TileDeltaBuffer->SeekToTime(Seconds);
+
+	if (UpdateTextures())
+		UpdateMaterial();
 }
 
 
 void UTextureBufferPlayer::Unload()
 {
 	if (UImageLoaderManager::GetImageLoaderManager()->UnloadImageSequence(FileListPath))
+	{
+		SetIsPlaying(false);
+		if (FTextureBufferPlayerTicker::IsAvailable())
+			FTextureBufferPlayerTicker::Get().RemoveWatchedPlayer(this);
 		TextureBuffer = nullptr;
+		TileDeltaBuffer = nullptr;
+	}
 }
\ No newline at end of file
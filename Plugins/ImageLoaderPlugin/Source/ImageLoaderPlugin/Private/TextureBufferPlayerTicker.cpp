@@ -0,0 +1,367 @@
+#include "TextureBufferPlayerTicker.h"
+#include "TextureBufferPlayer.h"
+#include "TextureBuffer.h"
+#include "TileDeltaBuffer.h"
+#include "ImageLoaderManager.h"
+#include "Engine/Engine.h"
+#include "Engine/GameViewportClient.h"
+#include "Engine/Texture2D.h"
+#include "HttpFrameSource.h"
+#include "HttpModule.h"
+#include "HttpManager.h"
+
+
+// Visibility is sampled at this interval rather than every frame
+static const float VisibilityUpdateInterval = 0.2f;
+
+// A screen size driven tier change needs the size to move this far past the tier boundary
+static const float ScreenTierHysteresis = 0.2f;
+
+// and at least this many seconds since the previous change, since every change reloads the whole sequence
+static const double ScreenTierMinHoldTime = 2.0;
+
+// A frame-locked tick waits on a load this long at a time, so downloads, which complete in the http tick, carry on
+static const float FrameWaitSlice = 0.005f;
+
+
+/**
+Picks the coarsest tier whose frames still cover the screen area, starting from the current tier.
+@param Coverage Width on screen in pixels relative to the full resolution frame width.
+*/
+static ETextureResolutionTier SelectScreenTier(ETextureResolutionTier Current, float Coverage)
+{
+	int32 Tier = static_cast<int32>(Current);
+	const int32 CoarsestTier = static_cast<int32>(ETextureResolutionTier::E_Quarter);
+
+	// Finer while the frames are smaller than their area on screen
+	while (Tier > 0 && Coverage > (1.0f / (1 << Tier)) * (1.0f + ScreenTierHysteresis))
+		--Tier;
+
+	// Coarser while the next tier still covers the area on screen
+	while (Tier < CoarsestTier && Coverage < (1.0f / (2 << Tier)) * (1.0f - ScreenTierHysteresis))
+		++Tier;
+
+	return static_cast<ETextureResolutionTier>(Tier);
+}
+
+// Owned by the module, so it is gone before the engine shuts down rather than destroyed with the statics
+static TUniquePtr<FTextureBufferPlayerTicker> TickerInstance;
+
+FTextureBufferPlayerTicker& FTextureBufferPlayerTicker::Get()
+{
+	check(TickerInstance.IsValid());
+	return *TickerInstance;
+}
+
+bool FTextureBufferPlayerTicker::IsAvailable()
+{
+	return TickerInstance.IsValid();
+}
+
+void FTextureBufferPlayerTicker::Startup()
+{
+	if (!TickerInstance.IsValid())
+		TickerInstance = MakeUnique<FTextureBufferPlayerTicker>();
+}
+
+void FTextureBufferPlayerTicker::Shutdown()
+{
+	TickerInstance.Reset();
+}
+
+void FTextureBufferPlayerTicker::AddPlayer(UTextureBufferPlayer* Player)
+{
+	if (Player)
+		Players.AddUnique(Player);
+}
+
+void FTextureBufferPlayerTicker::RemovePlayer(UTextureBufferPlayer* Player)
+{
+	Players.RemoveSingleSwap(Player);
+}
+
+void FTextureBufferPlayerTicker::AddWatchedPlayer(UTextureBufferPlayer* Player)
+{
+	if (Player)
+		WatchedPlayers.AddUnique(Player);
+}
+
+void FTextureBufferPlayerTicker::RemoveWatchedPlayer(UTextureBufferPlayer* Player)
+{
+	WatchedPlayers.RemoveSingleSwap(Player);
+}
+
+bool FTextureBufferPlayerTicker::IsTickable() const
+{
+	return Players.Num() > 0 || WatchedPlayers.Num() > 0;
+}
+
+void FTextureBufferPlayerTicker::UpdateVisibility()
+{
+	WatchedPlayers.RemoveAllSwap([](const TWeakObjectPtr<UTextureBufferPlayer>& Player) { return !Player.IsValid(); });
+
+	FVector2D ViewportSize(0.0f, 0.0f);
+	if (GEngine && GEngine->GameViewport)
+		GEngine->GameViewport->GetViewportSize(ViewportSize);
+
+	// A shared sequence is on screen as long as any of its players is, and needs the size of its largest one
+	struct FBufferVisibility
+	{
+		bool OnScreen = false;
+		float ScreenWidth = 0.0f;
+	};
+	TMap<UTextureBuffer*, FBufferVisibility> BufferVisibility;
+
+	for (const TWeakObjectPtr<UTextureBufferPlayer>& Player : WatchedPlayers)
+	{
+		Player->UpdateVisibility();
+
+		if (!Player->TextureBuffer)
+			continue;
+
+		FBufferVisibility& Visibility = BufferVisibility.FindOrAdd(Player->TextureBuffer);
+		Visibility.OnScreen |= Player->OnScreen;
+
+		if (Player->OnScreen)
+		{
+			const float ScreenWidth = Player->UseScreenSizeLOD ? Player->ScreenSize * ViewportSize.X : MAX_flt;
+			Visibility.ScreenWidth = FMath::Max(Visibility.ScreenWidth, ScreenWidth);
+		}
+	}
+
+	const double Now = FPlatformTime::Seconds();
+
+	for (const TPair<UTextureBuffer*, FBufferVisibility>& Pair : BufferVisibility)
+	{
+		UTextureBuffer* Buffer = Pair.Key;
+		UImageLoaderManager::SetTextureBufferOnScreen(Buffer, Pair.Value.OnScreen);
+
+		// A frame-locked capture keeps its tiers, and sequences nobody sees keep theirs, there is no point in reloading them
+		if (FrameLocked || !Pair.Value.OnScreen || ViewportSize.X <= 0.0f || !Buffer->IsFinished() || Buffer->IsChangingResolutionTier())
+			continue;
+
+		if (Now - Buffer->ScreenTierChangeTime < ScreenTierMinHoldTime)
+			continue;
+
+		// The frames may not be at the size of their tier, e.g. when an image could not be reduced
+		if (Buffer->SourceWidth <= 0)
+			continue;
+
+		const float FullWidth = static_cast<float>(Buffer->SourceWidth);
+		UImageLoaderManager::SetTextureBufferScreenTier(Buffer, SelectScreenTier(Buffer->HighestResolutionTier, Pair.Value.ScreenWidth / FullWidth));
+	}
+}
+
+void FTextureBufferPlayerTicker::SetGroupPlaybackRate(FName Group, float Rate)
+{
+	if (Group != NAME_None)
+		Groups.FindOrAdd(Group).Clock.Rate = Rate;
+}
+
+void FTextureBufferPlayerTicker::SeekGroup(FName Group, float Seconds)
+{
+	if (Group != NAME_None)
+		Groups.FindOrAdd(Group).Clock.Seek(Seconds);
+}
+
+float FTextureBufferPlayerTicker::GetGroupTime(FName Group) const
+{
+	const FPlaybackGroup* PlaybackGroup = Groups.Find(Group);
+	return PlaybackGroup ? static_cast<float>(PlaybackGroup->Clock.Time) : 0.0f;
+}
+
+void FTextureBufferPlayerTicker::SetFrameLocked(bool Locked, float MaxStallSeconds)
+{
+	FrameLocked = Locked;
+	MaxStallTime = FMath::Max(0.0f, MaxStallSeconds);
+	LastStallTime = 0.0f;
+	TotalStallTime = 0.0f;
+	StalledTicks = 0;
+	LockedTicks = 0;
+
+	// Sequences already loading start playing now, like those that start loading later
+	if (Locked)
+	{
+		for (const TWeakObjectPtr<UTextureBufferPlayer>& Player : WatchedPlayers)
+		{
+			if (Player.IsValid() && Player->TextureBuffer && Player->TextureBuffer->IsFrameResident(0))
+				Player->SetIsPlaying(true);
+		}
+	}
+	else
+	{
+		// Catches up with the memory budget, which has been left alone while locked
+		UImageLoaderManager::BalanceMemoryBudget();
+	}
+}
+
+void FTextureBufferPlayerTicker::GetStallStats(float& OutTotalStallTime, int32& OutStalledTicks, int32& OutLockedTicks) const
+{
+	OutTotalStallTime = TotalStallTime;
+	OutStalledTicks = StalledTicks;
+	OutLockedTicks = LockedTicks;
+}
+
+void FTextureBufferPlayerTicker::WaitForResidentFrames()
+{
+	// Only sequences still loading can miss their frame, a failed frame of a loaded sequence never arrives
+	auto IsWaiting = [](const UTextureBufferPlayer* Player)
+	{
+		const UTextureBuffer* Buffer = Player->TextureBuffer;
+		return Buffer
+			&& (Buffer->Status == ETextureBufferStatus::E_Enqueued || Buffer->Status == ETextureBufferStatus::E_Loading)
+			&& !Buffer->IsFrameResident(Buffer->GetIndex());
+	};
+
+	// Players sharing a sequence wait for it once
+	auto GetWaitingBuffers = [this, &IsWaiting]()
+	{
+		TArray<UTextureBuffer*> Buffers;
+		for (const TWeakObjectPtr<UTextureBufferPlayer>& Player : WatchedPlayers)
+		{
+			if (Player.IsValid() && IsWaiting(Player.Get()))
+				Buffers.AddUnique(Player->TextureBuffer);
+		}
+		return Buffers;
+	};
+
+	++LockedTicks;
+	LastStallTime = 0.0f;
+
+	TArray<UTextureBuffer*> WaitingBuffers = GetWaitingBuffers();
+	if (WaitingBuffers.Num() < 1)
+		return;
+
+	const double StartTime = FPlatformTime::Seconds();
+	double LastPumpTime = StartTime;
+
+	// Loads complete in game thread tasks, and downloads in the http manager tick, which the engine loop is not running now.
+	// The loads of the frames waited for are completed directly, other game thread tasks wait for the engine loop.
+	while (WaitingBuffers.Num() > 0)
+	{
+		const double Now = FPlatformTime::Seconds();
+		if (Now - StartTime > MaxStallTime)
+		{
+			UE_LOG(LogTemp, Error, TEXT("FTextureBufferPlayerTicker: Frame-locked tick %llu gave up waiting for frames after %.1f s"), GFrameCounter, Now - StartTime);
+			break;
+		}
+
+		FHttpFrameSource::Get().QueueForwardedDownloads();
+		FHttpModule::Get().GetHttpManager().Tick(static_cast<float>(Now - LastPumpTime));
+		LastPumpTime = Now;
+
+		bool Completed = false;
+		for (UTextureBuffer* Buffer : WaitingBuffers)
+			Completed |= UImageLoaderManager::CompleteImageLoads(Buffer, Buffer->GetIndex(), FrameWaitSlice);
+
+		// Nothing is loading, e.g. all frames wait for a download slot
+		if (!Completed)
+			FPlatformProcess::Sleep(0.001f);
+
+		WaitingBuffers = GetWaitingBuffers();
+	}
+
+	LastStallTime = static_cast<float>(FPlatformTime::Seconds() - StartTime);
+	TotalStallTime += LastStallTime;
+	++StalledTicks;
+
+	UE_LOG(LogTemp, Log, TEXT("FTextureBufferPlayerTicker: Frame-locked tick %llu waited %.1f ms for frames"), GFrameCounter, LastStallTime * 1000.0f);
+}
+
+TStatId FTextureBufferPlayerTicker::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(FTextureBufferPlayerTicker, STATGROUP_Tickables);
+}
+
+void FTextureBufferPlayerTicker::Tick(float DeltaTime)
+{
+	TimeSinceVisibilityUpdate += DeltaTime;
+	if (TimeSinceVisibilityUpdate >= VisibilityUpdateInterval)
+	{
+		TimeSinceVisibilityUpdate = 0.0f;
+		UpdateVisibility();
+	}
+
+	Players.RemoveAllSwap([](const TWeakObjectPtr<UTextureBufferPlayer>& Player) { return !Player.IsValid(); });
+
+	// Players sharing a sequence share its buffer, which must only be advanced once per frame
+	TSet<UTextureBuffer*> UpdatedBuffers;
+	TSet<UTileDeltaBuffer*> UpdatedDeltaBuffers;
+
+	auto AdvanceBuffer = [&](UTextureBufferPlayer* Player, const FPlaybackGroup* Group)
+	{
+		bool AlreadyUpdated = false;
+
+		if (Player->TileDeltaBuffer)
+		{
+			UpdatedDeltaBuffers.Add(Player->TileDeltaBuffer, &AlreadyUpdated);
+			if (AlreadyUpdated)
+				return;
+
+			if (Group)
+			{
+				Player->TileDeltaBuffer->SyncToTime(Group->Clock.Time);
+			}
+			else
+			{
+				Player->TileDeltaBuffer->PlaybackRate = Player->PlaybackRate;
+				Player->TileDeltaBuffer->Update(DeltaTime);
+			}
+		}
+		else if (Player->TextureBuffer)
+		{
+			UpdatedBuffers.Add(Player->TextureBuffer, &AlreadyUpdated);
+			if (AlreadyUpdated)
+				return;
+
+			if (Group)
+			{
+				Player->TextureBuffer->SyncToTime(Group->Clock.Time);
+			}
+			else
+			{
+				Player->TextureBuffer->PlaybackRate = Player->PlaybackRate;
+				Player->TextureBuffer->Update(DeltaTime);
+			}
+		}
+	};
+
+	// Grouped players go first, so a buffer shared with players outside the group follows the group
+	// Players that are not rendered pause. Group clocks carry on, so hidden members are in sync when they show up again.
+	for (const TWeakObjectPtr<UTextureBufferPlayer>& Player : Players)
+	{
+		if (Player->PlaybackGroup == NAME_None)
+			continue;
+
+		// The group clock is advanced by the first playing member, every member then follows it
+		FPlaybackGroup& Group = Groups.FindOrAdd(Player->PlaybackGroup);
+		if (Group.LastAdvancedFrame != GFrameCounter)
+		{
+			Group.LastAdvancedFrame = GFrameCounter;
+			Group.Clock.Advance(DeltaTime);
+		}
+
+		if (Player->OnScreen || FrameLocked)
+			AdvanceBuffer(Player.Get(), &Group);
+	}
+
+	for (const TWeakObjectPtr<UTextureBufferPlayer>& Player : Players)
+	{
+		if (Player->PlaybackGroup == NAME_None && (Player->OnScreen || FrameLocked))
+			AdvanceBuffer(Player.Get(), nullptr);
+	}
+
+	if (FrameLocked)
+	{
+		WaitForResidentFrames();
+
+		// Completed loads may have added players or released them
+		Players.RemoveAllSwap([](const TWeakObjectPtr<UTextureBufferPlayer>& Player) { return !Player.IsValid(); });
+	}
+
+	for (const TWeakObjectPtr<UTextureBufferPlayer>& Player : Players)
+	{
+		if ((Player->OnScreen || FrameLocked) && Player->UpdateTextures())
+			Player->UpdateMaterial();
+	}
+}
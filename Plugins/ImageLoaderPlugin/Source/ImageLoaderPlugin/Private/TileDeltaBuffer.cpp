@@ -0,0 +1,393 @@
+#include "TileDeltaBuffer.h"
+#include "DynamicTexture.h"
+#include "ImageLoader.h"
+#include "Async/Async.h"
+#include "Runtime/Core/Public/Async/ParallelFor.h"
+#include "Runtime/Engine/Classes/Engine/Texture2D.h"
+
+
+UTileDeltaBuffer::UTileDeltaBuffer(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
+{
+}
+
+void UTileDeltaBuffer::BeginDestroy()
+{
+	Super::BeginDestroy();
+	ReleaseFence.BeginFence();
+}
+
+bool UTileDeltaBuffer::IsReadyForFinishDestroy()
+{
+	return Super::IsReadyForFinishDestroy() && ReleaseFence.IsFenceComplete();
+}
+
+bool UTileDeltaBuffer::IsLoading() const
+{
+	return (Status == ETextureBufferStatus::E_Loading);
+}
+
+bool UTileDeltaBuffer::IsFinished() const
+{
+	return (Status == ETextureBufferStatus::E_Loaded);
+}
+
+UTexture2D* UTileDeltaBuffer::GetTexture()
+{
+	return DynamicTexture ? DynamicTexture->Texture2D : nullptr;
+}
+
+int32 UTileDeltaBuffer::GetIndex() const
+{
+	return AppliedIndex;
+}
+
+int32 UTileDeltaBuffer::GetFrameCount() const
+{
+	return Frames.Num();
+}
+
+int32 UTileDeltaBuffer::GetEncodedSizeKb() const
+{
+	int64 Bytes = WrapFrame.TileData.Num();
+	for (const FTileDeltaFrame& Frame : Frames)
+		Bytes += Frame.TileData.Num();
+
+	return static_cast<int32>(Bytes >> 10);
+}
+
+int32 UTileDeltaBuffer::GetUploadedTileCount() const
+{
+	return UploadedTiles;
+}
+
+
+bool UTileDeltaBuffer::Update(float DeltaTime)
+{
+	if (!IsFinished())
+		return false;
+
+	Clock.Rate = PlaybackRate;
+	Clock.Advance(DeltaTime);
+
+	bool Reverse = false;
+	return PresentFrame(FPlaybackClock::FrameAtTime(Clock.Time, FrameIntervalInSec, Frames.Num(), false, Reverse));
+}
+
+void UTileDeltaBuffer::SeekToTime(float Seconds)
+{
+	Clock.Seek(Seconds);
+
+	if (IsFinished())
+	{
+		bool Reverse = false;
+		PresentFrame(FPlaybackClock::FrameAtTime(Clock.Time, FrameIntervalInSec, Frames.Num(), false, Reverse));
+	}
+}
+
+bool UTileDeltaBuffer::SyncToTime(double Time)
+{
+	if (!IsFinished())
+		return false;
+
+	Clock.Seek(Time);
+
+	bool Reverse = false;
+	return PresentFrame(FPlaybackClock::FrameAtTime(Clock.Time, FrameIntervalInSec, Frames.Num(), false, Reverse));
+}
+
+
+bool UTileDeltaBuffer::PresentFrame(int32 Target)
+{
+	if (Target == AppliedIndex || !DynamicTexture || Frames.Num() < 1)
+		return false;
+
+	//
+	// Collect the frames to apply. Either walk forward from the current frame (wrapping around
+	// the end of the loop) or restart from the key frame, whichever touches fewer frames.
+	//
+	TArray<const FTileDeltaFrame*> Chain;
+
+	const int32 NumFrames = Frames.Num();
+	const int32 ForwardSteps = (AppliedIndex == INDEX_NONE) ? MAX_int32 : (Target - AppliedIndex + NumFrames) % NumFrames;
+
+	if (ForwardSteps <= Target + 1)
+	{
+		for (int32 Step = 1; Step <= ForwardSteps; ++Step)
+		{
+			const int32 Idx = (AppliedIndex + Step) % NumFrames;
+			Chain.Add((Idx == 0) ? &WrapFrame : &Frames[Idx]);
+		}
+	}
+	else
+	{
+		for (int32 Idx = 0; Idx <= Target; ++Idx)
+			Chain.Add(&Frames[Idx]);
+	}
+
+	//
+	// Walk the chain backwards so that a tile changed by several skipped frames is uploaded only once, from its latest version
+	//
+	const int32 TilesX = FMath::DivideAndRoundUp(Width, TileSize);
+	const int32 TilesY = FMath::DivideAndRoundUp(Height, TileSize);
+	TBitArray<> Covered(false, TilesX * TilesY);
+	TArray<FUpdateTextureRegion2D> Regions;
+
+	for (int32 ChainIdx = Chain.Num() - 1; ChainIdx >= 0; --ChainIdx)
+	{
+		const FTileDeltaFrame& Frame = *Chain[ChainIdx];
+
+		Regions.Reset();
+		for (int32 RegionIdx = 0; RegionIdx < Frame.Regions.Num(); ++RegionIdx)
+		{
+			const int32 TileIndex = Frame.TileIndices[RegionIdx];
+			if (!Covered[TileIndex])
+			{
+				Covered[TileIndex] = true;
+				Regions.Add(Frame.Regions[RegionIdx]);
+			}
+		}
+
+		if (Regions.Num() > 0)
+		{
+			DynamicTexture->UpdateRegions(Regions, Frame.TileData.GetData(), Frame.SrcPitch);
+			UploadedTiles += Regions.Num();
+		}
+	}
+
+	AppliedIndex = Target;
+	return true;
+}
+
+
+bool UTileDeltaBuffer::LoadImageSequence()
+{
+	if (Status == ETextureBufferStatus::E_Loading || Status == ETextureBufferStatus::E_Loaded)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("UTileDeltaBuffer::LoadImageSequence: Already loading or loaded. %s"), *GetName());
+		return false;
+	}
+
+	if (FileList.Num() < 1 || TileSize < 1)
+	{
+		UE_LOG(LogTemp, Error, TEXT("UTileDeltaBuffer::LoadImageSequence: Invalid file list or tile size %d %d"), FileList.Num(), TileSize);
+		return false;
+	}
+
+	Status = ETextureBufferStatus::E_Loading;
+
+	TWeakObjectPtr<UTileDeltaBuffer> WeakThis(this);
+	TArray<FString> Files = FileList;
+	const int32 InTileSize = TileSize;
+
+	Async(EAsyncExecution::ThreadPool, [WeakThis, Files, InTileSize]()
+	{
+		TSharedPtr<FEncodedSequence, ESPMode::ThreadSafe> Encoded = MakeShared<FEncodedSequence, ESPMode::ThreadSafe>();
+		if (!EncodeSequence(Files, InTileSize, *Encoded))
+			Encoded.Reset();
+
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, Encoded]()
+		{
+			if (WeakThis.IsValid())
+				WeakThis->OnEncodeCompleted(Encoded);
+		});
+	});
+
+	return true;
+}
+
+
+void UTileDeltaBuffer::OnEncodeCompleted(TSharedPtr<FEncodedSequence, ESPMode::ThreadSafe> Encoded)
+{
+	if (Status != ETextureBufferStatus::E_Loading)
+		return;
+
+	if (!Encoded.IsValid())
+	{
+		UE_LOG(LogTemp, Error, TEXT("UTileDeltaBuffer::OnEncodeCompleted: Could not encode sequence %s"), *SequenceName.ToString());
+		Status = ETextureBufferStatus::E_Unloaded;
+		return;
+	}
+
+	Width = Encoded->Width;
+	Height = Encoded->Height;
+	Frames = MoveTemp(Encoded->Frames);
+	WrapFrame = MoveTemp(Encoded->WrapFrame);
+
+	if (!DynamicTexture)
+		DynamicTexture = NewObject<UDynamicTexture>(this);
+
+	DynamicTexture->CreateResource(Width, Height, EPixelFormat::PF_B8G8R8A8, TextureAddress::TA_Clamp);
+
+	AppliedIndex = INDEX_NONE;
+	UploadedTiles = 0;
+	Clock.Seek(0.0);
+	PresentFrame(0);
+
+	UE_LOG(LogTemp, Warning, TEXT(">> %d UTileDeltaBuffer::LoadImageSequence: <Completed> : %s %d Kb"), Frames.Num(), *SequenceName.ToString(), GetEncodedSizeKb());
+
+	Status = ETextureBufferStatus::E_Loaded;
+	ImageSequenceLoadCompleted.Broadcast(Frames.Num(), SequenceName);
+}
+
+
+void UTileDeltaBuffer::ReleaseBuffer()
+{
+	// Pending uploads read straight from the tile data
+	FlushRenderingCommands();
+
+	Frames.Empty();
+	WrapFrame = FTileDeltaFrame();
+	AppliedIndex = INDEX_NONE;
+
+	if (DynamicTexture)
+	{
+		DynamicTexture->DestroyTexture2D();
+		DynamicTexture = nullptr;
+	}
+
+	Status = ETextureBufferStatus::E_Unloaded;
+}
+
+
+bool UTileDeltaBuffer::EncodeSequence(const TArray<FString>& Files, int32 InTileSize, FEncodedSequence& Out)
+{
+	struct FDecodedFrame
+	{
+		TArray<uint8> Pixels;
+		int32 Width = 0;
+		int32 Height = 0;
+	};
+
+	Out.Frames.SetNum(Files.Num());
+
+	// Frames are decoded in parallel batches, then each one is compared with its predecessor
+	const int32 BatchSize = FMath::Max(1, FPlatformMisc::NumberOfCoresIncludingHyperthreads());
+
+	FDecodedFrame First;
+	FDecodedFrame Prev;
+
+	for (int32 BatchStart = 0; BatchStart < Files.Num(); BatchStart += BatchSize)
+	{
+		const int32 BatchCount = FMath::Min(BatchSize, Files.Num() - BatchStart);
+
+		TArray<FDecodedFrame> Batch;
+		Batch.SetNum(BatchCount);
+
+		ParallelFor(BatchCount, [&](int32 Idx)
+		{
+			FDecodedFrame& Frame = Batch[Idx];
+			UImageLoader::LoadRawImageFromDisk(Files[BatchStart + Idx], Frame.Pixels, Frame.Width, Frame.Height);
+		});
+
+		for (int32 Idx = 0; Idx < BatchCount; ++Idx)
+		{
+			const FDecodedFrame& Frame = Batch[Idx];
+			if (Frame.Pixels.Num() < 1)
+			{
+				UE_LOG(LogTemp, Error, TEXT("UTileDeltaBuffer::EncodeSequence: Could not decode %s"), *Files[BatchStart + Idx]);
+				return false;
+			}
+
+			if (BatchStart + Idx == 0)
+			{
+				Out.Width = Frame.Width;
+				Out.Height = Frame.Height;
+			}
+			else if (Frame.Width != Out.Width || Frame.Height != Out.Height)
+			{
+				UE_LOG(LogTemp, Error, TEXT("UTileDeltaBuffer::EncodeSequence: Frame size differs from the first frame %s"), *Files[BatchStart + Idx]);
+				return false;
+			}
+		}
+
+		ParallelFor(BatchCount, [&](int32 Idx)
+		{
+			const uint8* PrevPixels = nullptr;
+			if (Idx > 0)
+				PrevPixels = Batch[Idx - 1].Pixels.GetData();
+			else if (BatchStart > 0)
+				PrevPixels = Prev.Pixels.GetData();
+
+			EncodeFrame(PrevPixels, Batch[Idx].Pixels.GetData(), Out.Width, Out.Height, InTileSize, Out.Frames[BatchStart + Idx]);
+		});
+
+		if (BatchStart == 0)
+			First.Pixels = Batch[0].Pixels;
+
+		Prev = MoveTemp(Batch[BatchCount - 1]);
+	}
+
+	if (Files.Num() > 1)
+		EncodeFrame(Prev.Pixels.GetData(), First.Pixels.GetData(), Out.Width, Out.Height, InTileSize, Out.WrapFrame);
+
+	return true;
+}
+
+
+void UTileDeltaBuffer::EncodeFrame(const uint8* PrevPixels, const uint8* Pixels, int32 Width, int32 Height, int32 InTileSize, FTileDeltaFrame& Out)
+{
+	const int32 Bpp = 4;
+	const int32 Pitch = Width * Bpp;
+	const int32 TilesX = FMath::DivideAndRoundUp(Width, InTileSize);
+	const int32 TilesY = FMath::DivideAndRoundUp(Height, InTileSize);
+
+	//
+	// Key frame: keep the full image and address every tile in place
+	//
+	if (!PrevPixels)
+	{
+		Out.TileData.SetNumUninitialized(Pitch * Height);
+		FMemory::Memcpy(Out.TileData.GetData(), Pixels, Pitch * Height);
+		Out.SrcPitch = Pitch;
+
+		for (int32 TileY = 0; TileY < TilesY; ++TileY)
+		{
+			for (int32 TileX = 0; TileX < TilesX; ++TileX)
+			{
+				const uint32 X = TileX * InTileSize;
+				const uint32 Y = TileY * InTileSize;
+				const uint32 W = FMath::Min(InTileSize, Width - TileX * InTileSize);
+				const uint32 H = FMath::Min(InTileSize, Height - TileY * InTileSize);
+				Out.Regions.Add(FUpdateTextureRegion2D(X, Y, X, Y, W, H));
+				Out.TileIndices.Add(TileY * TilesX + TileX);
+			}
+		}
+		return;
+	}
+
+	//
+	// Delta frame: copy only the tiles with at least one changed row, stacked into a column of tiles
+	//
+	const int32 TilePitch = InTileSize * Bpp;
+	const int32 TileBytes = TilePitch * InTileSize;
+	Out.SrcPitch = TilePitch;
+
+	for (int32 TileY = 0; TileY < TilesY; ++TileY)
+	{
+		for (int32 TileX = 0; TileX < TilesX; ++TileX)
+		{
+			const int32 X = TileX * InTileSize;
+			const int32 Y = TileY * InTileSize;
+			const int32 W = FMath::Min(InTileSize, Width - X);
+			const int32 H = FMath::Min(InTileSize, Height - Y);
+			const int32 Offset = Y * Pitch + X * Bpp;
+
+			bool Changed = false;
+			for (int32 Row = 0; Row < H && !Changed; ++Row)
+				Changed = (FMemory::Memcmp(PrevPixels + Offset + Row * Pitch, Pixels + Offset + Row * Pitch, W * Bpp) != 0);
+
+			if (!Changed)
+				continue;
+
+			const int32 Slot = Out.Regions.Num();
+			Out.TileData.AddUninitialized(TileBytes);
+			uint8* Dst = Out.TileData.GetData() + Slot * TileBytes;
+
+			for (int32 Row = 0; Row < H; ++Row)
+				FMemory::Memcpy(Dst + Row * TilePitch, Pixels + Offset + Row * Pitch, W * Bpp);
+
+			Out.Regions.Add(FUpdateTextureRegion2D(X, Y, 0, Slot * InTileSize, W, H));
+			Out.TileIndices.Add(TileY * TilesX + TileX);
+		}
+	}
+}
@@ -0,0 +1,108 @@
+#include "UploadBufferPool.h"
+#include "ImageLoaderStats.h"
+#include "Misc/ScopeLock.h"
+
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Upload Buffers In Use"), STAT_UploadBuffersInUse, STATGROUP_ImageLoader);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Upload Buffers Idle"), STAT_UploadBuffersIdle, STATGROUP_ImageLoader);
+DECLARE_MEMORY_STAT(TEXT("Upload Buffer Memory"), STAT_UploadBufferPoolMemory, STATGROUP_ImageLoader);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Upload Buffer Reuses"), STAT_UploadBufferReuses, STATGROUP_ImageLoader);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Upload Buffer Allocations"), STAT_UploadBufferAllocations, STATGROUP_ImageLoader);
+
+
+FUploadBufferPool& FUploadBufferPool::Get()
+{
+	static FUploadBufferPool Pool;
+	return Pool;
+}
+
+FUploadBufferPool::~FUploadBufferPool()
+{
+	Trim();
+}
+
+TArray<uint8>* FUploadBufferPool::Acquire(int32 Size)
+{
+	TArray<uint8>* Buffer = nullptr;
+	{
+		FScopeLock Lock(&Mutex);
+
+		// An exact size match first, then any buffer large enough to be resized without reallocation
+		int32 Found = IdleBuffers.IndexOfByPredicate([Size](const TArray<uint8>* Idle) { return Idle->Num() == Size; });
+		if (Found == INDEX_NONE)
+			Found = IdleBuffers.IndexOfByPredicate([Size](const TArray<uint8>* Idle) { return Idle->Max() >= Size; });
+
+		if (Found != INDEX_NONE)
+		{
+			Buffer = IdleBuffers[Found];
+			IdleBuffers.RemoveAtSwap(Found);
+			DEC_DWORD_STAT(STAT_UploadBuffersIdle);
+			INC_DWORD_STAT(STAT_UploadBufferReuses);
+			++Reuses;
+		}
+		else
+		{
+			INC_DWORD_STAT(STAT_UploadBufferAllocations);
+			++Allocations;
+		}
+
+		++NumInUse;
+		INC_DWORD_STAT(STAT_UploadBuffersInUse);
+	}
+
+	if (!Buffer)
+	{
+		Buffer = new TArray<uint8>();
+		Buffer->SetNumUninitialized(Size, false);
+		INC_MEMORY_STAT_BY(STAT_UploadBufferPoolMemory, Buffer->GetAllocatedSize());
+		return Buffer;
+	}
+
+	Buffer->SetNumUninitialized(Size, false);
+	return Buffer;
+}
+
+void FUploadBufferPool::Release(TArray<uint8>* Buffer)
+{
+	if (!Buffer)
+		return;
+
+	FScopeLock Lock(&Mutex);
+
+	--NumInUse;
+	DEC_DWORD_STAT(STAT_UploadBuffersInUse);
+
+	if (IdleBuffers.Num() >= MaxIdleBuffers)
+	{
+		DEC_MEMORY_STAT_BY(STAT_UploadBufferPoolMemory, Buffer->GetAllocatedSize());
+		delete Buffer;
+		return;
+	}
+
+	IdleBuffers.Add(Buffer);
+	INC_DWORD_STAT(STAT_UploadBuffersIdle);
+}
+
+void FUploadBufferPool::Trim()
+{
+	FScopeLock Lock(&Mutex);
+
+	for (TArray<uint8>* Buffer : IdleBuffers)
+	{
+		DEC_MEMORY_STAT_BY(STAT_UploadBufferPoolMemory, Buffer->GetAllocatedSize());
+		delete Buffer;
+	}
+
+	DEC_DWORD_STAT_BY(STAT_UploadBuffersIdle, IdleBuffers.Num());
+	IdleBuffers.Empty();
+}
+
+void FUploadBufferPool::GetStats(int32& OutNumBuffers, int32& OutNumInUse, int64& OutReuses, int64& OutAllocations) const
+{
+	FScopeLock Lock(&Mutex);
+
+	OutNumBuffers = IdleBuffers.Num() + NumInUse;
+	OutNumInUse = NumInUse;
+	OutReuses = Reuses;
+	OutAllocations = Allocations;
+}
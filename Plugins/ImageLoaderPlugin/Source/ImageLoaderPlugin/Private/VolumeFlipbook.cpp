@@ -0,0 +1,260 @@
+#include "VolumeFlipbook.h"
+#include "ImageDownscale.h"
+#include "Async/Async.h"
+#include "Runtime/Core/Public/Async/ParallelFor.h"
+#include "Engine/VolumeTexture.h"
+#include "Engine/World.h"
+#include "Materials/MaterialInstanceDynamic.h"
+
+
+bool UVolumeFlipbook::IsLoading() const
+{
+	return (Status == ETextureBufferStatus::E_Loading);
+}
+
+bool UVolumeFlipbook::IsFinished() const
+{
+	return (Status == ETextureBufferStatus::E_Loaded);
+}
+
+
+bool UVolumeFlipbook::PackSequence(const TArray<FString>& Files, ETextureResolutionTier Tier, FPackedVolume& Out)
+{
+	auto DecodeFrame = [Tier](const FString& File, TArray<uint8>& OutPixels, int32& OutWidth, int32& OutHeight)
+	{
+		if (!UImageLoader::LoadRawImageFromDisk(File, OutPixels, OutWidth, OutHeight))
+			return false;
+
+		if (Tier == ETextureResolutionTier::E_Full)
+			return true;
+
+		TArray<uint8> Scaled;
+		if (!FImageDownscale::DownscaleBGRA8(OutPixels.GetData(), OutWidth, OutHeight, static_cast<int32>(Tier), Scaled, OutWidth, OutHeight))
+			return false;
+
+		OutPixels = MoveTemp(Scaled);
+		return true;
+	};
+
+	// The first frame sets the size of the slices
+	TArray<uint8> FirstFrame;
+	if (!DecodeFrame(Files[0], FirstFrame, Out.Width, Out.Height))
+	{
+		UE_LOG(LogTemp, Error, TEXT("UVolumeFlipbook::PackSequence: Could not decode %s"), *Files[0]);
+		return false;
+	}
+
+	const int32 SliceSize = Out.Width * Out.Height * 4;
+	Out.Depth = Files.Num();
+	Out.Format = EPixelFormat::PF_B8G8R8A8;
+	Out.Data.SetNumUninitialized(SliceSize * Out.Depth);
+	FMemory::Memcpy(Out.Data.GetData(), FirstFrame.GetData(), SliceSize);
+	FirstFrame.Empty();
+
+	FThreadSafeCounter Failures;
+	ParallelFor(Files.Num() - 1, [&](int32 Idx)
+	{
+		const int32 Slice = Idx + 1;
+		TArray<uint8> Pixels;
+		int32 FrameWidth = 0;
+		int32 FrameHeight = 0;
+		if (!DecodeFrame(Files[Slice], Pixels, FrameWidth, FrameHeight) || FrameWidth != Out.Width || FrameHeight != Out.Height)
+		{
+			UE_LOG(LogTemp, Error, TEXT("UVolumeFlipbook::PackSequence: Could not decode %s, or its size differs from the first frame"), *Files[Slice]);
+			Failures.Increment();
+			return;
+		}
+
+		FMemory::Memcpy(Out.Data.GetData() + static_cast<int64>(Slice) * SliceSize, Pixels.GetData(), SliceSize);
+	});
+
+	return Failures.GetValue() == 0;
+}
+
+
+bool UVolumeFlipbook::LoadImageSequence()
+{
+	if (Status == ETextureBufferStatus::E_Loading || Status == ETextureBufferStatus::E_Loaded)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("UVolumeFlipbook::LoadImageSequence: Already loading or loaded. %s"), *GetName());
+		return false;
+	}
+
+	if (FileList.Num() < 1)
+	{
+		UE_LOG(LogTemp, Error, TEXT("UVolumeFlipbook::LoadImageSequence: Empty file list. %s"), *GetName());
+		return false;
+	}
+
+	Status = ETextureBufferStatus::E_Loading;
+
+	TWeakObjectPtr<UVolumeFlipbook> WeakThis(this);
+	const TArray<FString> Files = FileList;
+	const ETextureResolutionTier Tier = ResolutionTier;
+
+	Async(EAsyncExecution::ThreadPool, [WeakThis, Files, Tier]()
+	{
+		TSharedPtr<FPackedVolume, ESPMode::ThreadSafe> Packed = MakeShared<FPackedVolume, ESPMode::ThreadSafe>();
+
+		bool Loaded = false;
+		if (Files.Num() == 1 && FPaths::GetExtension(Files[0]).Equals(TEXT("dds"), ESearchCase::IgnoreCase))
+			Loaded = UImageLoader::LoadDDSVolumeFromDisk(Files[0], Packed->Data, Packed->Width, Packed->Height, Packed->Depth, Packed->Format);
+		else
+			Loaded = PackSequence(Files, Tier, *Packed);
+
+		if (!Loaded)
+			Packed.Reset();
+
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, Packed]()
+		{
+			if (WeakThis.IsValid())
+				WeakThis->OnLoadCompleted(Packed);
+		});
+	});
+
+	return true;
+}
+
+
+void UVolumeFlipbook::OnLoadCompleted(TSharedPtr<FPackedVolume, ESPMode::ThreadSafe> Packed)
+{
+	// Released while loading
+	if (Status != ETextureBufferStatus::E_Loading)
+		return;
+
+	if (Packed.IsValid())
+		VolumeTexture = UImageLoader::CreateVolumeTexture(this, Packed->Data, Packed->Width, Packed->Height, Packed->Depth, Packed->Format, SequenceName);
+
+	if (!VolumeTexture)
+	{
+		UE_LOG(LogTemp, Error, TEXT("UVolumeFlipbook::LoadImageSequence: Could not create the volume texture of %s"), *SequenceName.ToString());
+		Status = ETextureBufferStatus::E_Unloaded;
+		return;
+	}
+
+	if (!InterpolateFrames)
+	{
+		VolumeTexture->Filter = TextureFilter::TF_Nearest;
+		VolumeTexture->UpdateResource();
+	}
+
+	Depth = Packed->Depth;
+	Status = ETextureBufferStatus::E_Loaded;
+
+	UE_LOG(LogTemp, Warning, TEXT(">> %d UVolumeFlipbook::LoadImageSequence: <Completed> : %s %d x %d, %d Kb"), Depth, *SequenceName.ToString(), Packed->Width, Packed->Height, Packed->Data.Num() / 1024);
+
+	UpdatePlayback(GetPhase());
+	ImageSequenceLoadCompleted.Broadcast(Depth, SequenceName);
+}
+
+
+void UVolumeFlipbook::ReleaseBuffer()
+{
+	for (const FBoundMaterial& Bound : BoundMaterials)
+	{
+		if (Bound.Material.IsValid())
+			Bound.Material->SetTextureParameterValue(Bound.TextureName, nullptr);
+	}
+
+	VolumeTexture = nullptr;
+	Depth = 0;
+	Status = ETextureBufferStatus::E_Unloaded;
+}
+
+
+void UVolumeFlipbook::BindMaterial(UMaterialInstanceDynamic* Material, FName TextureName, FName PlaybackName)
+{
+	if (!Material)
+		return;
+
+	UnbindMaterial(Material);
+	BoundMaterials.Add({ Material, TextureName, PlaybackName });
+	ApplyToMaterial(Material, TextureName, PlaybackName);
+}
+
+void UVolumeFlipbook::UnbindMaterial(UMaterialInstanceDynamic* Material)
+{
+	BoundMaterials.RemoveAll([Material](const FBoundMaterial& Bound) { return !Bound.Material.IsValid() || Bound.Material.Get() == Material; });
+}
+
+
+void UVolumeFlipbook::Play()
+{
+	const float Phase = GetPhase();
+	IsPlaying = true;
+	UpdatePlayback(Phase);
+}
+
+void UVolumeFlipbook::Pause()
+{
+	const float Phase = GetPhase();
+	IsPlaying = false;
+	UpdatePlayback(Phase);
+}
+
+void UVolumeFlipbook::SeekToTime(float Seconds)
+{
+	const float Duration = Depth * FrameIntervalInSec;
+	UpdatePlayback(Duration > 0.0f ? FMath::Frac(Seconds / Duration) : 0.0f);
+}
+
+void UVolumeFlipbook::SetPlaybackRate(float Rate)
+{
+	const float Phase = GetPhase();
+	PlaybackRate = Rate;
+	UpdatePlayback(Phase);
+}
+
+
+float UVolumeFlipbook::GetTime() const
+{
+	return GetPhase() * Depth * FrameIntervalInSec;
+}
+
+float UVolumeFlipbook::GetDepthCoordinate() const
+{
+	// Linear filtering needs the slice centers, point filtering the slice starts
+	const float Offset = (InterpolateFrames && Depth > 0) ? 0.5f / Depth : 0.0f;
+	return FMath::Frac(GetPhase() + Offset);
+}
+
+
+float UVolumeFlipbook::GetWorldTime() const
+{
+	const UWorld* World = GetWorld();
+	return World ? World->GetTimeSeconds() : 0.0f;
+}
+
+float UVolumeFlipbook::GetPhase() const
+{
+	const float Duration = Depth * FrameIntervalInSec;
+	if (!IsPlaying || Duration <= 0.0f)
+		return StartPhase;
+
+	return FMath::Frac(StartPhase + (GetWorldTime() - StartWorldTime) * PlaybackRate / Duration);
+}
+
+
+void UVolumeFlipbook::UpdatePlayback(float Phase)
+{
+	// Anchored at the current time, so the float time in the material stays close to the anchor
+	StartWorldTime = GetWorldTime();
+	StartPhase = Phase;
+
+	BoundMaterials.RemoveAll([](const FBoundMaterial& Bound) { return !Bound.Material.IsValid(); });
+	for (const FBoundMaterial& Bound : BoundMaterials)
+		ApplyToMaterial(Bound.Material.Get(), Bound.TextureName, Bound.PlaybackName);
+}
+
+void UVolumeFlipbook::ApplyToMaterial(UMaterialInstanceDynamic* Material, FName TextureName, FName PlaybackName) const
+{
+	if (!VolumeTexture || Depth <= 0)
+		return;
+
+	const float Duration = Depth * FrameIntervalInSec;
+	const float Offset = InterpolateFrames ? 0.5f / Depth : 0.0f;
+	const float PhasePerSecond = (IsPlaying && Duration > 0.0f) ? PlaybackRate / Duration : 0.0f;
+
+	Material->SetTextureParameterValue(TextureName, VolumeTexture);
+	Material->SetVectorParameterValue(PlaybackName, FLinearColor(StartWorldTime, PhasePerSecond, StartPhase + Offset, static_cast<float>(Depth)));
+}
@@ -4,12 +4,35 @@
 
 //#include <memory>
 #include "CoreMinimal.h"
+#include "RenderingThread.h"
+#include "Templates/Atomic.h"
+#include "PixelFormatConversion.h"
 #include "DynamicTexture.generated.h"
 
 class UTexture2D;
+class FDynamicTextureIngest;
+struct FDynamicTextureFrame;
+struct FDynamicTextureIngestStats;
 struct FUpdateTextureRegion2D;
 
 
+/** Pixel buffer owned by a UDynamicTexture, filled by a producer while earlier buffers are being uploaded. */
+struct FDynamicTextureStagingBuffer
+{
+	enum EState : int32
+	{
+		Free,
+		Acquired,
+		Uploading
+	};
+
+	TArray<uint8> Data;
+
+	/** Moved from Free to Acquired by the producer, and back to Free by the render thread once uploaded. */
+	volatile int32 State = Free;
+};
+
+
 UCLASS(Blueprintable, BlueprintType)
 class IMAGELOADERPLUGIN_API UDynamicTexture : public UObject
 {
@@ -19,12 +42,16 @@ public:
     
     UDynamicTexture(const FObjectInitializer& ObjectInitializer);
     virtual ~UDynamicTexture();
+
+	virtual void BeginDestroy() override;
+	virtual bool IsReadyForFinishDestroy() override;
         	
     UFUNCTION(BlueprintCallable, Category = "Dynamic Texture")
     void ReleaseCpuMemory();
 
+    /** Releases the texture. Refused while a staging buffer is acquired by a producer. */
     UFUNCTION(BlueprintCallable, Category = "Dynamic Texture")
-    void DestroyTexture2D();
+    bool DestroyTexture2D();
 
     UFUNCTION(BlueprintCallable, Category = "Dynamic Texture")
     bool IsCreated() const { return Created; }
@@ -35,8 +62,12 @@ public:
     UFUNCTION(BlueprintCallable, Category = "Dynamic Texture")
     void SetUploadPendant() { Uploaded = false; }
 
+    /**
+    Creates the texture, or keeps the current one if it has the same size, format and mip count.
+    @param NumMips Number of mip levels, clamped to the full chain.
+    */
     UFUNCTION(BlueprintCallable, Category = "Dynamic Texture")
-    bool CreateResource(int32 w, int32 h, EPixelFormat pixelFormat = EPixelFormat::PF_B8G8R8A8, TextureAddress TexTilingAddres = TextureAddress::TA_Wrap);
+    bool CreateResource(int32 w, int32 h, EPixelFormat pixelFormat = EPixelFormat::PF_B8G8R8A8, TextureAddress TexTilingAddres = TextureAddress::TA_Wrap, int32 NumMips = 1);
 
     UFUNCTION(BlueprintCallable, Category = "Dynamic Texture")
     bool UpdateGpu();
@@ -44,17 +75,92 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Dynamic Texture")
 	bool UpdateRandomGpu();
 
+	/**
+	Uploads several regions of a 4 bytes per pixel source buffer in a single render command.
+	The region list is copied, but SrcData must stay valid until the render thread has consumed it.
+	*/
+	bool UpdateRegions(const TArray<FUpdateTextureRegion2D>& Regions, const uint8* SrcData, uint32 SrcPitch);
+
+	/** Marks a rectangle of the pixel data as changed since the last upload. Clipped to the texture. */
+	UFUNCTION(BlueprintCallable, Category = "Dynamic Texture")
+	void MarkDirtyRect(int32 X, int32 Y, int32 RectWidth, int32 RectHeight);
+
+	/**
+	Uploads the rectangles marked dirty since the last upload from the pixel data in one render command.
+	Overlapping and adjacent rectangles are merged first, and a mostly dirty texture is uploaded whole.
+	@return False if there was nothing to upload.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "Dynamic Texture")
+	bool UpdateDirtyGpu();
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Dynamic Texture")
+	bool HasDirtyRects() const { return DirtyRects.Num() > 0; }
+
+    /** The pixel data is referenced, not copied, and must stay unchanged until the upload has been done. See AcquireStagingBuffer. */
     //UFUNCTION(BlueprintCallable, Category = "Dynamic Texture")
     void UpdatePixels(const TArray<uint8>& PixelData);
 
+	/**
+	Sets the number of staging buffers, 2 for double and 3 for triple buffering. Waits for pending uploads.
+	@return False while a buffer is acquired by a producer, the count is then unchanged.
+	*/
+	bool SetStagingBufferCount(int32 Count);
+
+	/**
+	Hands out a free staging buffer of Width * Height * 4 bytes. Safe to call from any thread.
+	@return nullptr if all buffers are being filled or uploaded.
+	*/
+	uint8* AcquireStagingBuffer(int32& OutIndex);
+
+	/**
+	Uploads an acquired staging buffer, or the dirty rectangles marked since the last upload. The buffer
+	returns to the free ones once the render thread has consumed it. Game thread only.
+	*/
+	bool SubmitStagingBuffer(int32 Index);
+
+	/** Returns an acquired staging buffer without uploading it. */
+	void ReleaseStagingBuffer(int32 Index);
+
+	/**
+	Converts a Width x Height frame of another layout to BGRA in a staging buffer and uploads it. Game thread only,
+	for PF_B8G8R8A8 textures.
+	@param SrcPitch Bytes per source row, 0 for tightly packed rows.
+	@return False if no staging buffer is free, the frame is then dropped.
+	*/
+	bool UpdateFromSource(const uint8* Src, int32 SrcPitch, ESourcePixelLayout Layout, bool PremultiplyAlpha = false);
+
+	/**
+	Starts taking frames from an external producer through PushFrame. The render thread presents
+	the newest pushed frame every frame. Game thread only, after CreateResource.
+	@param Capacity Frames the ring holds before PushFrame is rejected, at least 2.
+	*/
+	bool StartIngest(int32 Capacity = 4);
+
+	/**
+	Stops the ingest. Frames still queued are released on the render thread. Game thread only.
+	A push in progress completes safely, its frame is then released by the pushing thread.
+	*/
+	void StopIngest();
+
+	/**
+	Queues a full frame for upload. Callable from any thread. The ring is lock-free, a push only locks to pin the ingest.
+	@return False if the ingest is not running, its ring is full or the frame does not match the texture.
+	The frame then stays with the producer.
+	*/
+	bool PushFrame(const FDynamicTextureFrame& Frame);
+
+	bool GetIngestStats(FDynamicTextureIngestStats& OutStats) const;
+
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Dynamic Texture")
 	int32 SizeKb() const;
 
+    /** Fills Pixels with an animated plasma pattern, used as a synthetic frame source. Rows are generated in parallel. */
     static void RandomTexture(float Time, int Width, int Height, uint8* Pixels);
 
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Dynamic Texture")
     UTexture2D* Texture2D = nullptr;
 
+	/** Loads a DXT1 or DXT5 DDS file with all its mip levels, reusing the texture if the layout matches. */
 	UFUNCTION(BlueprintCallable, Category = "Dynamic Texture")
 	bool Load(FString ImagePath);
 
@@ -72,6 +178,29 @@ private:
 
 	FUpdateTextureRegion2D UpdateTextureRegion;
 
+	TArray<FIntRect> DirtyRects;
+
+	/** Builds the region list for the dirty rectangles, or the full texture if none or most of it is dirty. */
+	void TakeDirtyRegions(TArray<FUpdateTextureRegion2D>& OutRegions);
+
+	/**
+	Takes the staging buffers out of the ring, unless a producer holds one. They are destroyed by the caller,
+	after the uploads still reading them have been flushed. Call with StagingMutex held.
+	*/
+	bool DetachStagingBuffers(TArray<TUniquePtr<FDynamicTextureStagingBuffer>>& OutBuffers);
+
+	// Owned through pointers, the render thread writes to the state of a buffer after its upload
+	TArray<TUniquePtr<FDynamicTextureStagingBuffer>> StagingBuffers;
+	FThreadSafeCounter NextStagingBuffer;
+	int32 StagingBufferCount = 3;
+	FCriticalSection StagingMutex;
+
+	FRenderCommandFence ReleaseFence;
+
+	// Ticked by the render thread. Producers pin it for the duration of a push, the lock only guards the pointer.
+	TSharedPtr<FDynamicTextureIngest, ESPMode::ThreadSafe> Ingest;
+	mutable FCriticalSection IngestMutex;
+
 	
 };
 
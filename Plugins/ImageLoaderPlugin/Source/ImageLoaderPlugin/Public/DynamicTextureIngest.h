@@ -0,0 +1,123 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PixelFormat.h"
+#include "Templates/Atomic.h"
+#include "Templates/UniquePtr.h"
+#include "TickableObjectRenderThread.h"
+
+class FTexture2DResource;
+
+
+/** A frame pushed by an external producer. The pixels are referenced until OnReleased is called. */
+struct FDynamicTextureFrame
+{
+	const uint8* Data = nullptr;
+
+	/** Bytes per row of Data, or per row of blocks for compressed formats. At least the size of a row of the texture. */
+	uint32 Pitch = 0;
+
+	/** Must match the format of the texture, frames of another format are dropped. */
+	EPixelFormat Format = PF_Unknown;
+
+	/**
+	Called once the frame has been uploaded or dropped, after which the producer may reuse Data. That is on the render
+	thread, except for frames still queued when the ingest stops, which the thread releasing it last releases.
+	Not called for frames PushFrame rejects.
+	*/
+	TFunction<void()> OnReleased;
+
+	/** Set by PushFrame, used for the latency counters. */
+	uint64 PushCycles = 0;
+};
+
+
+struct FDynamicTextureIngestStats
+{
+	int32 Presented = 0;
+
+	/** Frames replaced by a newer one before they were presented. */
+	int32 Dropped = 0;
+
+	/** Frames rejected by PushFrame because the ring was full or the frame did not match the texture. */
+	int32 Rejected = 0;
+
+	/** Time from push to upload of the last presented frame, and the largest one seen. */
+	float LastLatencyMs = 0.0f;
+	float MaxLatencyMs = 0.0f;
+};
+
+
+/**
+Lock-free multiple producer, single consumer ring of frames from external decoder or capture threads.
+Any thread may push, and the render thread uploads the newest complete frame once per frame and releases
+the stale ones, without going through the game thread.
+The owner shares the ingest with the pushing threads, whichever releases it last deletes it, so frames
+pushed while it stops may be released on a pushing thread.
+*/
+class IMAGELOADERPLUGIN_API FDynamicTextureIngest : public FTickableObjectRenderThread
+{
+public:
+
+	/** @param Capacity Frames the ring holds, at least 2. */
+	FDynamicTextureIngest(int32 Capacity, FTexture2DResource* InResource, int32 InWidth, int32 InHeight, EPixelFormat InFormat);
+	virtual ~FDynamicTextureIngest();
+
+	/**
+	Callable from any thread.
+	@return False if the ring is full, or the frame has no data, another format or a pitch shorter than a row.
+	The frame is then not released, it stays with the producer.
+	*/
+	bool PushFrame(FDynamicTextureFrame Frame);
+
+	/** Releases the queued frames. Render thread, once unregistered. */
+	void ReleaseQueuedFrames();
+
+	FDynamicTextureIngestStats GetStats() const;
+
+	/** FTickableObjectRenderThread implementation */
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override { return true; }
+	virtual TStatId GetStatId() const override;
+
+private:
+
+	static void Release(FDynamicTextureFrame& Frame);
+
+	/** Takes the oldest queued frame. Consumer only, i.e. the render thread or the last owner. */
+	bool Dequeue(FDynamicTextureFrame& OutFrame);
+
+	/**
+	A slot holds a frame once its sequence is one past the position written to it, and is free for the
+	position a lap later once the consumer has moved its sequence there.
+	*/
+	struct FSlot
+	{
+		TAtomic<uint64> Sequence { 0 };
+		FDynamicTextureFrame Frame;
+	};
+
+	TUniquePtr<FSlot[]> Slots;
+	const uint64 NumSlots;
+
+	/** Next position to push to, claimed by the producers. Positions are 64 bits so they never wrap. */
+	TAtomic<uint64> PushPosition { 0 };
+
+	/** Next position to take from. Consumer only. */
+	uint64 PopPosition = 0;
+
+	/** Smallest pitch of a frame, one row of pixels or blocks. */
+	uint32 MinPitch;
+
+	// Render thread only
+	FTexture2DResource* Resource;
+	int32 Width;
+	int32 Height;
+	EPixelFormat Format;
+
+	FThreadSafeCounter Presented;
+	FThreadSafeCounter Dropped;
+	FThreadSafeCounter Rejected;
+	FThreadSafeCounter LastLatencyUs;
+	FThreadSafeCounter MaxLatencyUs;
+};
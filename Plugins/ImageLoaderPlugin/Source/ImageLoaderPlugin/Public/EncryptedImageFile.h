@@ -0,0 +1,37 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+Image files encrypted with AES-256-CBC, named after the image with an extra .enc extension, e.g. frame_0001.png.enc.
+A file holds a 4 byte tag and the 16 byte IV, followed by the PKCS#7 padded ciphertext of the whole image file.
+The key is the content key of the license validated by FLicenseValidator, so encrypted sequences only load
+with a valid license.
+
+Files are decrypted in fixed-size chunks as they are read, straight into the buffer handed to the decoder,
+so the only full-size buffer is the one an unencrypted file would be read into. Decrypted frames are never
+written to the frame cache. All functions are safe to call from worker threads.
+*/
+struct IMAGELOADERPLUGIN_API FEncryptedImageFile
+{
+	static bool IsEncrypted(const FString& Path);
+
+	/** The path of the image without the .enc extension, whose extension tells the image format. */
+	static FString GetImagePath(const FString& Path);
+
+	/** Reads and decrypts an encrypted file. */
+	static bool ReadFile(const FString& Path, TArray<uint8>& OutData);
+
+	/** Decrypts an encrypted file held in memory, e.g. downloaded. */
+	static bool Decrypt(const TArray<uint8>& FileData, const FString& Path, TArray<uint8>& OutData);
+
+	/** Encrypts an image file with a random IV, to prepare a sequence for shipping. */
+	static bool EncryptFile(const FString& SourcePath, const FString& EncryptedPath, const TArray<uint8>& Key);
+
+private:
+
+	/**
+	Decrypts CipherSize bytes delivered by ReadChunk, which returns a pointer to Size bytes at Offset in the ciphertext.
+	*/
+	static bool DecryptChunks(const uint8* Iv, int64 CipherSize, TFunctionRef<const uint8*(int64 Offset, int32 Size)> ReadChunk, const FString& Path, TArray<uint8>& OutData);
+};
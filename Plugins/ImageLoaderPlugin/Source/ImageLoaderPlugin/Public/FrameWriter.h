@@ -0,0 +1,126 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tickable.h"
+#include "PixelFormat.h"
+#include "RHIResources.h"
+#include "Templates/Atomic.h"
+#include "FrameWriter.generated.h"
+
+class UTexture;
+
+
+UENUM(BlueprintType)
+enum class EFrameFileFormat : uint8
+{
+	E_PNG	UMETA(DisplayName = "PNG"),
+	/** Uncompressed 8-bit BGRA. */
+	E_DDS	UMETA(DisplayName = "DDS"),
+	/** The pixels as read back, rows tightly packed, in the pixel format of the texture. */
+	E_Raw	UMETA(DisplayName = "Raw")
+};
+
+
+/**
+Writes textures and render targets to disk without stalling the game or the render thread, e.g. the frames
+of an offline render. Each frame is copied into a staging texture on the GPU, mapped once its fence has passed,
+then encoded and written on the thread pool. Staging textures are pooled per size and format.
+
+Readbacks in flight and frames waiting for encoding are both bounded. A frame submitted while either is
+full is dropped and counted, WriteFrame never waits.
+Supports 8-bit BGRA and RGBA, and half float RGBA, which is converted to 8-bit sRGB for PNG and DDS.
+Game thread only, except where noted.
+*/
+class IMAGELOADERPLUGIN_API FFrameWriter : public FTickableGameObject
+{
+public:
+
+	/** The writer exists between Startup and Shutdown, which the module calls. */
+	static FFrameWriter& Get();
+
+	static bool IsAvailable();
+
+	static void Startup();
+	static void Shutdown();
+
+	virtual ~FFrameWriter();
+
+	/**
+	Queues the current content of a texture for writing. Rendering commands issued before the call are included.
+	@return False if the texture cannot be read back, or the frame has been dropped because the queues are full.
+	*/
+	bool WriteFrame(UTexture* Texture, const FString& FilePath, EFrameFileFormat Format);
+
+	/**
+	@param MaxReadbacks Staging textures in flight, i.e. frames the GPU may lag behind.
+	@param MaxEncodes Frames read back and waiting for, or being, encoded and written.
+	*/
+	void SetQueueLimits(int32 MaxReadbacks, int32 MaxEncodes);
+
+	/** Frames submitted but not written yet. Callable from any thread. */
+	int32 GetPendingCount() const { return PendingCount.GetValue(); }
+
+	int32 GetWrittenCount() const { return WrittenCount.GetValue(); }
+	int32 GetDroppedCount() const { return DroppedCount.GetValue(); }
+	int32 GetFailedCount() const { return FailedCount.GetValue(); }
+
+	/**
+	Waits until all submitted frames have been written. Blocks, meant for the end of a capture.
+	@return False if frames were still pending after MaxWaitSeconds.
+	*/
+	bool Flush(float MaxWaitSeconds = 30.0f);
+
+	/** FTickableGameObject implementation */
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual bool IsTickableWhenPaused() const override { return true; }
+	virtual TStatId GetStatId() const override;
+
+private:
+
+	FFrameWriter();
+
+	/** Writes the pending frames and releases the staging textures while the RHI is still alive. */
+	void ReleaseResources();
+
+	FDelegateHandle EnginePreExitHandle;
+
+	/** Render thread. Counts a frame that could not be read back. */
+	void FailReadback_RenderThread();
+
+	struct FReadback
+	{
+		FTexture2DRHIRef Staging;
+		FGPUFenceRHIRef Fence;
+		FString FilePath;
+		EFrameFileFormat Format;
+		int32 Width = 0;
+		int32 Height = 0;
+		EPixelFormat PixelFormat = PF_Unknown;
+	};
+
+	/** Render thread. Maps the readbacks whose copy has completed and hands them to the encoders. */
+	void PollReadbacks_RenderThread(FRHICommandListImmediate& RHICmdList);
+
+	/** Thread pool. */
+	static bool EncodeAndWrite(const FString& FilePath, EFrameFileFormat Format, int32 Width, int32 Height, EPixelFormat PixelFormat, const TArray<uint8>& Pixels);
+
+	static bool IsSupportedFormat(EPixelFormat PixelFormat);
+
+	// Render thread only
+	TArray<FReadback> InFlight;
+	TArray<FTexture2DRHIRef> IdleStaging;
+
+	// Read by the render thread, changed between captures
+	TAtomic<int32> MaxReadbacks { 4 };
+	TAtomic<int32> MaxEncodes { 8 };
+
+	/** Counted on submission, so the game thread can bound the readbacks in flight. */
+	FThreadSafeCounter ReadbackCount;
+	FThreadSafeCounter EncodeCount;
+	FThreadSafeCounter PendingCount;
+
+	FThreadSafeCounter WrittenCount;
+	FThreadSafeCounter DroppedCount;
+	FThreadSafeCounter FailedCount;
+};
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Queue.h"
+
+/**
+Downloads image sequences served over http(s). A sequence is described by a manifest, a text file
+listing one frame per line like a local file list, with relative entries resolved against the manifest URL.
+Frames are fetched with a bounded number of parallel requests. Waiting frames of a registered sequence go
+by their distance ahead of its playhead, read each time a request is started, so a seek reorders them for
+the next request. Other frames go in the order they are requested. Downloaded frames can be kept in a
+local disk cache, so later runs only read them from disk.
+*/
+class IMAGELOADERPLUGIN_API FHttpFrameSource
+{
+public:
+
+	typedef TSharedPtr<TArray<uint8>, ESPMode::ThreadSafe> FBytes;
+
+	static FHttpFrameSource& Get();
+
+	static bool IsUrl(const FString& Path);
+
+	/** Resolves a manifest entry against the URL of the manifest. */
+	static FString ResolveUrl(const FString& BaseUrl, const FString& Entry);
+
+	/** Requests beyond this number wait for a running one to complete. */
+	void SetMaxParallelRequests(int32 Count);
+
+	int32 GetMaxParallelRequests() const { return MaxParallelRequests; }
+
+	/** Keeps downloaded frames in Directory, or disables the disk cache if Directory is empty. The cache is never trimmed. */
+	void SetCacheDirectory(const FString& Directory);
+
+	FString GetCacheDirectory() const;
+
+	/**
+	Registers the frames of a sequence, for their downloads to be ordered by distance ahead of its playhead. Game thread only.
+	@param GetPlayhead Returns the current frame index into FrameUrls. Called on the game thread when requests start.
+	*/
+	void SetSequenceFrames(FName Sequence, const TArray<FString>& FrameUrls, TFunction<int32()> GetPlayhead);
+
+	void RemoveSequence(FName Sequence);
+
+	/**
+	Downloads a manifest and resolves its entries. Game thread only.
+	@param OnFetched Called on the game thread. The list is empty if the manifest could not be fetched.
+	*/
+	void FetchManifest(const FString& Url, TFunction<void(const TArray<FString>& FrameUrls)> OnFetched);
+
+	/**
+	Reads a frame from the disk cache, or queues its download. Callable from any thread.
+	@param OnFetched Called on a worker thread with the file bytes, or with nullptr if the download failed.
+	*/
+	void FetchFrame(const FString& Url, TFunction<void(FBytes)> OnFetched);
+
+	/**
+	Queues the downloads of frames requested on other threads, which is otherwise left to a game thread task.
+	For callers that wait for frames on the game thread. Game thread only.
+	*/
+	void QueueForwardedDownloads();
+
+	int32 GetCacheHitCount() const { return CacheHitCount.GetValue(); }
+	int32 GetDownloadCount() const { return DownloadCount.GetValue(); }
+
+private:
+
+	struct FPendingFetch
+	{
+		FString Url;
+		TFunction<void(FBytes)> OnFetched;
+
+		/** Order of the request, which breaks ties. */
+		uint32 Order = 0;
+		int32 Distance = 0;
+	};
+
+	struct FSequenceFrame
+	{
+		FName Sequence;
+		int32 Index = 0;
+	};
+
+	struct FSequence
+	{
+		int32 NumFrames = 0;
+		TFunction<int32()> GetPlayhead;
+	};
+
+	FString GetCachePath(const FString& Url) const;
+
+	/** Frames a registered frame is ahead of the playhead of its sequence, wrapping around. 0 for other frames. */
+	int32 GetPlayheadDistance(const FString& Url) const;
+
+	/** Queues a download and starts it as soon as a request slot is free. Game thread only. */
+	void QueueDownload(FPendingFetch&& Fetch);
+
+	/** Hands a download requested on another thread to the game thread. */
+	void ForwardDownload(FPendingFetch&& Fetch);
+
+	/** Starts queued downloads while fewer than MaxParallelRequests are running. Game thread only. */
+	void StartDownloads();
+
+	mutable FCriticalSection Mutex;
+	FString CacheDirectory;
+
+	TQueue<FPendingFetch, EQueueMode::Mpsc> ForwardedDownloads;
+
+	// Game thread only. Sorted by StartDownloads, the next download last.
+	TArray<FPendingFetch> PendingDownloads;
+	uint32 NextFetchOrder = 0;
+	TMap<FString, FSequenceFrame> SequenceFrames;
+	TMap<FName, FSequence> Sequences;
+	int32 RunningDownloads = 0;
+	int32 MaxParallelRequests = 6;
+
+	FThreadSafeCounter CacheHitCount;
+	FThreadSafeCounter DownloadCount;
+};
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+Box filter downscaling of 8-bit BGRA images, used to produce reduced resolution frames at decode time.
+Uses SSE2 on x86 and runs rows in parallel for large images. Safe to call from worker threads.
+*/
+struct IMAGELOADERPLUGIN_API FImageDownscale
+{
+	/**
+	Halves the image Levels times with a 2x2 box filter. Odd trailing rows and columns are dropped.
+	@return False if the image is too small to be halved that many times.
+	*/
+	static bool DownscaleBGRA8(const uint8* Src, int32 Width, int32 Height, int32 Levels, TArray<uint8>& OutPixels, int32& OutWidth, int32& OutHeight);
+
+	/** Halves the image once. OutPixels must hold (Width / 2) * (Height / 2) pixels. */
+	static void HalveBGRA8(const uint8* Src, int32 Width, int32 Height, uint8* OutPixels);
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PixelFormat.h"
+
+/**
+Persistent on-disk cache of decoded frames in their GPU-ready form (raw BGRA or block compressed).
+Entries are keyed by source path, source size and modification time, so a changed source file
+simply misses. The cache is disabled until a directory is configured, and is kept under its size cap
+by deleting the least recently used entries. All functions are safe to call from worker threads.
+*/
+class IMAGELOADERPLUGIN_API FImageFrameCache
+{
+public:
+
+	static FImageFrameCache& Get();
+
+	/**
+	Enables the cache in Directory, or disables it if Directory is empty.
+	@param MaxSizeMB Size cap of the cache directory in megabytes.
+	*/
+	void Configure(const FString& Directory, int32 MaxSizeMB);
+
+	bool IsEnabled() const;
+
+	/**
+	Reads the cached pixels of a source file.
+	@param Variant Distinguishes several cached forms of the same source, e.g. resolution tiers.
+	@param OutSourceWidth Size of the source image the pixels were made from, and OutSourceHeight.
+	@return False if there is no valid entry for the current version of the source file.
+	*/
+	bool Load(const FString& SourcePath, int32 Variant, TArray<uint8>& OutPixels, int32& OutWidth, int32& OutHeight, EPixelFormat& OutFormat,
+		int32& OutSourceWidth, int32& OutSourceHeight);
+
+	/** Writes the pixels of a source file to the cache, then trims the cache if it has grown over its cap. */
+	void Store(const FString& SourcePath, int32 Variant, const uint8* Pixels, int32 Size, int32 Width, int32 Height, EPixelFormat Format,
+		int32 SourceWidth, int32 SourceHeight);
+
+	/** Deletes the least recently used entries until the cache is below its cap. */
+	void Trim();
+
+	int32 GetHitCount() const { return HitCount.GetValue(); }
+	int32 GetMissCount() const { return MissCount.GetValue(); }
+
+private:
+
+	/** Stats the source file, call without holding the mutex. Empty if the source does not exist. */
+	static FString GetEntryPath(const FString& Directory, const FString& SourcePath, int32 Variant);
+
+	mutable FCriticalSection Mutex;
+	FString CacheDirectory;
+	int64 MaxSizeBytes = 0;
+	int64 CurrentSizeBytes = 0;
+
+	FThreadSafeCounter HitCount;
+	FThreadSafeCounter MissCount;
+};
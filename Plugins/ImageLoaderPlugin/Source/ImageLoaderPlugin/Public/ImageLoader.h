@@ -4,10 +4,43 @@
 
 #include "CoreMinimal.h"
 #include "UObject/NoExportTypes.h"
+#include "Engine/AssetUserData.h"
 #include "PixelFormat.h"
+#include "PixelFormatConversion.h"
 #include "ImageLoader.generated.h"
 
 class UTexture2D;
+class UVolumeTexture;
+
+
+/** Resolution produced by the decode stage. Every tier halves the size of the previous one. */
+UENUM(BlueprintType)
+enum class ETextureResolutionTier : uint8
+{
+	E_Full 		UMETA(DisplayName = "Full"),
+	E_Half		UMETA(DisplayName = "Half"),
+	E_Quarter	UMETA(DisplayName = "Quarter")
+};
+
+
+/**
+Size of the source image of a loaded frame. It is attached to the texture, whose own size is reduced
+at lower resolution tiers, or not when the image cannot be reduced and is loaded at full size.
+*/
+UCLASS()
+class IMAGELOADERPLUGIN_API UImageSourceUserData : public UAssetUserData
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY()
+	int32 SourceSizeX = 0;
+
+	UPROPERTY()
+	int32 SourceSizeY = 0;
+};
+
 
 /**
 Utility class for asynchronously loading an image into a texture.
@@ -24,30 +57,64 @@ public:
 	@return An image loader object with an OnLoadCompleted event that users can bind to, to get notified when loading is done.
 	*/
 	UFUNCTION(BlueprintCallable, Category = ImageLoader, meta = (HidePin = "Outer", DefaultToSelf = "Outer"))
-		static UImageLoader* LoadImageFromDiskAsync(UObject* Outer, const FString& ImagePath, int32 Id);
+		static UImageLoader* LoadImageFromDiskAsync(UObject* Outer, const FString& ImagePath, int32 Id, ETextureResolutionTier Tier = ETextureResolutionTier::E_Full);
 
 	/**
 	Loads an image file from disk into a texture on a worker thread. This will not block the calling thread.
+	An http(s) ImagePath is downloaded through FHttpFrameSource and decoded from the response bytes.
 	@return A future object which will hold the image texture once loading is done.
 	*/
-	static TFuture<UTexture2D*> LoadImageFromDiskAsync(UObject* Outer, const FString& ImagePath, TFunction<void()> CompletionCallback);
+	static TFuture<UTexture2D*> LoadImageFromDiskAsync(UObject* Outer, const FString& ImagePath, TFunction<void()> CompletionCallback, ETextureResolutionTier Tier = ETextureResolutionTier::E_Full);
 
 	/**
 	Loads an image file from disk into a texture. This will block the calling thread until completed.
+	Reduced tiers are box filtered down from the decoded image.
 	@return A texture created from the loaded image file.
 	*/
 	UFUNCTION(BlueprintCallable, Category = ImageLoader, meta = (HidePin = "Outer", DefaultToSelf = "Outer"))
-	static UTexture2D* LoadImageFromDisk(UObject* Outer, const FString& ImagePath);
+	static UTexture2D* LoadImageFromDisk(UObject* Outer, const FString& ImagePath, ETextureResolutionTier Tier = ETextureResolutionTier::E_Full);
+
+	/**
+	Decodes an image or DXT1/DXT5 dds file held in memory, e.g. a downloaded frame. Safe to call from worker threads.
+	@param ImagePath Name of the source, its extension selects the dds loader.
+	*/
+	static UTexture2D* LoadImageFromMemory(UObject* Outer, const TArray<uint8>& FileData, const FString& ImagePath, ETextureResolutionTier Tier = ETextureResolutionTier::E_Full);
 
+	/** Loads a DXT1/DXT5 dds file. Reduced tiers use the matching mip level of the file when it has one. */
 	UFUNCTION(BlueprintCallable, Category = ImageLoader, meta = (HidePin = "Outer", DefaultToSelf = "Outer"))
-	static UTexture2D* LoadDDSFromDisk(UObject* Outer, const FString& ImagePath);
+	static UTexture2D* LoadDDSFromDisk(UObject* Outer, const FString& ImagePath, ETextureResolutionTier Tier = ETextureResolutionTier::E_Full);
+
+	/**
+	Loads and decompresses an image file to 8-bit BGRA pixels without creating a texture. Safe to call from worker threads.
+	@return True if the image has been decoded.
+	*/
+	static bool LoadRawImageFromDisk(const FString& ImagePath, TArray<uint8>& OutPixels, int32& OutWidth, int32& OutHeight);
 
 
+	/**
+	Loads the base level of a DDS volume texture without creating a texture. Safe to call from worker threads.
+	DXT1, DXT5 and 8-bit BGRA volumes are kept as they are, other uncompressed layouts are converted to BGRA.
+	@return False if the file is not a volume texture in one of these formats.
+	*/
+	static bool LoadDDSVolumeFromDisk(const FString& ImagePath, TArray<uint8>& OutData, int32& OutWidth, int32& OutHeight, int32& OutDepth, EPixelFormat& OutFormat);
+
 	/** Helper function to dynamically create a new texture from raw pixel data. */
 	UFUNCTION(BlueprintCallable, Category = ImageLoader, meta = (HidePin = "Outer", DefaultToSelf = "Outer"))
 		static UTexture2D* CreateTexture(UObject* Outer, const TArray<uint8>& PixelData, int32 InSizeX, int32 InSizeY,
 			EPixelFormat PixelFormat = EPixelFormat::PF_B8G8R8A8, FName BaseName = NAME_None);
 
+	/**
+	Creates a PF_B8G8R8A8 texture from pixels in another layout, converting them directly into the texture data.
+	@param SrcPitch Bytes per source row, 0 for tightly packed rows.
+	*/
+	static UTexture2D* CreateTexture(UObject* Outer, const uint8* Src, int32 SrcPitch, ESourcePixelLayout Layout, int32 InSizeX, int32 InSizeY,
+		FName BaseName = NAME_None, bool PremultiplyAlpha = false);
+
+	/** Creates a single mip volume texture from the slices in PixelData, stored one after the other. */
+	UFUNCTION(BlueprintCallable, Category = ImageLoader, meta = (HidePin = "Outer", DefaultToSelf = "Outer"))
+		static UVolumeTexture* CreateVolumeTexture(UObject* Outer, const TArray<uint8>& PixelData, int32 InSizeX, int32 InSizeY, int32 InSizeZ,
+			EPixelFormat PixelFormat = EPixelFormat::PF_B8G8R8A8, FName BaseName = NAME_None);
+
 
 	/**
 	Declare a broadcast-style delegate type, which is used for the load completed event.
@@ -61,13 +128,36 @@ public:
 		return LoadCompleted;
 	}
 
+	/**
+	Waits at most MaxWaitSeconds for the load, and fires the load completed event right away rather than
+	in its game thread task, e.g. for a frame-locked capture that cannot let the frame pass. Game thread only.
+	@return False if the image is still loading.
+	*/
+	bool WaitForCompletion(float MaxWaitSeconds);
+
+	/** True once the image has been loaded, whether the event has fired yet or not. */
+	bool IsLoaded() const { return Future.IsValid() && Future.IsReady(); }
+
+	/** True once the load completed event has fired. */
+	bool IsCompleted() const { return Completed; }
+
 
 	UFUNCTION(BlueprintCallable, Category = ImageLoader, meta = (HidePin = "Outer", DefaultToSelf = "Outer"))
 	static bool CopyTexture(UTexture2D* SourceTexture2D, UTexture2D* DestTexture2D);
 
+	/**
+	Size of the image a texture has been loaded from, before any resolution tier was applied.
+	@return False if the texture has not been loaded by this class.
+	*/
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = ImageLoader)
+	static bool GetSourceSize(UTexture2D* Texture, int32& OutSizeX, int32& OutSizeY);
+
 private:
 	/** Helper function that initiates the loading operation and fires the event when loading is done. */
-	void LoadImageAsync(UObject* Outer, const FString& ImagePath, int32 Id);
+	void LoadImageAsync(UObject* Outer, const FString& ImagePath, int32 Id, ETextureResolutionTier Tier);
+
+	/** Fires the load completed event, once. */
+	void BroadcastCompleted();
 	
 	/**
 	Holds the load completed event delegate.
@@ -78,4 +168,7 @@ private:
 
 	/** Holds the future value which represents the asynchronous loading operation. */
 	TFuture<UTexture2D*> Future;
+
+	int32 LoadId = 0;
+	bool Completed = false;
 };
\ No newline at end of file
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "ImageLoaderBenchmarkCommandlet.generated.h"
+
+
+/**
+Measures the throughput of the loading stages of UImageLoader on a generated corpus, headless:
+
+	UE4Editor-Cmd.exe <Project> -run=ImageLoaderBenchmark -nullrhi [-Formats=png,jpg,dds] [-Sizes=1024x1024,3840x2160]
+		[-Threads=1,4,8] [-Frames=16] [-Iterations=4] [-Corpus=<Dir>] [-Output=<File.json>] [-Regenerate]
+
+Each format, size and thread count loads the frames of the corpus Iterations times, from as many threads.
+The results go to a JSON file, with MB/s of input, frames/s and latency percentiles per run, along with
+the build and the machine, so runs can be compared across both. Files are read from a warm file cache
+and the frame cache is disabled, so the figures are those of decoding and texture creation.
+*/
+UCLASS()
+class UImageLoaderBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	UImageLoaderBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
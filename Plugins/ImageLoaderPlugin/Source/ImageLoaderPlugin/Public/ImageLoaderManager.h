@@ -3,10 +3,67 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "TextureBuffer.h"
+#include "FrameWriter.h"
 #include "ImageLoaderManager.generated.h"
 
 class UTexture2D;
-class UTextureBuffer;
+class UImageLoader;
+class UTileDeltaBuffer;
+class UVolumeFlipbook;
+
+
+/** A sequence to load in the background before it is first played, e.g. listed in the game config. */
+USTRUCT(BlueprintType)
+struct FImageSequenceWarmUp
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Image Loader")
+	FString Path;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Image Loader")
+	bool PingPong = true;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Image Loader")
+	float FrameIntervalInSec = 0.033f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Image Loader")
+	int32 MaxImages = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Image Loader")
+	int32 TemporalResolution = 1;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Image Loader")
+	EImageSequenceLoadPriority Priority = EImageSequenceLoadPriority::E_Low;
+};
+
+
+
+/** A frame waiting in a load queue. Entries of an older load generation than their buffer are dropped. */
+struct FImageLoadRequest
+{
+	UTextureBuffer* TexBuffer = nullptr;
+	int32 Index = 0;
+	int32 Generation = 0;
+};
+
+
+/** A frame being loaded. Keeps its loader alive until the load completed event has fired. */
+USTRUCT()
+struct FActiveImageLoad
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	UImageLoader* Loader = nullptr;
+
+	UPROPERTY()
+	UTextureBuffer* TexBuffer = nullptr;
+
+	int32 Index = 0;
+};
+
 
 
 UCLASS(Blueprintable, BlueprintType)
@@ -25,12 +82,58 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Image Loader")
 	static void Release();
 
+	/**
+	Returns the buffer of the sequence at Path, creating and enqueuing it if it is not loaded yet.
+	A sequence that is still loading is promoted if it is requested at a higher priority.
+	Path may also be the http(s) URL of a frame manifest, see FHttpFrameSource.
+	@param LowestTier Coarsest tier the memory budget may reduce the sequence to, applied before the first load.
+	*/
 	UFUNCTION(BlueprintCallable, Category = "Image Loader")
-    static UTextureBuffer* LoadImageSequence(UObject* Outer, const FString& Path, bool PingPong = true, float FrameIntervalInSec = 0.033f, int32 MaxImagesCount = 0, int32 TemporalResolution = 1);
+    static UTextureBuffer* LoadImageSequence(UObject* Outer, const FString& Path, bool PingPong = true, float FrameIntervalInSec = 0.033f, int32 MaxImagesCount = 0, int32 TemporalResolution = 1, EImageSequenceLoadPriority Priority = EImageSequenceLoadPriority::E_Normal,
+		ETextureResolutionTier LowestTier = ETextureResolutionTier::E_Quarter);
 	
+	/**
+	Loads a sequence as a key frame plus per-frame tile deltas, played back into a single persistent texture.
+	Suited to mostly static sequences. Ping-pong playback is not supported.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "Image Loader")
+	static UTileDeltaBuffer* LoadTileDeltaSequence(UObject* Outer, const FString& Path, float FrameIntervalInSec = 0.033f, int32 MaxImagesCount = 0, int32 TemporalResolution = 1, int32 TileSize = 64);
+
+	/**
+	Loads a short loop as the slices of one volume texture, played back by the material without per-frame updates.
+	@param Path A .dds volume texture, or a file list or directory whose frames are packed into a volume.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "Image Loader")
+	static UVolumeFlipbook* LoadVolumeFlipbook(UObject* Outer, const FString& Path, float FrameIntervalInSec = 0.033f, int32 MaxImagesCount = 64, int32 TemporalResolution = 1, ETextureResolutionTier Tier = ETextureResolutionTier::E_Full);
+
 	UFUNCTION(BlueprintCallable, Category = "Image Loader")
 	static bool UnloadImageSequence(const FString& Path);
 
+	/** Starts loading the sequences in the background, so that they are resident when first played. */
+	UFUNCTION(BlueprintCallable, Category = "Image Loader")
+	static void StartWarmUp(const TArray<FImageSequenceWarmUp>& Sequences);
+
+	/** Starts the warm-up of the WarmUpSequences entries in the given section of the game config. */
+	static void StartConfiguredWarmUp(const TCHAR* ConfigSection);
+
+	/** Loaded fraction of all frames of the warm-up sequences, 1 if there are none. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Image Loader")
+	static float GetWarmUpProgress();
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Image Loader")
+	static bool IsWarmUpComplete();
+
+	/** Sets the rate of the shared clock of a player group. */
+	UFUNCTION(BlueprintCallable, Category = "Image Loader")
+	static void SetPlaybackGroupRate(FName Group, float Rate);
+
+	/** Moves all players of a group to the given time. */
+	UFUNCTION(BlueprintCallable, Category = "Image Loader")
+	static void SeekPlaybackGroup(FName Group, float Seconds);
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Image Loader")
+	static float GetPlaybackGroupTime(FName Group);
+
 	UFUNCTION(BlueprintCallable, Category = "Image Loader")
 	static UTexture2D* GetTexture(const FName& Path);
 
@@ -40,6 +143,22 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Image Loader")
 	static bool LoadTextureBufferImages(UTextureBuffer* TexBuffer);
 
+	/** Enqueues every frame of a loaded buffer again, starting at the playhead, to replace them at its loading tier. */
+	static bool ReloadTextureBufferImages(UTextureBuffer* TexBuffer);
+
+	/** Moves the pending frames of a buffer to the background queue while none of its players is on screen, and back. */
+	static void SetTextureBufferOnScreen(UTextureBuffer* TexBuffer, bool OnScreen);
+
+	/** Sets the finest tier worth loading for the screen area of a buffer, and reloads it if needed. */
+	static void SetTextureBufferScreenTier(UTextureBuffer* TexBuffer, ETextureResolutionTier Tier);
+
+	/**
+	Waits at most MaxWaitSeconds for the load of a frame, or for the oldest load while the frame is still queued,
+	and completes all finished loads right away rather than in their game thread tasks. Game thread only.
+	@return True if a load has completed.
+	*/
+	static bool CompleteImageLoads(UTextureBuffer* TexBuffer, int32 Index, float MaxWaitSeconds);
+
 	UFUNCTION(BlueprintCallable, Category = "Image Loader")
 	static bool StartImageLoading();
 	static bool LoadImageFromQueue();
@@ -47,10 +166,82 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Image Loader")
 	bool IsLoading() const;
 
+	/**
+	Sets the memory budget for loaded sequences and rebalances their resolution tiers.
+	@param BudgetMB Budget in megabytes, 0 for no fixed budget.
+	@param MinFreePhysicalMB Sequences are also reduced while less physical memory than this is available.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "Image Loader")
+	static void SetTextureMemoryBudget(int32 BudgetMB, int32 MinFreePhysicalMB = 512);
+
+	/**
+	Enables the persistent cache of decoded frames. Later loads of an unchanged file skip decoding.
+	@param Directory Cache directory. Relative paths are resolved against the project Saved directory.
+	@param MaxSizeMB Size cap, the least recently used frames are deleted beyond it.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "Image Loader")
+	static void EnableFrameCache(const FString& Directory, int32 MaxSizeMB = 4096);
+
+	UFUNCTION(BlueprintCallable, Category = "Image Loader")
+	static void DisableFrameCache();
+
+	/**
+	Keeps the frames of http sequences in a local directory, so they are downloaded only once.
+	@param Directory Relative paths are resolved against the project Saved directory. Empty disables the cache.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "Image Loader")
+	static void EnableHttpCache(const FString& Directory);
+
+	/** Frames of http sequences beyond this many wait for a running download to complete. */
+	UFUNCTION(BlueprintCallable, Category = "Image Loader")
+	static void SetMaxParallelHttpRequests(int32 Count);
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Image Loader")
+	static void GetFrameCacheStats(int32& Hits, int32& Misses);
+
+	/**
+	Writes the current content of a texture or render target to disk, without waiting for the GPU or the encoder.
+	@return False if the frame has been dropped because the writer is behind, or the texture cannot be written.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "Image Loader")
+	static bool WriteFrame(UTexture* Texture, const FString& FilePath, EFrameFileFormat Format = EFrameFileFormat::E_PNG);
+
+	/** Waits until all frames passed to WriteFrame are on disk, e.g. at the end of a capture. */
+	UFUNCTION(BlueprintCallable, Category = "Image Loader")
+	static bool FlushFrameWriter(float MaxWaitSeconds = 30.0f);
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Image Loader")
+	static void GetFrameWriterStats(int32& Written, int32& Pending, int32& Dropped, int32& Failed);
+
+	/** Memory held by all loaded sequences, in megabytes. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Image Loader")
+	static int32 GetTextureMemoryUsageMB();
+
+	/**
+	Lowers the resolution tier of the largest sequences while over budget, and raises them back
+	when there is room for the full size again. Each sequence stays within its LowestResolutionTier.
+	Does nothing during a frame-locked capture, whose tiers stay as they are.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "Image Loader")
+	static void BalanceMemoryBudget();
+
 
 	UPROPERTY(Category = MapsAndSets, BlueprintReadWrite)
 	TMap<FName, UTextureBuffer*>		ImgTextureBufferMap;
 
+	UPROPERTY(Category = MapsAndSets, BlueprintReadWrite)
+	TMap<FName, UTileDeltaBuffer*>		TileDeltaBufferMap;
+
+	UPROPERTY(Category = MapsAndSets, BlueprintReadWrite)
+	TMap<FName, UVolumeFlipbook*>		VolumeFlipbookMap;
+
+	UPROPERTY()
+	TArray<UTextureBuffer*>				WarmUpBuffers;
+
+	/** In the order they were started. */
+	UPROPERTY()
+	TArray<FActiveImageLoad>			ActiveImageLoads;
+
 	UFUNCTION()
 	void OnImageLoadCompleted(UTexture2D* Texture, int32 Idx);
 
@@ -62,13 +253,35 @@ public:
 
 
 private:
+	/** Reads the file list or directory at Path and applies the ping-pong, count and temporal resolution reductions. */
+	static bool BuildFileList(const FString& Path, bool PingPong, int32 MaxImagesCount, int32 TemporalResolution, TArray<FString>& FileList);
+
+	/** Applies the ping-pong, count and temporal resolution reductions to a file list. */
+	static void ReduceFileList(bool PingPong, int32 MaxImagesCount, int32 TemporalResolution, TArray<FString>& FileList);
+
+	/** Bytes over the memory budget or below the minimum free physical memory. Negative when there is headroom. */
+	static int64 GetMemoryOverrun();
+
+	/** Enqueues all frames of a buffer from StartIndex on, in the queues matching its priority and visibility. */
+	static void EnqueueTextureBufferImages(UTextureBuffer* TexBuffer, int32 StartIndex, int32 Generation);
+
+	/** Raises the priority of a buffer and requeues its pending frames accordingly. Lower priorities are ignored. */
+	static void PromoteTextureBuffer(UTextureBuffer* TexBuffer, EImageSequenceLoadPriority Priority);
+
+	/** Enqueues the frames of a loading buffer again, from its playhead on, under a new generation. */
+	static void RequeuePendingImages(UTextureBuffer* TexBuffer);
+
 	static UImageLoaderManager*					LoaderMngr;
 			
-	TQueue<TPair<UTextureBuffer*, int32>>		ImageLoadingPriorityQueue;
-	TQueue<TPair<UTextureBuffer*, int32>>		ImageLoadingQueue;
+	TQueue<FImageLoadRequest>					ImageLoadingPriorityQueue;
+	TQueue<FImageLoadRequest>					ImageLoadingQueue;
+	/** Frames of sequences that are low priority or off screen, served when the other queues are empty. */
+	TQueue<FImageLoadRequest>					ImageLoadingBackgroundQueue;
 	int32										ImageLoadingQueueSize = 0;
 	int32										ImagePreLoadingQueueSize = 0;
 	int32										MaxNumberOfImagesLoadingParallel = 8;
+	int32										TextureMemoryBudgetMB = 0;
+	int32										MinFreePhysicalMemoryMB = 512;
 
 	bool										IsInitialized = false;
 
@@ -12,4 +12,15 @@ public:
 	/** IModuleInterface implementation */
 	virtual void StartupModule() override;
 	virtual void ShutdownModule() override;
+
+private:
+
+	/** Starts the warm-up of the sequences listed in the game config, once the engine is up. */
+	void StartConfiguredWarmUp();
+
+	/** Rebalances the memory budget periodically, since memory also runs short while no sequence loads. */
+	bool TickMemoryBudget(float DeltaTime);
+
+	FDelegateHandle PostEngineInitHandle;
+	FDelegateHandle MemoryBudgetTickerHandle;
 };
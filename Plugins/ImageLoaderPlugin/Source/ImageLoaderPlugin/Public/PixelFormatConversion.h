@@ -0,0 +1,40 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** Memory layout of the pixels of a decoded or produced image, before it is converted to 8-bit BGRA. */
+enum class ESourcePixelLayout : uint8
+{
+	BGRA8,
+	RGBA8,
+	RGB8,
+	BGR8,
+	Gray8,
+	/** 16 bits per channel in native byte order, as returned by ImageWrapper. */
+	RGBA16,
+	BGRA16,
+	Gray16
+};
+
+
+/**
+Conversion of the common source layouts to the 8-bit BGRA layout of PF_B8G8R8A8 textures.
+Uses SSE2 on x86, AVX2 where the module is compiled for it, and plain C++ elsewhere.
+Rows of large images are converted in parallel. Safe to call from worker threads.
+*/
+struct IMAGELOADERPLUGIN_API FPixelFormatConversion
+{
+	static int32 GetBytesPerPixel(ESourcePixelLayout Layout);
+
+	/**
+	Converts an image to 8-bit BGRA. 16-bit channels are rounded to the nearest 8-bit value, gray is replicated
+	to all color channels with opaque alpha.
+	@param SrcPitch Bytes per source row, 0 for tightly packed rows.
+	@param DstPitch Bytes per destination row, 0 for Width * 4.
+	@param PremultiplyAlpha Also multiplies the color channels by alpha, in the same pass.
+	*/
+	static void ConvertToBGRA8(const uint8* Src, int32 SrcPitch, ESourcePixelLayout Layout, int32 Width, int32 Height, uint8* Dst, int32 DstPitch = 0, bool PremultiplyAlpha = false);
+
+	/** Multiplies the color channels of 8-bit BGRA pixels by their alpha, in place. */
+	static void PremultiplyAlphaBGRA8(uint8* Pixels, int32 NumPixels);
+};
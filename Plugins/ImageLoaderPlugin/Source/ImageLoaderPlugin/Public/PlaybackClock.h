@@ -0,0 +1,44 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+Playback clock for image sequences.
+Accumulates scaled elapsed time and maps it directly to a frame index, so that playback speed
+does not depend on the game frame rate. Frames that fall between two updates are simply skipped.
+*/
+struct IMAGELOADERPLUGIN_API FPlaybackClock
+{
+	/** Current playback time in seconds. May be negative when playing backwards from the start. */
+	double Time = 0.0;
+
+	/** Playback rate multiplier. 1 is normal speed, 2 is double speed, negative values play backwards. */
+	float Rate = 1.0f;
+
+	/** Advances the clock by DeltaTime seconds scaled by Rate. */
+	void Advance(float DeltaTime)
+	{
+		Time += static_cast<double>(DeltaTime) * Rate;
+	}
+
+	/** Moves the clock to an absolute playback time. */
+	void Seek(double InTime)
+	{
+		Time = InTime;
+	}
+
+	/** Number of whole frame intervals elapsed at the current time. */
+	int64 GetFrameCount(float FrameInterval) const;
+
+	/** Elapsed time inside the current frame interval, in [0, FrameInterval). */
+	float GetTimeInFrame(float FrameInterval) const;
+
+	/**
+	Maps a playback time to a frame index.
+	@param OutReverse Set to true while a ping-pong sequence is on its way back.
+	*/
+	static int32 FrameAtTime(double InTime, float FrameInterval, int32 NumFrames, bool PingPong, bool& OutReverse);
+
+	/** Returns the playback time at which the given frame starts. Inverse of FrameAtTime. */
+	static double TimeAtFrame(int32 Frame, float FrameInterval, int32 NumFrames, bool PingPong, bool Reverse);
+};
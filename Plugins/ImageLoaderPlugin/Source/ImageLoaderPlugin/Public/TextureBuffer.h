@@ -1,6 +1,8 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "PlaybackClock.h"
+#include "ImageLoader.h"
 #include "TextureBuffer.generated.h"
 
 
@@ -13,6 +15,16 @@ enum class ETextureBufferStatus : uint8
 	E_Loaded	UMETA(DisplayName = "Loaded")
 };
 
+
+/** Order in which the loader serves the frames of a sequence relative to other sequences. */
+UENUM(BlueprintType)
+enum class EImageSequenceLoadPriority : uint8
+{
+	E_Low 		UMETA(DisplayName = "Low"),
+	E_Normal	UMETA(DisplayName = "Normal"),
+	E_High		UMETA(DisplayName = "High")
+};
+
 class UTexture2D;
 
 
@@ -35,12 +47,38 @@ public:
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = TextureBuffer)
 	float GetTimeSinceLastUpdate();
 
+	/**
+	Advances the playback clock and jumps straight to the frame that matches the elapsed time.
+	Frames in between are skipped when DeltaTime spans more than one frame interval.
+	@return True if the current frame index has changed.
+	*/
 	UFUNCTION(BlueprintCallable, Category = TextureBuffer)
-	void Update(float DeltaTime);
+	bool Update(float DeltaTime);
+
+	/** Moves the playback clock to the given time and selects the matching frame. */
+	UFUNCTION(BlueprintCallable, Category = TextureBuffer)
+	void SeekToTime(float Seconds);
+
+	/**
+	Follows an external clock, e.g. the shared clock of a playback group.
+	@return True if the current frame index has changed.
+	*/
+	bool SyncToTime(double Time);
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = TextureBuffer)
+	float GetPlaybackTime() const;
+
+	/** Number of frames skipped by Update since the sequence has been loaded. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = TextureBuffer)
+	int32 GetSkippedFrameCount() const;
 
 	UFUNCTION(BlueprintCallable, Category = TextureBuffer)
 	UTexture2D* GetTexture();
 
+	/** True if the frame has been loaded, e.g. while the rest of the sequence is still loading. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = TextureBuffer)
+	bool IsFrameResident(int32 Index) const;
+
 	UFUNCTION(BlueprintCallable, Category = TextureBuffer)
 	UTexture2D* GetPrevTexture();
 
@@ -72,12 +110,76 @@ public:
 	UFUNCTION(BlueprintCallable, Category = TextureBuffer)
 	void ReleaseBuffer();
 
+	/**
+	Reloads the frames at another resolution tier, clamped between HighestResolutionTier and LowestResolutionTier.
+	The resident frames keep playing and are replaced one by one as the new ones arrive.
+	@return True if a reload has been started or queued.
+	*/
+	UFUNCTION(BlueprintCallable, Category = TextureBuffer)
+	bool RequestResolutionTier(ETextureResolutionTier Tier);
+
+	/** Tier the frames are currently being loaded at. Equals ResolutionTier unless a tier change is in progress. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = TextureBuffer)
+	ETextureResolutionTier GetLoadingTier() const;
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = TextureBuffer)
+	bool IsChangingResolutionTier() const;
+
+	/** Memory held by the resident frames, in kilobytes. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = TextureBuffer)
+	int32 GetResidentSizeKb() const;
+
+	/** Fraction of the frames loaded so far, in [0, 1]. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = TextureBuffer)
+	float GetLoadProgress() const;
+
+	/** Starts a new load pass over all frames. Queue entries of earlier passes are ignored from now on. */
+	int32 BeginLoadGeneration();
+
+	/** Marks a queued frame as dispatched. Returns false for stale entries and frames already dispatched in this pass. */
+	bool TryDispatchFrame(int32 Index, int32 Generation);
+
+	/** Invalidates the queue entries of the current pass, without forgetting which frames have been dispatched. */
+	int32 RequeueLoadGeneration();
+
+	int32 GetLoadGeneration() const { return LoadGeneration; }
+
+	UPROPERTY(BlueprintReadWrite)
+	EImageSequenceLoadPriority LoadPriority = EImageSequenceLoadPriority::E_Normal;
+
+	/** False while none of the players of the sequence is rendered. Its frames are then loaded in the background only. */
+	UPROPERTY(BlueprintReadOnly)
+	bool OnScreen = true;
+
+	/** Tier of the resident frames. */
+	UPROPERTY(BlueprintReadOnly)
+	ETextureResolutionTier ResolutionTier = ETextureResolutionTier::E_Full;
+
+	/** Lowest tier the sequence may drop to under memory pressure. E_Full keeps it at full resolution. */
+	UPROPERTY(BlueprintReadWrite)
+	ETextureResolutionTier LowestResolutionTier = ETextureResolutionTier::E_Quarter;
+
+	/** Finest tier worth loading for the screen area the sequence covers. Takes precedence over LowestResolutionTier. */
+	UPROPERTY(BlueprintReadOnly)
+	ETextureResolutionTier HighestResolutionTier = ETextureResolutionTier::E_Full;
+
+	/** Width of the source images, whatever tier the frames are loaded at. 0 until a frame has been loaded. */
+	UPROPERTY(BlueprintReadOnly)
+	int32 SourceWidth = 0;
+
+	/** Time of the last screen size driven tier change, in platform seconds. */
+	double ScreenTierChangeTime = 0.0;
+
 	UPROPERTY(BlueprintReadWrite)
 	float FrameIntervalInSec = 0.0333f;
 
 	UPROPERTY(BlueprintReadWrite)
 	bool PingPong = false;
 
+	/** Playback speed multiplier. Negative values play the sequence backwards. */
+	UPROPERTY(BlueprintReadWrite)
+	float PlaybackRate = 1.0f;
+
 	UPROPERTY(BlueprintReadOnly)
 	TArray<FString> FileList;
 
@@ -115,12 +217,34 @@ public:
 
 private:
 
+	/** Selects the frame that matches the current clock time. Returns true if the index has changed. */
+	bool SyncIndexToClock();
+
+	/** Moves the clock to the start of the current frame, after the index has been set directly. */
+	void SyncClockToIndex();
+
+	void OnTierReloadCompleted(UTexture2D* Texture, int32 Id);
+
+	/** Keeps SourceWidth from the size attached to the loaded frames. */
+	void UpdateSourceWidth(UTexture2D* Texture);
+
 	int32 UpdateIndex = 0;
 
-	double LastUpdateTime = 0.0;
-	double TimeAccum = 0.0;
+	ETextureResolutionTier LoadingTier = ETextureResolutionTier::E_Full;
+	ETextureResolutionTier RequestedTier = ETextureResolutionTier::E_Full;
+	int32 TierReloadCount = 0;
+	bool ReloadingTier = false;
+
+	int32 LoadGeneration = 0;
+	TBitArray<> DispatchedFrames;
+
+	FPlaybackClock Clock;
+	int32 SkippedFrames = 0;
 	bool Reverse = false;
 
+	/** Set when the clock has been moved before the sequence has loaded, which then keeps its position. */
+	bool PlayedWhileLoading = false;
+
     UPROPERTY(BlueprintAssignable, Category = ImageLoader, meta = (AllowPrivateAccess = true))
     FOnImageSequenceLoadCompleted ImageSequenceLoadCompleted;
 
@@ -4,13 +4,23 @@
 
 #include "CoreMinimal.h"
 #include "Components/ActorComponent.h"
+#include "ImageLoader.h"
+#include "TextureBuffer.h"
 #include "TextureBufferPlayer.generated.h"
 
 class UTextureBuffer;
+class UTileDeltaBuffer;
 class UTexture2D;
 class UMaterialInstanceDynamic;
 class UMaterialInterface;
-
+class UMeshComponent;
+class FTextureBufferPlayerTicker;
+
+/**
+Plays an image sequence on the material of its owner. Playing components are advanced by
+FTextureBufferPlayerTicker in one batched pass per frame. The component tick only runs for
+Blueprint subclasses that implement Event Tick, and playback does not depend on it.
+*/
 UCLASS(Blueprintable, BlueprintType, ClassGroup = (ImageLoader), meta = (BlueprintSpawnableComponent))
 class IMAGELOADERPLUGIN_API UTextureBufferPlayer : public UActorComponent
 {
@@ -26,8 +36,6 @@ protected:
 	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 public:	
-	
-	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
 
 	UFUNCTION(BlueprintCallable, Category = TextureBufferPlayer)
 	bool LoadImageSequenceFromDisk();
@@ -53,6 +61,20 @@ public:
 	UFUNCTION(BlueprintCallable, Category = TextureBufferPlayer)
 	void PauseResume();
 
+	UFUNCTION(BlueprintCallable, Category = TextureBufferPlayer)
+	void SeekToTime(float Seconds);
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = TextureBufferPlayer)
+	bool GetIsPlaying() const { return IsPlaying; }
+
+	/** True if the mesh showing the sequence has been rendered within VisibilityGracePeriod. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = TextureBufferPlayer)
+	bool IsOnScreen() const { return OnScreen; }
+
+	/** Estimated width of the mesh bounds as a fraction of the view width, in [0, 1]. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = TextureBufferPlayer)
+	float GetScreenSize() const { return ScreenSize; }
+
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = TextureBufferPlayer)
 	FString FileListPath;
@@ -69,12 +91,53 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = TextureBufferPlayer)
 	float FrameIntervalInSeconds = 0.0666f;
 
+	/** Playback speed multiplier applied to the sequence clock. Negative values play backwards. Unused in a playback group. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = TextureBufferPlayer)
+	float PlaybackRate = 1.0f;
+
+	/**
+	Players of the same group follow one shared clock and stay in lockstep, e.g. the screens of a video wall.
+	Play and SeekToTime move the whole group. None plays on the clock of the sequence buffer.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = TextureBufferPlayer)
+	FName PlaybackGroup = NAME_None;
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = TextureBufferPlayer)
 	int32 TemporalResolution = 2;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = TextureBufferPlayer)
 	int32 MaxImages = 0;
 
+	/** Lowest resolution tier the sequence may drop to when memory runs short. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = TextureBufferPlayer)
+	ETextureResolutionTier LowestResolutionTier = ETextureResolutionTier::E_Quarter;
+
+	/**
+	Loading priority of the sequence. A sequence already warming up in the background is promoted to it.
+	Normal loads the first frame ahead and the others in request order, as players always did.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = TextureBufferPlayer)
+	EImageSequenceLoadPriority LoadPriority = EImageSequenceLoadPriority::E_Normal;
+
+	/** Plays the sequence as tile deltas into a single texture. Meant for mostly static content, ignores PingPong. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = TextureBufferPlayer)
+	bool UseTileDeltas = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = TextureBufferPlayer, meta = (EditCondition = "UseTileDeltas"))
+	int32 TileSize = 64;
+
+	/** Stops advancing the sequence while the mesh is not rendered, and moves its loading to the background. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = TextureBufferPlayer)
+	bool PauseWhenNotRendered = true;
+
+	/** Loads the sequence at a reduced resolution tier while it covers only a small part of the screen. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = TextureBufferPlayer)
+	bool UseScreenSizeLOD = true;
+
+	/** Time in seconds since the last render after which the mesh counts as not rendered. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = TextureBufferPlayer, meta = (EditCondition = "PauseWhenNotRendered"))
+	float VisibilityGracePeriod = 0.5f;
+
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Material Settings")
 	UMaterialInterface* TemplateMaterial = nullptr;
@@ -103,12 +166,34 @@ public:
 	UPROPERTY(BlueprintReadWrite, Category = "Material Settings")
 	UTextureBuffer* TextureBuffer = nullptr;
 
+	UPROPERTY(BlueprintReadWrite, Category = "Material Settings")
+	UTileDeltaBuffer* TileDeltaBuffer = nullptr;
+
+	/** Mesh of the owner that shows the sequence, used for the visibility and screen size estimates. */
+	UPROPERTY(BlueprintReadWrite, Category = "Material Settings")
+	UMeshComponent* TargetMesh = nullptr;
+
 private:
 
+	friend class FTextureBufferPlayerTicker;
+
 	bool SetupMaterial();
 	bool UpdateMaterial();
 	bool UpdateTextures();
 
+	/** Starts or stops the per-frame updates by the batched ticker. */
+	void SetIsPlaying(bool Playing);
+
+	/** Samples OnScreen and ScreenSize from the mesh and the view of the first local player. */
+	void UpdateVisibility();
+
 	bool						IsPlaying = false;
+	bool						OnScreen = true;
+	float						ScreenSize = 1.0f;
+
+	// Last values set on MainMaterial, parameters are only set again when they change
+	UTexture2D*					MaterialMainTexture = nullptr;
+	UTexture2D*					MaterialPrevTexture = nullptr;
+	float						MaterialLerpAlpha = -1.0f;
 
 };
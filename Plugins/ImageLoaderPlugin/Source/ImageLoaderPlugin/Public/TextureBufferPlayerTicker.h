@@ -0,0 +1,101 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tickable.h"
+#include "PlaybackClock.h"
+
+class UTextureBufferPlayer;
+
+/**
+Advances all playing UTextureBufferPlayer components in one pass per frame, instead of one component tick each.
+Every shared buffer is advanced once, then the players refresh their materials from it.
+Paused and idle players are not registered, so they cost nothing per frame.
+Players with a PlaybackGroup follow the shared clock of their group instead of advancing their buffer,
+so all members of a group show the frame for the same time.
+The visibility of all players with a sequence is sampled a few times per second. Players that are not
+rendered are skipped, and the loading of sequences nobody sees moves to the background. Sequences that
+cover a small screen area are switched to a matching resolution tier. Game thread only.
+*/
+class IMAGELOADERPLUGIN_API FTextureBufferPlayerTicker : public FTickableGameObject
+{
+public:
+
+	/** The ticker exists between Startup and Shutdown, which the module calls. */
+	static FTextureBufferPlayerTicker& Get();
+
+	static bool IsAvailable();
+
+	static void Startup();
+	static void Shutdown();
+
+	/** Adds a player to the per-frame pass. Adding a player twice has no effect. */
+	void AddPlayer(UTextureBufferPlayer* Player);
+
+	void RemovePlayer(UTextureBufferPlayer* Player);
+
+	int32 GetNumPlayers() const { return Players.Num(); }
+
+	/** Adds a player with a sequence to the visibility sampling, whether it plays or not. */
+	void AddWatchedPlayer(UTextureBufferPlayer* Player);
+
+	void RemoveWatchedPlayer(UTextureBufferPlayer* Player);
+
+	/** Playback rate of the group clock. Replaces the PlaybackRate of the members. */
+	void SetGroupPlaybackRate(FName Group, float Rate);
+
+	/** Moves the group clock, members follow on the next tick. */
+	void SeekGroup(FName Group, float Seconds);
+
+	float GetGroupTime(FName Group) const;
+
+	/**
+	Frame-locked capture for offline renders with a fixed time step. Sequences start playing as soon as their
+	first frame is resident, and each tick waits until the exact frame of every loading sequence is resident
+	before the engine renders, while the loader keeps all its parallel loads running. Players are advanced
+	whether they are rendered or not, and resolution tiers are left as they are, neither following the screen
+	size nor the memory budget, so the output does not depend on visibility.
+	@param MaxStallSeconds A frame that has not arrived after this time is given up on, and the tick carries on.
+	*/
+	void SetFrameLocked(bool Locked, float MaxStallSeconds = 30.0f);
+
+	bool IsFrameLocked() const { return FrameLocked; }
+
+	/** Time the last tick waited for frames, in seconds. */
+	float GetLastStallTime() const { return LastStallTime; }
+
+	/** Total wait, number of ticks that waited, and number of ticks since frame lock was enabled. */
+	void GetStallStats(float& OutTotalStallTime, int32& OutStalledTicks, int32& OutLockedTicks) const;
+
+	/** FTickableGameObject implementation */
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+
+private:
+
+	/** Samples the visibility and screen size of the watched players and forwards visibility and screen tiers to the loader. */
+	void UpdateVisibility();
+
+	/** Completes the loads of the current frames of all loading sequences, waiting on each until it is resident. */
+	void WaitForResidentFrames();
+
+	struct FPlaybackGroup
+	{
+		FPlaybackClock Clock;
+		uint64 LastAdvancedFrame = 0;
+	};
+
+	TArray<TWeakObjectPtr<UTextureBufferPlayer>> Players;
+	TArray<TWeakObjectPtr<UTextureBufferPlayer>> WatchedPlayers;
+	float TimeSinceVisibilityUpdate = 0.0f;
+
+	/** Groups are kept when all their members pause, so that the group time carries on from where it stopped. */
+	TMap<FName, FPlaybackGroup> Groups;
+
+	bool FrameLocked = false;
+	float MaxStallTime = 30.0f;
+	float LastStallTime = 0.0f;
+	float TotalStallTime = 0.0f;
+	int32 StalledTicks = 0;
+	int32 LockedTicks = 0;
+};
@@ -0,0 +1,155 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RHI.h"
+#include "RenderingThread.h"
+#include "PlaybackClock.h"
+#include "TextureBuffer.h"
+#include "TileDeltaBuffer.generated.h"
+
+class UTexture2D;
+class UDynamicTexture;
+
+
+/**
+Tiles of one frame which differ from the previous frame.
+Every region reads its pixels from TileData. For delta frames the changed tiles are stacked vertically,
+TileSize pixels wide. The key frame keeps the full image and its regions address it in place.
+*/
+struct FTileDeltaFrame
+{
+	TArray<FUpdateTextureRegion2D> Regions;
+	TArray<int32> TileIndices;
+	TArray<uint8> TileData;
+	uint32 SrcPitch = 0;
+};
+
+
+/**
+Image sequence stored as one key frame plus the changed tiles of every following frame.
+Playback applies only the changed tiles to a single persistent texture, so upload bandwidth and
+memory scale with the amount of motion instead of the resolution. Only forward looping is supported.
+*/
+UCLASS(Blueprintable, BlueprintType, ClassGroup = (ImageLoader))
+class IMAGELOADERPLUGIN_API UTileDeltaBuffer : public UObject
+{
+	GENERATED_BODY()
+
+public:
+
+	UTileDeltaBuffer(const FObjectInitializer& ObjectInitializer);
+
+	virtual void BeginDestroy() override;
+	virtual bool IsReadyForFinishDestroy() override;
+
+	UFUNCTION(BlueprintCallable, Category = TileDeltaBuffer)
+	bool IsLoading() const;
+
+	UFUNCTION(BlueprintCallable, Category = TileDeltaBuffer)
+	bool IsFinished() const;
+
+	/**
+	Advances the playback clock and applies the tiles needed to reach the matching frame.
+	@return True if the texture content has changed.
+	*/
+	UFUNCTION(BlueprintCallable, Category = TileDeltaBuffer)
+	bool Update(float DeltaTime);
+
+	UFUNCTION(BlueprintCallable, Category = TileDeltaBuffer)
+	void SeekToTime(float Seconds);
+
+	/**
+	Follows an external clock, e.g. the shared clock of a playback group.
+	@return True if the texture content has changed.
+	*/
+	bool SyncToTime(double Time);
+
+	UFUNCTION(BlueprintCallable, Category = TileDeltaBuffer)
+	UTexture2D* GetTexture();
+
+	UFUNCTION(BlueprintCallable, Category = TileDeltaBuffer)
+	int32 GetIndex() const;
+
+	UFUNCTION(BlueprintCallable, Category = TileDeltaBuffer)
+	int32 GetFrameCount() const;
+
+	/** Decodes the file list and encodes the tile deltas on a worker thread. */
+	UFUNCTION(BlueprintCallable, Category = TileDeltaBuffer)
+	bool LoadImageSequence();
+
+	UFUNCTION(BlueprintCallable, Category = TileDeltaBuffer)
+	void ReleaseBuffer();
+
+	/** Total size of the encoded frames, in kilobytes. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = TileDeltaBuffer)
+	int32 GetEncodedSizeKb() const;
+
+	/** Number of tiles uploaded since the sequence has been loaded. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = TileDeltaBuffer)
+	int32 GetUploadedTileCount() const;
+
+	UPROPERTY(BlueprintReadWrite)
+	float FrameIntervalInSec = 0.0333f;
+
+	UPROPERTY(BlueprintReadWrite)
+	float PlaybackRate = 1.0f;
+
+	/** Tile edge in pixels. Smaller tiles follow motion more closely but produce more regions. */
+	UPROPERTY(BlueprintReadWrite)
+	int32 TileSize = 64;
+
+	UPROPERTY(BlueprintReadOnly)
+	TArray<FString> FileList;
+
+	UPROPERTY(BlueprintReadWrite)
+	ETextureBufferStatus Status = ETextureBufferStatus::E_Unloaded;
+
+	UPROPERTY(BlueprintReadWrite)
+	FName SequenceName;
+
+	DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnTileDeltaSequenceLoadCompleted, int32, ImageCount, FName, SequenceName);
+	FOnTileDeltaSequenceLoadCompleted& OnImageSequenceLoadCompleted()
+	{
+		return ImageSequenceLoadCompleted;
+	}
+
+private:
+
+	struct FEncodedSequence
+	{
+		int32 Width = 0;
+		int32 Height = 0;
+		TArray<FTileDeltaFrame> Frames;
+		FTileDeltaFrame WrapFrame;
+	};
+
+	static bool EncodeSequence(const TArray<FString>& Files, int32 InTileSize, FEncodedSequence& Out);
+	static void EncodeFrame(const uint8* PrevPixels, const uint8* Pixels, int32 Width, int32 Height, int32 InTileSize, FTileDeltaFrame& Out);
+
+	void OnEncodeCompleted(TSharedPtr<FEncodedSequence, ESPMode::ThreadSafe> Encoded);
+
+	/** Uploads the tiles needed to go from the current frame to Target. */
+	bool PresentFrame(int32 Target);
+
+	UPROPERTY()
+	UDynamicTexture* DynamicTexture = nullptr;
+
+	/** Frames[0] is the key frame, Frames[i] holds the changes from frame i-1 to frame i. */
+	TArray<FTileDeltaFrame> Frames;
+
+	/** Changes from the last frame back to the first one. */
+	FTileDeltaFrame WrapFrame;
+
+	int32 Width = 0;
+	int32 Height = 0;
+	int32 AppliedIndex = INDEX_NONE;
+	int32 UploadedTiles = 0;
+
+	FPlaybackClock Clock;
+
+	/** Keeps the tile data alive until the render thread has consumed every pending upload. */
+	FRenderCommandFence ReleaseFence;
+
+	UPROPERTY(BlueprintAssignable, Category = ImageLoader, meta = (AllowPrivateAccess = true))
+	FOnTileDeltaSequenceLoadCompleted ImageSequenceLoadCompleted;
+};
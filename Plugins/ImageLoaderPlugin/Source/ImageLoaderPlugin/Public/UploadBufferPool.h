@@ -0,0 +1,40 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+Pool of CPU pixel buffers for texture uploads, shared by all dynamic textures.
+A buffer is acquired by the producer and released by the render command that uploads it, so it
+can neither be freed nor reused while the upload is pending. Continuous uploads of the same size
+reuse the same buffers instead of allocating one per frame. Safe to call from any thread.
+Pool size and reuse counts are shown by "stat ImageLoader".
+*/
+class IMAGELOADERPLUGIN_API FUploadBufferPool
+{
+public:
+
+	static FUploadBufferPool& Get();
+
+	~FUploadBufferPool();
+
+	/** Returns a buffer of Size bytes with undefined content. */
+	TArray<uint8>* Acquire(int32 Size);
+
+	/** Returns a buffer to the pool. Idle buffers beyond MaxIdleBuffers are freed. */
+	void Release(TArray<uint8>* Buffer);
+
+	/** Frees all idle buffers. */
+	void Trim();
+
+	void GetStats(int32& OutNumBuffers, int32& OutNumInUse, int64& OutReuses, int64& OutAllocations) const;
+
+private:
+
+	static const int32 MaxIdleBuffers = 8;
+
+	mutable FCriticalSection Mutex;
+	TArray<TArray<uint8>*> IdleBuffers;
+	int32 NumInUse = 0;
+	int64 Reuses = 0;
+	int64 Allocations = 0;
+};
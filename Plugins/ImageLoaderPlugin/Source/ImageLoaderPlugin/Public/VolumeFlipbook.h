@@ -0,0 +1,158 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ImageLoader.h"
+#include "TextureBuffer.h"
+#include "VolumeFlipbook.generated.h"
+
+class UVolumeTexture;
+class UMaterialInstanceDynamic;
+
+
+/**
+Short image sequence stored as the slices of a single volume texture, for effect loops of a few dozen frames.
+The material samples the volume with a depth coordinate computed from the engine time, so playback needs
+no parameter update per frame, and linear filtering along the depth blends neighbouring frames in hardware.
+
+Bound materials receive the volume texture and a playback vector P, from which the material computes
+	W = frac((Time - P.x) * P.y + P.z)
+with the Time node. P.w holds the number of frames. The volume must be sampled with wrapping addressing,
+so that the last frame blends back into the first one.
+*/
+UCLASS(Blueprintable, BlueprintType, ClassGroup = (ImageLoader))
+class IMAGELOADERPLUGIN_API UVolumeFlipbook : public UObject
+{
+	GENERATED_BODY()
+
+public:
+
+	UFUNCTION(BlueprintCallable, Category = VolumeFlipbook)
+	bool IsLoading() const;
+
+	UFUNCTION(BlueprintCallable, Category = VolumeFlipbook)
+	bool IsFinished() const;
+
+	/** Loads the DDS volume, or decodes and packs the frames of the file list, on a worker thread. */
+	UFUNCTION(BlueprintCallable, Category = VolumeFlipbook)
+	bool LoadImageSequence();
+
+	UFUNCTION(BlueprintCallable, Category = VolumeFlipbook)
+	void ReleaseBuffer();
+
+	UFUNCTION(BlueprintCallable, Category = VolumeFlipbook)
+	UVolumeTexture* GetTexture() const { return VolumeTexture; }
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = VolumeFlipbook)
+	int32 GetFrameCount() const { return Depth; }
+
+	/**
+	Sets the volume texture and the playback vector on a material, and keeps them updated on play, pause and seek.
+	A material bound before the sequence has loaded receives the texture once it is loaded.
+	*/
+	UFUNCTION(BlueprintCallable, Category = VolumeFlipbook)
+	void BindMaterial(UMaterialInstanceDynamic* Material, FName TextureName = TEXT("FlipbookTexture"), FName PlaybackName = TEXT("FlipbookPlayback"));
+
+	UFUNCTION(BlueprintCallable, Category = VolumeFlipbook)
+	void UnbindMaterial(UMaterialInstanceDynamic* Material);
+
+	UFUNCTION(BlueprintCallable, Category = VolumeFlipbook)
+	void Play();
+
+	UFUNCTION(BlueprintCallable, Category = VolumeFlipbook)
+	void Pause();
+
+	UFUNCTION(BlueprintCallable, Category = VolumeFlipbook)
+	void SeekToTime(float Seconds);
+
+	UFUNCTION(BlueprintCallable, Category = VolumeFlipbook)
+	void SetPlaybackRate(float Rate);
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = VolumeFlipbook)
+	bool GetIsPlaying() const { return IsPlaying; }
+
+	/** Playback position in seconds within the loop. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = VolumeFlipbook)
+	float GetTime() const;
+
+	/** Depth coordinate the bound materials sample at the current time, e.g. for materials computing it themselves. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = VolumeFlipbook)
+	float GetDepthCoordinate() const;
+
+
+	UPROPERTY(BlueprintReadWrite)
+	float FrameIntervalInSec = 0.0333f;
+
+	/** Decoded frames are box filtered down to this tier before they are packed. */
+	UPROPERTY(BlueprintReadWrite)
+	ETextureResolutionTier ResolutionTier = ETextureResolutionTier::E_Full;
+
+	/** Blends neighbouring frames. Without it the frames are sampled with point filtering. */
+	UPROPERTY(BlueprintReadWrite)
+	bool InterpolateFrames = true;
+
+	/** A single .dds volume, or the frames to pack into the volume. */
+	UPROPERTY(BlueprintReadOnly)
+	TArray<FString> FileList;
+
+	UPROPERTY(BlueprintReadWrite)
+	ETextureBufferStatus Status = ETextureBufferStatus::E_Unloaded;
+
+	UPROPERTY(BlueprintReadWrite)
+	FName SequenceName;
+
+	DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnVolumeFlipbookLoadCompleted, int32, ImageCount, FName, SequenceName);
+	FOnVolumeFlipbookLoadCompleted& OnImageSequenceLoadCompleted()
+	{
+		return ImageSequenceLoadCompleted;
+	}
+
+private:
+
+	struct FPackedVolume
+	{
+		int32 Width = 0;
+		int32 Height = 0;
+		int32 Depth = 0;
+		EPixelFormat Format = EPixelFormat::PF_Unknown;
+		TArray<uint8> Data;
+	};
+
+	/** Decodes the frames in parallel and stacks them as BGRA slices. All frames must have the size of the first. */
+	static bool PackSequence(const TArray<FString>& Files, ETextureResolutionTier Tier, FPackedVolume& Out);
+
+	void OnLoadCompleted(TSharedPtr<FPackedVolume, ESPMode::ThreadSafe> Packed);
+
+	/** Restarts the playback vector from the current position at the current rate, and sets it on the bound materials. */
+	void UpdatePlayback(float Phase);
+
+	void ApplyToMaterial(UMaterialInstanceDynamic* Material, FName TextureName, FName PlaybackName) const;
+
+	/** Phase of the loop in [0, 1) at the current world time. */
+	float GetPhase() const;
+
+	float GetWorldTime() const;
+
+	struct FBoundMaterial
+	{
+		TWeakObjectPtr<UMaterialInstanceDynamic> Material;
+		FName TextureName;
+		FName PlaybackName;
+	};
+
+	TArray<FBoundMaterial> BoundMaterials;
+
+	UPROPERTY()
+	UVolumeTexture* VolumeTexture = nullptr;
+
+	int32 Depth = 0;
+
+	bool IsPlaying = false;
+	float PlaybackRate = 1.0f;
+
+	// World time the playback vector counts from, and the phase of the loop at that time
+	float StartWorldTime = 0.0f;
+	float StartPhase = 0.0f;
+
+	UPROPERTY(BlueprintAssignable, Category = ImageLoader, meta = (AllowPrivateAccess = true))
+	FOnVolumeFlipbookLoadCompleted ImageSequenceLoadCompleted;
+};
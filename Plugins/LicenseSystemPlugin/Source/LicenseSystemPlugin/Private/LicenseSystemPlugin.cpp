@@ -1,20 +1,49 @@
 // Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
 
 #include "LicenseSystemPlugin.h"
+#include "LicenseValidator.h"
+#include "Misc/ConfigCacheIni.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/Paths.h"
+#include "Engine/Engine.h"
 
 #define LOCTEXT_NAMESPACE "FLicenseSystemPluginModule"
 
+static const TCHAR* LicenseSystemConfigSection = TEXT("LicenseSystemPlugin");
+
 void FLicenseSystemPluginModule::StartupModule()
 {
 	// This code will execute after your module is loaded into memory; the exact timing is specified in the .uplugin file per-module
-	
+	FLicenseValidator::Get().Start();
+
+	if (GEngine && GEngine->IsInitialized())
+		StartConfiguredValidation();
+	else
+		PostEngineInitHandle = FCoreDelegates::OnPostEngineInit.AddRaw(this, &FLicenseSystemPluginModule::StartConfiguredValidation);
 }
 
 void FLicenseSystemPluginModule::ShutdownModule()
 {
 	// This function may be called during shutdown to clean up your module.  For modules that support dynamic reloading,
 	// we call this function before unloading the module.
-	
+	FCoreDelegates::OnPostEngineInit.Remove(PostEngineInitHandle);
+	FLicenseValidator::Get().Stop();
+}
+
+void FLicenseSystemPluginModule::StartConfiguredValidation()
+{
+	FCoreDelegates::OnPostEngineInit.Remove(PostEngineInitHandle);
+
+	if (!GConfig)
+		return;
+
+	// Paths are relative to the project directory
+	FString LicenseFile, KeyFile;
+	if (!GConfig->GetString(LicenseSystemConfigSection, TEXT("LicenseFile"), LicenseFile, GGameIni) || LicenseFile.IsEmpty()
+		|| !GConfig->GetString(LicenseSystemConfigSection, TEXT("KeyFile"), KeyFile, GGameIni) || KeyFile.IsEmpty())
+		return;
+
+	FLicenseValidator::Get().ValidateAsync(FPaths::Combine(FPaths::ProjectDir(), LicenseFile), FPaths::Combine(FPaths::ProjectDir(), KeyFile));
 }
 
 #undef LOCTEXT_NAMESPACE
@@ -0,0 +1,249 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#include "LicenseValidator.h"
+#include "LicenseSystemPluginBPLibrary.h"
+#include "EncryptionContextOpenSSL.h"
+#include "Async/Async.h"
+#include "Containers/Ticker.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+
+static const float LicenseChangeCheckInterval = 2.0f;
+
+
+FLicenseValidator& FLicenseValidator::Get()
+{
+	static FLicenseValidator Validator;
+	return Validator;
+}
+
+
+void FLicenseValidator::Start()
+{
+	if (!TickerHandle.IsValid())
+		TickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FLicenseValidator::CheckForChanges), LicenseChangeCheckInterval);
+}
+
+void FLicenseValidator::Stop()
+{
+	if (TickerHandle.IsValid())
+		FTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+	TickerHandle.Reset();
+}
+
+
+FDateTime FLicenseValidator::GetTimeStamp(const FString& Filename)
+{
+	// MinValue for a missing file, so deleting it counts as a change
+	return IFileManager::Get().GetTimeStamp(*Filename);
+}
+
+
+void FLicenseValidator::ValidateAsync(const FString& LicenseFilename, const FString& KeyFilename)
+{
+	const FDateTime LicenseStamp = GetTimeStamp(LicenseFilename);
+	const FDateTime KeyStamp = GetTimeStamp(KeyFilename);
+
+	FScopeLock Lock(&Mutex);
+	LicenseFile = LicenseFilename;
+	KeyFile = KeyFilename;
+	LicenseTimeStamp = LicenseStamp;
+	KeyTimeStamp = KeyStamp;
+	State = static_cast<uint8>(EState::Pending);
+	ContentKey.Empty();
+
+	// On its own thread, loads that wait for the verdict on the thread pool cannot hold it up
+	const int32 ForGeneration = ++Generation;
+	PendingValidation = Async(EAsyncExecution::Thread, [this, LicenseFilename, KeyFilename, ForGeneration]()
+	{
+		FDateTime BeginDate, EndDate;
+		TArray<uint8> Key;
+		const bool bRead = ReadLicense(LicenseFilename, KeyFilename, BeginDate, EndDate, Key);
+		OnValidated(ForGeneration, bRead, BeginDate, EndDate, MoveTemp(Key));
+	}).Share();
+}
+
+
+void FLicenseValidator::OnValidated(int32 ForGeneration, bool bRead, const FDateTime& BeginDate, const FDateTime& EndDate, TArray<uint8>&& Key)
+{
+	FScopeLock Lock(&Mutex);
+	if (ForGeneration != Generation)
+		return;
+
+	ContentKey = bRead ? MoveTemp(Key) : TArray<uint8>();
+
+	// The dates are stored before the state, GetStatus reads them after it
+	BeginTicks = BeginDate.GetTicks();
+	EndTicks = EndDate.GetTicks();
+	State = static_cast<uint8>(bRead ? EState::Read : EState::Failed);
+
+	UE_LOG(LogTemp, Log, TEXT("FLicenseValidator: %s is %s"), *LicenseFile, GetStatus() == ELicenseStatus::Valid ? TEXT("valid") : TEXT("invalid"));
+}
+
+
+bool FLicenseValidator::Validate(const FString& LicenseFilename, const FString& KeyFilename)
+{
+	TSharedFuture<void> Pending;
+	{
+		FScopeLock Lock(&Mutex);
+		const bool bSameFiles = (LicenseFile == LicenseFilename && KeyFile == KeyFilename);
+		if (!bSameFiles || static_cast<EState>(State.Load()) == EState::Unknown)
+			ValidateAsync(LicenseFilename, KeyFilename);
+
+		if (static_cast<EState>(State.Load()) == EState::Pending)
+			Pending = PendingValidation;
+	}
+
+	if (Pending.IsValid())
+		Pending.Wait();
+
+	return GetStatus() == ELicenseStatus::Valid;
+}
+
+
+bool FLicenseValidator::WaitForValidation(float MaxWaitSeconds) const
+{
+	TSharedFuture<void> Pending;
+	{
+		FScopeLock Lock(&Mutex);
+		if (static_cast<EState>(State.Load()) != EState::Pending)
+			return true;
+		Pending = PendingValidation;
+	}
+
+	return !Pending.IsValid() || Pending.WaitFor(FTimespan::FromSeconds(MaxWaitSeconds));
+}
+
+
+ELicenseStatus FLicenseValidator::GetStatus() const
+{
+	switch (static_cast<EState>(State.Load()))
+	{
+	case EState::Pending:
+		return ELicenseStatus::Pending;
+	case EState::Failed:
+		return ELicenseStatus::Invalid;
+	case EState::Read:
+	{
+		const int64 Now = FDateTime::UtcNow().GetTicks();
+		return (Now >= BeginTicks.Load() && Now <= EndTicks.Load()) ? ELicenseStatus::Valid : ELicenseStatus::Invalid;
+	}
+	default:
+		return ELicenseStatus::Unknown;
+	}
+}
+
+
+bool FLicenseValidator::GetContentKey(TArray<uint8>& OutKey) const
+{
+	if (GetStatus() != ELicenseStatus::Valid)
+		return false;
+
+	FScopeLock Lock(&Mutex);
+	OutKey = ContentKey;
+	return OutKey.Num() > 0;
+}
+
+
+bool FLicenseValidator::CheckForChanges(float DeltaTime)
+{
+	FString LicenseFilename, KeyFilename;
+	FDateTime LicenseStamp, KeyStamp;
+	{
+		FScopeLock Lock(&Mutex);
+		if (LicenseFile.IsEmpty() || static_cast<EState>(State.Load()) == EState::Pending)
+			return true;
+
+		LicenseFilename = LicenseFile;
+		KeyFilename = KeyFile;
+		LicenseStamp = LicenseTimeStamp;
+		KeyStamp = KeyTimeStamp;
+	}
+
+	if (GetTimeStamp(LicenseFilename) != LicenseStamp || GetTimeStamp(KeyFilename) != KeyStamp)
+	{
+		UE_LOG(LogTemp, Log, TEXT("FLicenseValidator: License files changed, validating again"));
+		ValidateAsync(LicenseFilename, KeyFilename);
+	}
+
+	return true;
+}
+
+
+bool FLicenseValidator::ReadLicense(const FString& LicenseFilename, const FString& KeyFilename, FDateTime& OutBeginDate, FDateTime& OutEndDate, TArray<uint8>& OutKey)
+{
+	TArray<uint8> License, Key;
+
+	if (!FFileHelper::LoadFileToArray(License, *LicenseFilename))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Could not load license file: %s"), *LicenseFilename);
+		return false;
+	}
+
+	if (!FFileHelper::LoadFileToArray(Key, *KeyFilename))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Could not load key file: %s"), *KeyFilename);
+		return false;
+	}
+
+	// The key holds the 256 bit AES key, whose first 128 bits are also the IV
+	if (Key.Num() < 256 / 8)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Key file too short: %s"), *KeyFilename);
+		return false;
+	}
+
+	TArray<uint8> Iv(Key.GetData(), 128 / 8);
+
+	EPlatformCryptoResult OpenSslResult;
+	FEncryptionContextOpenSSL OpenSslCtx;
+	TArray<uint8> Decrypted = OpenSslCtx.Decrypt_AES_256_CBC(License, Key, Iv, OpenSslResult);
+
+	if (OpenSslResult != EPlatformCryptoResult::Success)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Could not decrypt license file: %s"), *LicenseFilename);
+		return false;
+	}
+
+	FString JsonStr = ULicenseSystemPluginBPLibrary::ConvertBytesToString(Decrypted);
+
+	TSharedRef<TJsonReader<>> JsonReader = TJsonReaderFactory<>::Create(JsonStr);
+	TSharedPtr<FJsonObject> JsonObject;
+
+	if (!FJsonSerializer::Deserialize(JsonReader, JsonObject) || !JsonObject.IsValid())
+	{
+		UE_LOG(LogTemp, Error, TEXT("Could not parse json from license file"));
+		return false;
+	}
+
+	TArray<FString> BeginDateStr;
+	JsonObject->GetStringField("BeginDate").ParseIntoArray(BeginDateStr, TEXT("/"), true);
+
+	TArray<FString> EndDateStr;
+	JsonObject->GetStringField("EndDate").ParseIntoArray(EndDateStr, TEXT("/"), true);
+
+	if (BeginDateStr.Num() != 3 || EndDateStr.Num() != 3)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Could not parse date from license file"));
+		return false;
+	}
+
+	// Dates are day/month/year
+	const int32 BeginYear = FCString::Atoi(*BeginDateStr[2]), BeginMonth = FCString::Atoi(*BeginDateStr[1]), BeginDay = FCString::Atoi(*BeginDateStr[0]);
+	const int32 EndYear = FCString::Atoi(*EndDateStr[2]), EndMonth = FCString::Atoi(*EndDateStr[1]), EndDay = FCString::Atoi(*EndDateStr[0]);
+
+	if (!FDateTime::Validate(BeginYear, BeginMonth, BeginDay, 0, 0, 0, 0) || !FDateTime::Validate(EndYear, EndMonth, EndDay, 0, 0, 0, 0))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Invalid date in license file"));
+		return false;
+	}
+
+	OutBeginDate = FDateTime(BeginYear, BeginMonth, BeginDay);
+	OutEndDate = FDateTime(EndYear, EndMonth, EndDay);
+	OutKey = TArray<uint8>(Key.GetData(), 256 / 8);
+	return true;
+}
@@ -11,4 +11,11 @@ public:
 	/** IModuleInterface implementation */
 	virtual void StartupModule() override;
 	virtual void ShutdownModule() override;
+
+private:
+
+	/** Validates the license configured in DefaultGame.ini, once the thread pool is running. */
+	void StartConfiguredValidation();
+
+	FDelegateHandle PostEngineInitHandle;
 };
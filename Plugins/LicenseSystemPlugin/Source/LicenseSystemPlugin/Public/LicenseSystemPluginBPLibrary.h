@@ -3,6 +3,7 @@
 #pragma once
 
 #include "Kismet/BlueprintFunctionLibrary.h"
+#include "LicenseValidator.h"
 #include "LicenseSystemPluginBPLibrary.generated.h"
 
 /* 
@@ -31,9 +32,22 @@ public:
 	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Execute Sample function", Keywords = "LicenseSystemPlugin sample test testing"), Category = "LicenseSystemPluginTesting")
 	static float LicenseSystemPluginSampleFunction(float Param);
 
+	/** Returns the cached verdict for these files. Blocks only if they have not been validated yet, or are being validated. */
 	UFUNCTION(BlueprintCallable, Category = "License System")
 	static bool IsLicenseValid(FString LicenseFilename, FString KeyFilename);
 
+	/** Validates the license on a worker thread. The verdict is then read with GetLicenseStatus. */
+	UFUNCTION(BlueprintCallable, Category = "License System")
+	static void ValidateLicenseAsync(FString LicenseFilename, FString KeyFilename);
+
+	/** Non-blocking verdict of the last validated license, Pending while it is being validated. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "License System")
+	static ELicenseStatus GetLicenseStatus();
+
+	/** Non-blocking. False while the license is being validated. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "License System")
+	static bool HasValidLicense();
+
 	UFUNCTION(BlueprintCallable)
 	static FString ConvertBytesToString(const TArray<uint8>& In);
 };
@@ -0,0 +1,94 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+#include "Templates/Atomic.h"
+#include "LicenseValidator.generated.h"
+
+UENUM(BlueprintType)
+enum class ELicenseStatus : uint8
+{
+	/** No license has been validated yet. */
+	Unknown,
+	/** Validation is running on a worker thread. */
+	Pending,
+	Valid,
+	/** Missing, unreadable or expired license. */
+	Invalid
+};
+
+
+/**
+Validates a license once, on a worker thread, and keeps the verdict. The files are checked for changes every
+few seconds, and validated again when their modification time changes. Reading the verdict costs a few atomic
+loads and a clock read, so it can be queried from anywhere, every frame.
+*/
+class LICENSESYSTEMPLUGIN_API FLicenseValidator
+{
+public:
+
+	static FLicenseValidator& Get();
+
+	/** Starts checking the files for changes. Called by the module. */
+	void Start();
+	void Stop();
+
+	/** Validates the license on a worker thread, replacing any verdict for other files. */
+	void ValidateAsync(const FString& LicenseFilename, const FString& KeyFilename);
+
+	/** Returns the verdict for the files, validating them if needed and waiting for a validation in progress. */
+	bool Validate(const FString& LicenseFilename, const FString& KeyFilename);
+
+	/** Non-blocking. A valid license turns invalid once its end date has passed. */
+	ELicenseStatus GetStatus() const;
+
+	/**
+	Waits for a validation in progress, at most MaxWaitSeconds. Not meant for the game thread.
+	@return False if the validation is still running.
+	*/
+	bool WaitForValidation(float MaxWaitSeconds) const;
+
+	/**
+	Copies the 256 bit AES key of the license, to decrypt content shipped with it.
+	@return False unless the license has been validated and is valid.
+	*/
+	bool GetContentKey(TArray<uint8>& OutKey) const;
+
+	/** Decrypts the license with the key and reads its validity period. Blocking, callable from any thread. */
+	static bool ReadLicense(const FString& LicenseFilename, const FString& KeyFilename, FDateTime& OutBeginDate, FDateTime& OutEndDate, TArray<uint8>& OutKey);
+
+private:
+
+	enum class EState : uint8
+	{
+		Unknown,
+		Pending,
+		Read,
+		Failed
+	};
+
+	bool CheckForChanges(float DeltaTime);
+
+	void OnValidated(int32 ForGeneration, bool bRead, const FDateTime& BeginDate, const FDateTime& EndDate, TArray<uint8>&& Key);
+
+	static FDateTime GetTimeStamp(const FString& Filename);
+
+	mutable FCriticalSection Mutex;
+	FString LicenseFile;
+	FString KeyFile;
+	FDateTime LicenseTimeStamp;
+	FDateTime KeyTimeStamp;
+	TArray<uint8> ContentKey;
+
+	/** Results of validations replaced by a later one are dropped. */
+	int32 Generation = 0;
+	TSharedFuture<void> PendingValidation;
+
+	TAtomic<uint8> State { static_cast<uint8>(EState::Unknown) };
+	TAtomic<int64> BeginTicks { 0 };
+	TAtomic<int64> EndTicks { 0 };
+
+	FDelegateHandle TickerHandle;
+};
@@ -0,0 +1,447 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HttpResponseCache.h"
+
+#include "Runtime/Online/HTTP/Public/HttpModule.h"
+#include "Interfaces/IHttpResponse.h"
+#include "Async/Async.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+#include "Misc/SecureHash.h"
+#include "Serialization/BufferArchive.h"
+#include "Serialization/MemoryReader.h"
+
+
+namespace
+{
+	const uint32 CacheFileMagic = 0x48524331; // HRC1
+
+	/** Seconds a response may be served without revalidation, or -1 if it must not be stored. */
+	int32 GetMaxAge(const FString& CacheControl)
+	{
+		TArray<FString> Directives;
+		CacheControl.ParseIntoArray(Directives, TEXT(","));
+
+		int32 MaxAge = 0;
+		for (FString& Directive : Directives)
+		{
+			Directive.TrimStartAndEndInline();
+			if (Directive.Equals(TEXT("no-store"), ESearchCase::IgnoreCase))
+				return -1;
+			if (Directive.Equals(TEXT("no-cache"), ESearchCase::IgnoreCase))
+				MaxAge = 0;
+			else if (Directive.StartsWith(TEXT("max-age="), ESearchCase::IgnoreCase))
+				MaxAge = FMath::Max(0, FCString::Atoi(*Directive.RightChop(8)));
+		}
+		return MaxAge;
+	}
+}
+
+
+FHttpResponseCache& FHttpResponseCache::Get()
+{
+	static FHttpResponseCache Cache;
+	return Cache;
+}
+
+FHttpResponseCache::FHttpResponseCache()
+{
+	CacheDirectory = FPaths::ProjectSavedDir() / TEXT("HttpCache");
+}
+
+
+void FHttpResponseCache::SetCacheDirectory(const FString& Directory)
+{
+	CacheDirectory = Directory;
+
+	FScopeLock Lock(&DiskMutex);
+	DiskBytes = -1;
+}
+
+void FHttpResponseCache::SetMaxMemoryBytes(int64 Bytes)
+{
+	MaxMemoryBytes = FMath::Max<int64>(0, Bytes);
+	TrimMemory();
+}
+
+void FHttpResponseCache::SetMaxDiskBytes(int64 Bytes)
+{
+	FScopeLock Lock(&DiskMutex);
+	MaxDiskBytes = FMath::Max<int64>(0, Bytes);
+}
+
+void FHttpResponseCache::Clear()
+{
+	Entries.Empty();
+	MemoryBytes = 0;
+	HitCount = 0;
+	MissCount = 0;
+	CoalescedCount = 0;
+
+	if (!CacheDirectory.IsEmpty())
+		IFileManager::Get().DeleteDirectory(*CacheDirectory, false, true);
+
+	FScopeLock Lock(&DiskMutex);
+	DiskBytes = -1;
+}
+
+
+FString FHttpResponseCache::GetCachePath(const FString& Url) const
+{
+	if (CacheDirectory.IsEmpty())
+		return FString();
+
+	return CacheDirectory / FMD5::HashAnsiString(*Url) + TEXT(".bin");
+}
+
+
+void FHttpResponseCache::Fetch(const FString& Url, TFunction<void(FBytes Content)> OnFetched, TFunction<void(int32 BytesReceived, int32 ContentLength)> OnProgress)
+{
+	check(IsInGameThread());
+
+	if (TArray<FWaiter>* Waiters = InFlight.Find(Url))
+	{
+		++CoalescedCount;
+		Waiters->Add({ MoveTemp(OnFetched), MoveTemp(OnProgress) });
+		return;
+	}
+
+	if (FEntryPtr* Found = Entries.Find(Url))
+	{
+		FEntryPtr Cached = *Found;
+		Cached->LastUse = ++UseCounter;
+		if (FDateTime::UtcNow() < Cached->ExpiresAt)
+		{
+			++HitCount;
+			if (OnFetched)
+				OnFetched(Cached->Content);
+			return;
+		}
+
+		InFlight.Add(Url).Add({ MoveTemp(OnFetched), MoveTemp(OnProgress) });
+		StartRequest(Url, Cached);
+		return;
+	}
+
+	InFlight.Add(Url).Add({ MoveTemp(OnFetched), MoveTemp(OnProgress) });
+
+	const FString Path = GetCachePath(Url);
+	if (Path.IsEmpty())
+	{
+		StartRequest(Url, nullptr);
+		return;
+	}
+
+	// Not seen in this session, look for it on disk first
+	Async(EAsyncExecution::ThreadPool, [this, Url, Path]()
+	{
+		FEntryPtr Cached = ReadEntry(Path, Url);
+
+		AsyncTask(ENamedThreads::GameThread, [this, Url, Cached]()
+		{
+			if (!Cached.IsValid())
+			{
+				StartRequest(Url, nullptr);
+				return;
+			}
+
+			Cached->LastUse = ++UseCounter;
+			if (!Entries.Contains(Url))
+			{
+				Entries.Add(Url, Cached);
+				MemoryBytes += Cached->Content->Num();
+				TrimMemory();
+			}
+
+			if (FDateTime::UtcNow() < Cached->ExpiresAt)
+			{
+				++HitCount;
+				Complete(Url, Cached->Content);
+				return;
+			}
+
+			StartRequest(Url, Cached);
+		});
+	});
+}
+
+
+void FHttpResponseCache::StartRequest(const FString& Url, FEntryPtr Cached)
+{
+	TSharedRef<IHttpRequest, ESPMode::ThreadSafe> HttpRequest = FHttpModule::Get().CreateRequest();
+	HttpRequest->SetVerb("GET");
+	HttpRequest->SetURL(Url);
+
+	if (Cached.IsValid())
+	{
+		if (!Cached->ETag.IsEmpty())
+			HttpRequest->SetHeader(TEXT("If-None-Match"), Cached->ETag);
+		if (!Cached->LastModified.IsEmpty())
+			HttpRequest->SetHeader(TEXT("If-Modified-Since"), Cached->LastModified);
+	}
+
+	HttpRequest->OnProcessRequestComplete().BindRaw(this, &FHttpResponseCache::OnResponseReceived, Url, Cached);
+	HttpRequest->OnRequestProgress().BindRaw(this, &FHttpResponseCache::OnRequestProgress, Url);
+	HttpRequest->ProcessRequest();
+}
+
+
+void FHttpResponseCache::OnRequestProgress(FHttpRequestPtr Request, int32 BytesSent, int32 BytesReceived, FString Url)
+{
+	const TArray<FWaiter>* Waiters = InFlight.Find(Url);
+	if (!Waiters)
+		return;
+
+	FHttpResponsePtr Response = Request.IsValid() ? Request->GetResponse() : nullptr;
+	const int32 ContentLength = Response.IsValid() ? Response->GetContentLength() : 0;
+
+	for (const FWaiter& Waiter : *Waiters)
+	{
+		if (Waiter.OnProgress)
+			Waiter.OnProgress(BytesReceived, ContentLength);
+	}
+}
+
+
+void FHttpResponseCache::OnResponseReceived(FHttpRequestPtr Request, FHttpResponsePtr Response, bool bSuccessful, FString Url, FEntryPtr Cached)
+{
+	const int32 Code = (bSuccessful && Response.IsValid()) ? Response->GetResponseCode() : 0;
+
+	if (Code == EHttpResponseCodes::NotModified && Cached.IsValid())
+	{
+		++HitCount;
+
+		// A 304 may carry a new max-age or new validators
+		const int32 MaxAge = GetMaxAge(Response->GetHeader(TEXT("Cache-Control")));
+		FEntryPtr Revalidated = MakeShared<FEntry, ESPMode::ThreadSafe>(*Cached);
+		Revalidated->ExpiresAt = FDateTime::UtcNow() + FTimespan::FromSeconds(FMath::Max(0, MaxAge));
+		const FString ETag = Response->GetHeader(TEXT("ETag"));
+		if (!ETag.IsEmpty())
+			Revalidated->ETag = ETag;
+		const FString LastModified = Response->GetHeader(TEXT("Last-Modified"));
+		if (!LastModified.IsEmpty())
+			Revalidated->LastModified = LastModified;
+
+		Store(Url, Revalidated);
+		Complete(Url, Revalidated->Content);
+		return;
+	}
+
+	if (EHttpResponseCodes::IsOk(Code))
+	{
+		++MissCount;
+
+		FEntryPtr Fresh = MakeShared<FEntry, ESPMode::ThreadSafe>();
+		Fresh->Content = MakeShared<TArray<uint8>, ESPMode::ThreadSafe>(Response->GetContent());
+		Fresh->ETag = Response->GetHeader(TEXT("ETag"));
+		Fresh->LastModified = Response->GetHeader(TEXT("Last-Modified"));
+
+		const int32 MaxAge = GetMaxAge(Response->GetHeader(TEXT("Cache-Control")));
+		if (MaxAge >= 0)
+		{
+			Fresh->ExpiresAt = FDateTime::UtcNow() + FTimespan::FromSeconds(MaxAge);
+			Store(Url, Fresh);
+		}
+
+		Complete(Url, Fresh->Content);
+		return;
+	}
+
+	if (Cached.IsValid())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("FHttpResponseCache: Request failed with code %d, serving the cached response of %s"), Code, *Url);
+		++HitCount;
+		Complete(Url, Cached->Content);
+		return;
+	}
+
+	UE_LOG(LogTemp, Error, TEXT("FHttpResponseCache: Request failed with code %d: %s"), Code, *Url);
+	++MissCount;
+	Complete(Url, nullptr);
+}
+
+
+void FHttpResponseCache::Store(const FString& Url, FEntryPtr Entry)
+{
+	Entry->LastUse = ++UseCounter;
+
+	if (FEntryPtr* Previous = Entries.Find(Url))
+		MemoryBytes -= (*Previous)->Content->Num();
+
+	Entries.Add(Url, Entry);
+	MemoryBytes += Entry->Content->Num();
+	TrimMemory();
+
+	// Without validators the response could only be served until it expires
+	const FString Path = GetCachePath(Url);
+	if (Path.IsEmpty() || (Entry->ETag.IsEmpty() && Entry->LastModified.IsEmpty() && Entry->ExpiresAt <= FDateTime::UtcNow()))
+		return;
+
+	const FString Directory = CacheDirectory;
+	Async(EAsyncExecution::ThreadPool, [this, Directory, Path, Url, Entry]()
+	{
+		int64 WrittenBytes = 0;
+		int64 ReplacedBytes = 0;
+		if (WriteEntry(Path, Url, *Entry, WrittenBytes, ReplacedBytes))
+			OnEntryWritten(Directory, WrittenBytes, ReplacedBytes);
+		else
+			UE_LOG(LogTemp, Warning, TEXT("FHttpResponseCache: Could not write %s"), *Path);
+	});
+}
+
+
+void FHttpResponseCache::Complete(const FString& Url, FBytes Content)
+{
+	TArray<FWaiter> Waiters;
+	InFlight.RemoveAndCopyValue(Url, Waiters);
+
+	for (FWaiter& Waiter : Waiters)
+	{
+		if (Waiter.OnFetched)
+			Waiter.OnFetched(Content);
+	}
+}
+
+
+void FHttpResponseCache::TrimMemory()
+{
+	while (MemoryBytes > MaxMemoryBytes && Entries.Num() > 0)
+	{
+		auto Oldest = Entries.CreateIterator();
+		for (auto It = Entries.CreateIterator(); It; ++It)
+		{
+			if (It.Value()->LastUse < Oldest.Value()->LastUse)
+				Oldest = It;
+		}
+
+		MemoryBytes -= Oldest.Value()->Content->Num();
+		Oldest.RemoveCurrent();
+	}
+}
+
+
+FHttpResponseCache::FEntryPtr FHttpResponseCache::ReadEntry(const FString& Path, const FString& Url)
+{
+	TArray<uint8> FileData;
+	if (!FFileHelper::LoadFileToArray(FileData, *Path, FILEREAD_Silent))
+		return nullptr;
+
+	FMemoryReader Reader(FileData);
+	uint32 Magic = 0;
+	FString StoredUrl;
+	int64 ExpiresTicks = 0;
+	int32 ContentSize = 0;
+	FEntryPtr Entry = MakeShared<FEntry, ESPMode::ThreadSafe>();
+
+	Reader << Magic;
+	if (Magic != CacheFileMagic)
+		return nullptr;
+
+	Reader << StoredUrl << Entry->ETag << Entry->LastModified << ExpiresTicks << ContentSize;
+
+	// The file name is a hash of the URL, so it may belong to another URL
+	if (Reader.IsError() || StoredUrl != Url || ContentSize < 0 || ContentSize > Reader.TotalSize() - Reader.Tell())
+		return nullptr;
+
+	TSharedPtr<TArray<uint8>, ESPMode::ThreadSafe> Content = MakeShared<TArray<uint8>, ESPMode::ThreadSafe>();
+	Content->SetNumUninitialized(ContentSize);
+	Reader.Serialize(Content->GetData(), ContentSize);
+
+	Entry->Content = Content;
+	Entry->ExpiresAt = FDateTime(ExpiresTicks);
+
+	// The modification time of a file is its last use, which drives the trimming
+	IFileManager::Get().SetTimeStamp(*Path, FDateTime::UtcNow());
+	return Entry;
+}
+
+bool FHttpResponseCache::WriteEntry(const FString& Path, const FString& Url, const FEntry& Entry, int64& OutWrittenBytes, int64& OutReplacedBytes)
+{
+	FBufferArchive Writer;
+	uint32 Magic = CacheFileMagic;
+	FString StoredUrl = Url;
+	FString ETag = Entry.ETag;
+	FString LastModified = Entry.LastModified;
+	int64 ExpiresTicks = Entry.ExpiresAt.GetTicks();
+	int32 ContentSize = Entry.Content->Num();
+
+	Writer << Magic << StoredUrl << ETag << LastModified << ExpiresTicks << ContentSize;
+	Writer.Serialize(const_cast<uint8*>(Entry.Content->GetData()), ContentSize);
+
+	// Written next to the target and moved, so a reader never sees a partial file.
+	// The name is per thread, two writes of the same URL may run at once.
+	const FString TempPath = Path + FString::Printf(TEXT(".%u.tmp"), FPlatformTLS::GetCurrentThreadId());
+	if (!FFileHelper::SaveArrayToFile(Writer, *TempPath))
+	{
+		IFileManager::Get().Delete(*TempPath, false, false, true);
+		return false;
+	}
+
+	OutWrittenBytes = Writer.Num();
+	OutReplacedBytes = FMath::Max<int64>(0, IFileManager::Get().FileSize(*Path));
+	if (!IFileManager::Get().Move(*Path, *TempPath, true, true))
+	{
+		IFileManager::Get().Delete(*TempPath, false, false, true);
+		return false;
+	}
+	return true;
+}
+
+
+void FHttpResponseCache::OnEntryWritten(const FString& Directory, int64 WrittenBytes, int64 ReplacedBytes)
+{
+	FScopeLock Lock(&DiskMutex);
+
+	// Measured once, the new file is then counted already
+	if (DiskBytes < 0)
+	{
+		TrimDisk(Directory);
+		return;
+	}
+
+	DiskBytes += WrittenBytes - ReplacedBytes;
+	if (DiskBytes > MaxDiskBytes)
+		TrimDisk(Directory);
+}
+
+void FHttpResponseCache::TrimDisk(const FString& Directory)
+{
+	struct FCacheFile
+	{
+		FString Path;
+		int64 Size;
+		FDateTime LastUse;
+	};
+	TArray<FCacheFile> Files;
+
+	DiskBytes = 0;
+	FPlatformFileManager::Get().GetPlatformFile().IterateDirectoryStat(*Directory, [this, &Files](const TCHAR* Filename, const FFileStatData& StatData)
+	{
+		if (!StatData.bIsDirectory && FPaths::GetExtension(Filename) == TEXT("bin"))
+		{
+			Files.Add({ Filename, StatData.FileSize, StatData.ModificationTime });
+			DiskBytes += StatData.FileSize;
+		}
+		return true;
+	});
+
+	if (DiskBytes <= MaxDiskBytes)
+		return;
+
+	// Trimmed below the cap, so that a full cache is not trimmed on every write
+	const int64 TargetBytes = MaxDiskBytes / 10 * 9;
+	Files.Sort([](const FCacheFile& A, const FCacheFile& B) { return A.LastUse < B.LastUse; });
+
+	for (const FCacheFile& File : Files)
+	{
+		if (DiskBytes <= TargetBytes)
+			break;
+
+		if (IFileManager::Get().Delete(*File.Path, false, false, true))
+			DiskBytes -= File.Size;
+	}
+}
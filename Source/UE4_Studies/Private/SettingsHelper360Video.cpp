@@ -1,6 +1,7 @@
 #include "SettingsHelper360Video.h"
 #include <string>
 #include <Misc/App.h>
+#include "TextureBufferPlayerTicker.h"
 
 void USettingsHelper360Video::SetFixedTimeStep(float desiredDeltaTime)
 {
@@ -12,3 +13,28 @@ void USettingsHelper360Video::DisableFixedTimeStep()
 {
 	FApp::SetUseFixedTimeStep(false);
 }
+
+void USettingsHelper360Video::EnableFrameLockedCapture(float desiredDeltaTime, float MaxStallSeconds)
+{
+	SetFixedTimeStep(desiredDeltaTime);
+	FTextureBufferPlayerTicker::Get().SetFrameLocked(true, MaxStallSeconds);
+}
+
+void USettingsHelper360Video::DisableFrameLockedCapture()
+{
+	float TotalStall = 0.0f;
+	int32 StalledFrames = 0;
+	int32 CapturedFrames = 0;
+	FTextureBufferPlayerTicker::Get().GetStallStats(TotalStall, StalledFrames, CapturedFrames);
+	UE_LOG(LogTemp, Log, TEXT("USettingsHelper360Video: Frame-locked capture of %d frames waited %.2f s for image sequences in %d frames"), CapturedFrames, TotalStall, StalledFrames);
+
+	FTextureBufferPlayerTicker::Get().SetFrameLocked(false);
+	DisableFixedTimeStep();
+}
+
+void USettingsHelper360Video::GetCaptureStallStats(float& LastFrameStall, float& TotalStall, int32& StalledFrames, int32& CapturedFrames)
+{
+	const FTextureBufferPlayerTicker& Ticker = FTextureBufferPlayerTicker::Get();
+	LastFrameStall = Ticker.GetLastStallTime();
+	Ticker.GetStallStats(TotalStall, StalledFrames, CapturedFrames);
+}
@@ -0,0 +1,220 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "HttpResponseCache.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS && WITH_HTTPSERVER_TESTS
+
+#include "HttpServerModule.h"
+#include "IHttpRouter.h"
+#include "HttpPath.h"
+#include "HttpRouteHandle.h"
+#include "HttpServerRequest.h"
+#include "HttpServerResponse.h"
+#include "HAL/FileManager.h"
+#include "Misc/Guid.h"
+#include "Misc/Paths.h"
+
+
+namespace HttpResponseCacheTest
+{
+	static const uint32 Port = 18422;
+	static const int32 NumConcurrentFetches = 3;
+	static const double TimeoutSeconds = 10.0;
+	static const TCHAR* Body = TEXT("manifest");
+	static const TCHAR* ETag = TEXT("\"v1\"");
+	static const TCHAR* LastModified = TEXT("Wed, 21 Oct 2015 07:28:00 GMT");
+
+	struct FState
+	{
+		FString Url;
+
+		// Seen by the server
+		int32 Requests = 0;
+		int32 ConditionalRequests = 0;
+		int32 NotModifiedResponses = 0;
+
+		// Seen by the callers
+		int32 Fetched = 0;
+		int32 Failed = 0;
+		int32 WrongBodies = 0;
+
+		int32 InitialHits = 0;
+		int32 InitialMisses = 0;
+		int32 InitialCoalesced = 0;
+
+		TSharedPtr<IHttpRouter> Router;
+		FHttpRouteHandle Route;
+
+		FString TestCacheDirectory;
+		FString PreviousCacheDirectory;
+	};
+
+	typedef TSharedRef<FState> FStateRef;
+
+	static FString GetHeader(const FHttpServerRequest& Request, const TCHAR* Name)
+	{
+		const TArray<FString>* Values = Request.Headers.Find(Name);
+		return (Values && Values->Num() > 0) ? (*Values)[0] : FString();
+	}
+
+	static void Fetch(const FStateRef& State)
+	{
+		FHttpResponseCache::Get().Fetch(State->Url, [State](FHttpResponseCache::FBytes Content)
+		{
+			if (!Content.IsValid())
+			{
+				++State->Failed;
+				return;
+			}
+
+			++State->Fetched;
+			const FString Received(Content->Num(), reinterpret_cast<const ANSICHAR*>(Content->GetData()));
+			if (Received != Body)
+				++State->WrongBodies;
+		});
+	}
+
+	static void Restore(const FStateRef& State)
+	{
+		FHttpResponseCache::Get().SetCacheDirectory(State->PreviousCacheDirectory);
+		IFileManager::Get().DeleteDirectory(*State->TestCacheDirectory, false, true);
+
+		if (State->Router.IsValid() && State->Route.IsValid())
+			State->Router->UnbindRoute(State->Route);
+	}
+
+	/**
+	Waits for the concurrent fetches, which share one request, then fetches again. The response is stale by then,
+	so the second fetch revalidates it and is served from the cache after a 304.
+	*/
+	class FCheckFetchesCommand : public IAutomationLatentCommand
+	{
+	public:
+
+		FCheckFetchesCommand(FAutomationTestBase* InTest, const FStateRef& InState)
+			: Test(InTest)
+			, State(InState)
+		{
+		}
+
+		virtual bool Update() override
+		{
+			const int32 Expected = Revalidating ? NumConcurrentFetches + 1 : NumConcurrentFetches;
+			if (State->Fetched + State->Failed < Expected && GetCurrentRunTime() < TimeoutSeconds)
+				return false;
+
+			const FHttpResponseCache& Cache = FHttpResponseCache::Get();
+
+			if (!Revalidating)
+			{
+				Test->TestEqual(TEXT("Concurrent fetches served"), State->Fetched, NumConcurrentFetches);
+				Test->TestEqual(TEXT("Requests for the concurrent fetches"), State->Requests, 1);
+				Test->TestEqual(TEXT("Coalesced fetches"), Cache.GetCoalescedCount() - State->InitialCoalesced, NumConcurrentFetches - 1);
+				Test->TestEqual(TEXT("Misses after the concurrent fetches"), Cache.GetMissCount() - State->InitialMisses, 1);
+				Test->TestEqual(TEXT("Hits after the concurrent fetches"), Cache.GetHitCount() - State->InitialHits, 0);
+
+				Revalidating = true;
+				Fetch(State);
+				return false;
+			}
+
+			Test->TestEqual(TEXT("Fetches served"), State->Fetched, NumConcurrentFetches + 1);
+			Test->TestEqual(TEXT("Fetches failed"), State->Failed, 0);
+			Test->TestEqual(TEXT("Fetches with a wrong body"), State->WrongBodies, 0);
+			Test->TestEqual(TEXT("Requests"), State->Requests, 2);
+			Test->TestEqual(TEXT("Conditional requests with both validators"), State->ConditionalRequests, 1);
+			Test->TestEqual(TEXT("Not modified responses"), State->NotModifiedResponses, 1);
+			Test->TestEqual(TEXT("Hits"), Cache.GetHitCount() - State->InitialHits, 1);
+			Test->TestEqual(TEXT("Misses"), Cache.GetMissCount() - State->InitialMisses, 1);
+			Test->TestEqual(TEXT("Coalesced fetches"), Cache.GetCoalescedCount() - State->InitialCoalesced, NumConcurrentFetches - 1);
+
+			Restore(State);
+			return true;
+		}
+
+	private:
+
+		FAutomationTestBase* Test;
+		FStateRef State;
+		bool Revalidating = false;
+	};
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FHttpResponseCacheRevalidationTest, "UE4_Studies.HttpResponseCache.Revalidation",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FHttpResponseCacheRevalidationTest::RunTest(const FString& Parameters)
+{
+	using namespace HttpResponseCacheTest;
+
+	FStateRef State = MakeShared<FState>();
+
+	// A local listener stands in for the server. Its response must always be revalidated, and 304 matches its validators.
+	State->Router = FHttpServerModule::Get().GetHttpRouter(Port);
+	if (!State->Router.IsValid())
+	{
+		AddError(FString::Printf(TEXT("Could not listen on port %u"), Port));
+		return false;
+	}
+
+	State->Route = State->Router->BindRoute(FHttpPath(TEXT("/cache")), EHttpServerRequestVerbs::VERB_GET,
+		[State](const FHttpServerRequest& Request, const FHttpResultCallback& OnComplete)
+		{
+			++State->Requests;
+
+			const FString IfNoneMatch = GetHeader(Request, TEXT("If-None-Match"));
+			const FString IfModifiedSince = GetHeader(Request, TEXT("If-Modified-Since"));
+			if (!IfNoneMatch.IsEmpty() || !IfModifiedSince.IsEmpty())
+			{
+				if (IfNoneMatch == ETag && IfModifiedSince == LastModified)
+					++State->ConditionalRequests;
+			}
+
+			TUniquePtr<FHttpServerResponse> Response;
+			if (IfNoneMatch == ETag)
+			{
+				++State->NotModifiedResponses;
+				Response = MakeUnique<FHttpServerResponse>();
+				Response->Code = EHttpServerResponseCodes::NotModified;
+			}
+			else
+			{
+				Response = FHttpServerResponse::Create(Body, TEXT("text/plain"));
+			}
+
+			Response->Headers.Add(TEXT("ETag"), { ETag });
+			Response->Headers.Add(TEXT("Last-Modified"), { LastModified });
+			Response->Headers.Add(TEXT("Cache-Control"), { TEXT("no-cache") });
+
+			OnComplete(MoveTemp(Response));
+			return true;
+		});
+	if (!State->Route.IsValid())
+	{
+		AddError(TEXT("Could not bind the cache route"));
+		return false;
+	}
+	FHttpServerModule::Get().StartAllListeners();
+
+	// A fresh URL and directory, so nothing cached by earlier runs is found
+	FHttpResponseCache& Cache = FHttpResponseCache::Get();
+	State->Url = FString::Printf(TEXT("http://127.0.0.1:%u/cache?run=%s"), Port, *FGuid::NewGuid().ToString());
+	State->TestCacheDirectory = FPaths::AutomationTransientDir() / TEXT("HttpResponseCacheTest");
+	State->PreviousCacheDirectory = Cache.GetCacheDirectory();
+	Cache.SetCacheDirectory(State->TestCacheDirectory);
+
+	State->InitialHits = Cache.GetHitCount();
+	State->InitialMisses = Cache.GetMissCount();
+	State->InitialCoalesced = Cache.GetCoalescedCount();
+
+	// The first fetch starts the request, the others wait for it
+	for (int32 Index = 0; Index < NumConcurrentFetches; ++Index)
+		Fetch(State);
+
+	ADD_LATENT_AUTOMATION_COMMAND(FCheckFetchesCommand(this, State));
+	return true;
+}
+
+#endif
@@ -6,10 +6,31 @@
 #include "Runtime/Online/HTTP/Public/HttpModule.h"
 #include "Interfaces/IHttpRequest.h"
 #include "Interfaces/IHttpResponse.h"
+#include "Async/Async.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
 
 
 void UURequestHttpAsync::Activate()
 {
+	if (UseCache)
+	{
+		TWeakObjectPtr<UURequestHttpAsync> WeakThis(this);
+		FHttpResponseCache::Get().Fetch(URL,
+			[WeakThis](FHttpResponseCache::FBytes Content)
+			{
+				if (WeakThis.IsValid())
+					WeakThis->ProcessContent(Content);
+			},
+			[WeakThis](int32 BytesReceived, int32 ContentLength)
+			{
+				if (WeakThis.IsValid())
+					WeakThis->Progress.Broadcast(BytesReceived, ContentLength);
+			});
+		return;
+	}
+
 	// Create HTTP Request
 	TSharedRef<IHttpRequest, ESPMode::ThreadSafe> HttpRequest = FHttpModule::Get().CreateRequest();
 	HttpRequest->SetVerb("GET");
@@ -18,16 +39,7 @@ void UURequestHttpAsync::Activate()
 
 	// Setup Async response
 	HttpRequest->OnProcessRequestComplete().BindUObject(this, &UURequestHttpAsync::OnResponseReceived);
-	//HttpRequest->OnProcessRequestComplete().BindLambda([this](FHttpRequestPtr Request, FHttpResponsePtr Response, bool bSuccess)
-	//	{
-	//		FString ResponseString = "";
-	//		if (bSuccess)
-	//		{
-	//			ResponseString = Response->GetContentAsString();
-	//		}
-	//		this->HandleRequestCompleted(ResponseString, bSuccess);
-	//	});
-
+	HttpRequest->OnRequestProgress().BindUObject(this, &UURequestHttpAsync::OnRequestProgress);
 
 	// Handle actual request
 	HttpRequest->ProcessRequest();
@@ -35,46 +47,125 @@ void UURequestHttpAsync::Activate()
 }
 
 
+void UURequestHttpAsync::OnRequestProgress(FHttpRequestPtr Request, int32 BytesSent, int32 BytesReceived)
+{
+	FHttpResponsePtr Response = Request.IsValid() ? Request->GetResponse() : nullptr;
+	Progress.Broadcast(BytesReceived, Response.IsValid() ? Response->GetContentLength() : 0);
+}
 
 
 /*Assigned function on successfull http call*/
 void UURequestHttpAsync::OnResponseReceived(FHttpRequestPtr Request, FHttpResponsePtr Response, bool bSuccessful)
 {
-	//UE_LOG(LogTemp, Warning, TEXT("------------------- OnResponseReceived: %d"), bSuccessful);
-	//UE_LOG(LogTemp, Warning, TEXT("%s"), *Response->GetContentAsString());
-	Completed.Broadcast(Response->GetContentAsString(), bSuccessful);
+	FHttpResponseCache::FBytes Content;
+	if (bSuccessful && Response.IsValid())
+		Content = MakeShared<TArray<uint8>, ESPMode::ThreadSafe>(Response->GetContent());
+
+	ProcessContent(Content);
 }
 
 
-void UURequestHttpAsync::HandleRequestCompleted(FString ResponseString, bool bSuccess)
+void UURequestHttpAsync::ProcessContent(FHttpResponseCache::FBytes Content)
 {
-	FString OutString;
-	if (bSuccess)
+	const bool bSuccessful = Content.IsValid();
+
+	static const TArray<uint8> NoContent;
+	CompletedBytes.Broadcast(bSuccessful ? *Content : NoContent, bSuccessful);
+
+	if (!bSuccessful)
 	{
-		// Deserialize object 
-		TSharedPtr<FJsonObject> JsonObject = MakeShareable(new FJsonObject());
-		TSharedRef<TJsonReader<TCHAR>> JsonReader = TJsonReaderFactory<>::Create(ResponseString);
-		FJsonSerializer::Deserialize(JsonReader, JsonObject);
-
-		// The simplest example parsing of the plain JSON.
-		// Here you can expand to fetch your specific layout of values and objects and return
-		// it via a UStruct or separate params in the Completed.Broadcast()
-		if (!JsonObject->TryGetStringField("MOTD", OutString))
+		HandleRequestCompleted(FString(), nullptr, false);
+		return;
+	}
+
+	const bool NeedsJson = !JsonField.IsEmpty() || OnJsonParsed;
+	const bool NeedsString = NeedsJson || Completed.IsBound();
+	const bool NeedsChunks = OnChunk && ChunkSize > 0;
+
+	if (!NeedsString && !NeedsChunks)
+	{
+		SetReadyToDestroy();
+		return;
+	}
+
+	// Large bodies are converted and parsed on a worker thread, the game thread only broadcasts the result
+	TWeakObjectPtr<UURequestHttpAsync> WeakThis(this);
+	const FString Field = JsonField;
+	const int32 Chunk = ChunkSize;
+	TFunction<void(const uint8*, int32, int64)> ChunkCallback;
+	if (NeedsChunks)
+		ChunkCallback = OnChunk;
+
+	Async(EAsyncExecution::ThreadPool, [WeakThis, Content, Field, Chunk, ChunkCallback, NeedsJson, NeedsString]()
+	{
+		const TArray<uint8>& Body = *Content;
+
+		if (ChunkCallback)
 		{
-			// While response may be successful, we failed to retrieve the string field
-			bSuccess = false;
+			for (int64 Offset = 0; Offset < Body.Num(); Offset += Chunk)
+				ChunkCallback(Body.GetData() + Offset, static_cast<int32>(FMath::Min<int64>(Chunk, Body.Num() - Offset)), Offset);
 		}
-	}
 
-	Completed.Broadcast(OutString, bSuccess);
+		FString ResponseString;
+		if (NeedsString && Body.Num() > 0)
+		{
+			FUTF8ToTCHAR Converter(reinterpret_cast<const ANSICHAR*>(Body.GetData()), Body.Num());
+			ResponseString = FString(Converter.Length(), Converter.Get());
+		}
+
+		bool bSuccess = true;
+		TSharedPtr<FJsonObject> JsonObject;
+		if (NeedsJson)
+		{
+			// Deserialize object 
+			TSharedRef<TJsonReader<TCHAR>> JsonReader = TJsonReaderFactory<>::Create(ResponseString);
+			bSuccess = FJsonSerializer::Deserialize(JsonReader, JsonObject) && JsonObject.IsValid();
+
+			// The simplest example parsing of the plain JSON, e.g. the "MOTD" field.
+			// While the response may be successful, we may fail to retrieve the string field
+			if (!Field.IsEmpty())
+			{
+				FString OutString;
+				bSuccess = bSuccess && JsonObject->TryGetStringField(Field, OutString);
+				ResponseString = MoveTemp(OutString);
+			}
+		}
+
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, ResponseString, JsonObject, bSuccess]()
+		{
+			if (WeakThis.IsValid())
+				WeakThis->HandleRequestCompleted(ResponseString, JsonObject, bSuccess);
+		});
+	});
+}
+
+
+void UURequestHttpAsync::HandleRequestCompleted(FString ResponseString, TSharedPtr<FJsonObject> JsonObject, bool bSuccess)
+{
+	if (OnJsonParsed)
+		OnJsonParsed(JsonObject, bSuccess);
+
+	Completed.Broadcast(ResponseString, bSuccess);
+	SetReadyToDestroy();
 }
 
 
-UURequestHttpAsync* UURequestHttpAsync::AsyncRequestHTTP(UObject* WorldContextObject, FString URL)
+UURequestHttpAsync* UURequestHttpAsync::AsyncRequestHTTP(UObject* WorldContextObject, FString URL, FString JsonField, bool bUseCache)
 {
 	// Create Action Instance for Blueprint System
 	UURequestHttpAsync* Action = NewObject<UURequestHttpAsync>();
 	Action->URL = URL;
+	Action->JsonField = JsonField;
+	Action->UseCache = bUseCache;
 	Action->RegisterWithGameInstance(WorldContextObject);
 	return Action;
-}
\ No newline at end of file
+}
+
+
+void UURequestHttpAsync::GetResponseCacheStats(int32& Hits, int32& Misses, int32& Coalesced)
+{
+	const FHttpResponseCache& Cache = FHttpResponseCache::Get();
+	Hits = Cache.GetHitCount();
+	Misses = Cache.GetMissCount();
+	Coalesced = Cache.GetCoalescedCount();
+}
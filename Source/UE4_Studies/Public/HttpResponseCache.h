@@ -0,0 +1,121 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Interfaces/IHttpRequest.h"
+
+
+/**
+Cache of GET responses keyed by URL, kept in memory and in a directory on disk.
+A cached response is revalidated with If-None-Match and If-Modified-Since from its ETag and Last-Modified
+headers, and served from the cache when the server answers 304. A response with a max-age is served without
+any request until it expires, and one marked no-store is never kept.
+Requests for a URL that is already being fetched wait for that fetch instead of starting another one.
+The directory is kept under a size cap by deleting the least recently used responses. Game thread only.
+*/
+class UE4_STUDIES_API FHttpResponseCache
+{
+public:
+
+	typedef TSharedPtr<const TArray<uint8>, ESPMode::ThreadSafe> FBytes;
+
+	static FHttpResponseCache& Get();
+
+	/**
+	Serves a GET request from the cache, revalidating the cached response if needed.
+	If the server cannot be reached, a cached response is served even if it is stale.
+	@param OnFetched Called on the game thread with the body, or with nullptr if the request failed.
+	@param OnProgress Called on the game thread with the bytes received, if a body is downloaded.
+	*/
+	void Fetch(const FString& Url, TFunction<void(FBytes Content)> OnFetched, TFunction<void(int32 BytesReceived, int32 ContentLength)> OnProgress = nullptr);
+
+	/** Keeps responses in Directory, or only in memory if Directory is empty. Defaults to Saved/HttpCache. */
+	void SetCacheDirectory(const FString& Directory);
+
+	FString GetCacheDirectory() const { return CacheDirectory; }
+
+	/** Responses are dropped from memory, least recently used first, beyond this size. They stay on disk. */
+	void SetMaxMemoryBytes(int64 Bytes);
+
+	/** Response files are deleted, least recently used first, once the directory grows beyond this size. Checked on the next write. */
+	void SetMaxDiskBytes(int64 Bytes);
+
+	/** Forgets all responses, in memory and on disk, and resets the counters. */
+	void Clear();
+
+	/** Fetches served from the cache, without a request or after a 304. */
+	int32 GetHitCount() const { return HitCount; }
+
+	/** Fetches that downloaded the body. */
+	int32 GetMissCount() const { return MissCount; }
+
+	/** Fetches that waited for a fetch of the same URL already in flight. */
+	int32 GetCoalescedCount() const { return CoalescedCount; }
+
+private:
+
+	FHttpResponseCache();
+
+	struct FEntry
+	{
+		FBytes Content;
+		FString ETag;
+		FString LastModified;
+		/** Served without revalidation until then. */
+		FDateTime ExpiresAt = FDateTime::MinValue();
+		uint64 LastUse = 0;
+	};
+	typedef TSharedPtr<FEntry, ESPMode::ThreadSafe> FEntryPtr;
+
+	struct FWaiter
+	{
+		TFunction<void(FBytes)> OnFetched;
+		TFunction<void(int32, int32)> OnProgress;
+	};
+
+	FString GetCachePath(const FString& Url) const;
+
+	static FEntryPtr ReadEntry(const FString& Path, const FString& Url);
+
+	/** @param OutReplacedBytes Size of the file the entry has replaced, 0 if there was none. */
+	static bool WriteEntry(const FString& Path, const FString& Url, const FEntry& Entry, int64& OutWrittenBytes, int64& OutReplacedBytes);
+
+	/** Accounts for a written entry and trims the cache directory if it has grown over its cap. Worker threads. */
+	void OnEntryWritten(const FString& Directory, int64 WrittenBytes, int64 ReplacedBytes);
+
+	/** Measures the cache directory and deletes the least recently used files down to 90% of the cap. Call with DiskMutex held. */
+	void TrimDisk(const FString& Directory);
+
+	/** Sends the request, conditional if there is a cached entry. */
+	void StartRequest(const FString& Url, FEntryPtr Cached);
+
+	void OnResponseReceived(FHttpRequestPtr Request, FHttpResponsePtr Response, bool bSuccessful, FString Url, FEntryPtr Cached);
+	void OnRequestProgress(FHttpRequestPtr Request, int32 BytesSent, int32 BytesReceived, FString Url);
+
+	/** Stores an entry in memory, and on disk on a worker thread. */
+	void Store(const FString& Url, FEntryPtr Entry);
+
+	/** Calls and removes the waiters of Url. */
+	void Complete(const FString& Url, FBytes Content);
+
+	void TrimMemory();
+
+	FString CacheDirectory;
+	int64 MaxMemoryBytes = 64 * 1024 * 1024;
+	int64 MemoryBytes = 0;
+	uint64 UseCounter = 0;
+
+	// Written from the thread pool
+	FCriticalSection DiskMutex;
+	int64 MaxDiskBytes = 256 * 1024 * 1024;
+	/** Size of the cache directory, -1 until it has been measured. */
+	int64 DiskBytes = -1;
+
+	TMap<FString, FEntryPtr> Entries;
+	TMap<FString, TArray<FWaiter>> InFlight;
+
+	int32 HitCount = 0;
+	int32 MissCount = 0;
+	int32 CoalescedCount = 0;
+};
@@ -20,4 +20,19 @@ public:
 
 	UFUNCTION(BlueprintCallable, Category=Settings)
 	static void DisableFixedTimeStep();
+
+	/**
+	Fixed time step for offline renders, in which image sequences never skip a frame: each frame waits until the
+	frames the sequences show are loaded. Frames not loaded after MaxStallSeconds are given up on.
+	*/
+	UFUNCTION(BlueprintCallable, Category=Settings)
+	static void EnableFrameLockedCapture(float desiredDeltaTime, float MaxStallSeconds = 30.0f);
+
+	/** Leaves the frame-locked capture and the fixed time step. */
+	UFUNCTION(BlueprintCallable, Category=Settings)
+	static void DisableFrameLockedCapture();
+
+	/** Time in seconds the last frame waited for image sequence frames, and totals since the capture has been enabled. */
+	UFUNCTION(BlueprintCallable, Category=Settings)
+	static void GetCaptureStallStats(float& LastFrameStall, float& TotalStall, int32& StalledFrames, int32& CapturedFrames);
 };
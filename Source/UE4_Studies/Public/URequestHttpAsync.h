@@ -5,12 +5,21 @@
 #include "CoreMinimal.h"
 #include "Kismet/BlueprintAsyncActionBase.h"
 #include "Interfaces/IHttpRequest.h"
+#include "HttpResponseCache.h"
 #include "URequestHttpAsync.generated.h"
 
+class FJsonObject;
+
 
 // Event that will be the 'Completed' exec wire in the blueprint node along with all parameters as output pins.
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnHttpRequestCompleted, const FString&, MOTD, bool, bSuccess);
 
+// Raw response body, passed by reference without conversion
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnHttpRequestBytes, const TArray<uint8>&, Content, bool, bSuccess);
+
+// Bytes received so far, and the expected total or 0 if the server did not send it
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnHttpRequestProgress, int32, BytesReceived, int32, ContentLength);
+
 UCLASS()
 class UE4_STUDIES_API UURequestHttpAsync : public UBlueprintAsyncActionBase
 {
@@ -18,21 +27,60 @@ class UE4_STUDIES_API UURequestHttpAsync : public UBlueprintAsyncActionBase
 
 protected:
 
-	void HandleRequestCompleted(FString ResponseString, bool bSuccess);
+	/** Game thread end of a request, after the body has been converted and parsed on a worker thread. */
+	void HandleRequestCompleted(FString ResponseString, TSharedPtr<FJsonObject> JsonObject, bool bSuccess);
 	void OnResponseReceived(FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful);
+	void OnRequestProgress(FHttpRequestPtr Request, int32 BytesSent, int32 BytesReceived);
+
+	/** Broadcasts the body, then converts and parses it on a worker thread. */
+	void ProcessContent(FHttpResponseCache::FBytes Content);
 
 public:
 
 	/** Execute the actual load */
 	virtual void Activate() override;
 
+	/**
+	@param JsonField If set, the body is parsed as JSON off the game thread and Completed receives this string field of it.
+	@param bUseCache Serves the response from FHttpResponseCache, which revalidates it with the server. Off by default,
+	so that a request always reaches the server unless the caller opts in.
+	*/
 	UFUNCTION(BlueprintCallable, meta = (BlueprintInternalUseOnly = "true", Category = "HTTP", WorldContext = "WorldContextObject"))
-	static UURequestHttpAsync* AsyncRequestHTTP(UObject* WorldContextObject, FString URL);
+	static UURequestHttpAsync* AsyncRequestHTTP(UObject* WorldContextObject, FString URL, FString JsonField = TEXT(""), bool bUseCache = false);
 
+	/** Counters of the response cache: served from the cache, downloaded, and joined to a request in flight. */
+	UFUNCTION(BlueprintCallable, Category = "HTTP")
+	static void GetResponseCacheStats(int32& Hits, int32& Misses, int32& Coalesced);
+
+	/** Receives the body as a string, converted from UTF-8 on a worker thread. */
 	UPROPERTY(BlueprintAssignable)
 	FOnHttpRequestCompleted Completed;
 
+	/** Receives the body as it arrived, before Completed. */
+	UPROPERTY(BlueprintAssignable)
+	FOnHttpRequestBytes CompletedBytes;
+
+	UPROPERTY(BlueprintAssignable)
+	FOnHttpRequestProgress Progress;
+
 	// URL to send GET request to 
 	FString URL;
+
+	// String field of the JSON body to pass to Completed, empty to pass the whole body
+	FString JsonField;
+
+	// Go through the response cache instead of sending the request directly
+	bool UseCache = false;
+
+	/** Called on the game thread with the body parsed on a worker thread. Set before activation. */
+	TFunction<void(TSharedPtr<FJsonObject> JsonObject, bool bSuccess)> OnJsonParsed;
+
+	/**
+	Called on a worker thread with consecutive slices of ChunkSize bytes of the body, without copying it.
+	The engine HTTP module delivers the body once complete, so the slices follow the completion.
+	*/
+	TFunction<void(const uint8* Data, int32 Size, int64 Offset)> OnChunk;
+
+	int32 ChunkSize = 1024 * 1024;
 	
 };
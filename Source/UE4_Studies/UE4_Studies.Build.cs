@@ -8,9 +8,17 @@ public class UE4_Studies : ModuleRules
 	{
 		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
 	
-		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore" });
+		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "HTTP" });
 
-		PrivateDependencyModuleNames.AddRange(new string[] {  });
+		PrivateDependencyModuleNames.AddRange(new string[] { "Json", "ImageLoaderPlugin" });
+
+		// The local http server only serves the automation tests, it stays out of shipping builds
+		bool bWithHttpServerTests = Target.bBuildDeveloperTools || Target.Configuration != UnrealTargetConfiguration.Shipping;
+		if (bWithHttpServerTests)
+		{
+			PrivateDependencyModuleNames.Add("HTTPServer");
+		}
+		PrivateDefinitions.Add("WITH_HTTPSERVER_TESTS=" + (bWithHttpServerTests ? "1" : "0"));
 
 		// Uncomment if you are using Slate UI
 		// PrivateDependencyModuleNames.AddRange(new string[] { "Slate", "SlateCore" });